@@ -0,0 +1,288 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "symmetric_matrix.h"
+#include "dense_vector.h"
+#include "svd.h"
+#include "jacobi_svd.h"
+#include "golub_kahan_svd.h"
+#include "sparse_matrix.h"
+#include "binary_matrix.h"
+#include "npy.h"
+#include "matrix_market.h"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <filesystem>
+#include <random>
+
+template <typename T>
+void BenchMatrix(const std::string& type_name){
+    for(size_t n : {128, 256, 512}){
+        Matrix<T> lhs = RandomMatrix<T>(n, n, 1), rhs = RandomMatrix<T>(n, n, 2);
+        double seconds = MeasureSeconds([&]{
+            Matrix<T> res = lhs;
+            res *= rhs;
+        });
+        PrintResult("operator*= " + type_name + " " + std::to_string(n), seconds, 2.0 * n * n * n);
+    }
+    for(size_t n : {512, 2048}){
+        Matrix<T> m = RandomMatrix<T>(n, n);
+        double seconds = MeasureSeconds([&]{
+            Matrix<T> res = Transp(m);
+        });
+        PrintResult("Transp " + type_name + " " + std::to_string(n), seconds);
+    }
+    {
+        const size_t n = 512;
+        Matrix<T> lhs = RandomMatrix<T>(n, n, 1), rhs = RandomMatrix<T>(n, n, 2);
+        double seconds = MeasureSeconds([&]{
+            Matrix<T> res = Transp(lhs) * rhs;
+        });
+        PrintResult("Transp(A) * B " + type_name + " 512", seconds, 2.0 * n * n * n);
+        seconds = MeasureSeconds([&]{
+            Matrix<T> res = Transposed(lhs) * rhs;
+        });
+        PrintResult("Transposed(A) * B " + type_name + " 512", seconds, 2.0 * n * n * n);
+    }
+    {
+        const size_t n = 2048;
+        Matrix<T> m = RandomMatrix<T>(n, n);
+        Matrix<T> u_column(n, 1, T(1));
+        Vector<T> u(n, T(1));
+        double seconds = MeasureSeconds([&]{
+            Matrix<T> res = m * u_column;
+        });
+        PrintResult("Matrix * n x 1 Matrix " + type_name + " 2048", seconds, 2.0 * n * n);
+        seconds = MeasureSeconds([&]{
+            Vector<T> res = m * u;
+        });
+        PrintResult("Matrix * Vector " + type_name + " 2048", seconds, 2.0 * n * n);
+        seconds = MeasureSeconds([&]{
+            Vector<T> res = Transposed(m) * u;
+        });
+        PrintResult("Transposed(Matrix) * Vector " + type_name + " 2048", seconds, 2.0 * n * n);
+    }
+    {
+        Matrix<T> m = RandomMatrix<T>(2000, 1000);
+        double seconds = MeasureSeconds([&]{
+            Matrix<T> res = Transposed(m) * m;
+        });
+        PrintResult("Transposed(A) * A " + type_name + " 2000x1000", seconds);
+        seconds = MeasureSeconds([&]{
+            SymmetricMatrix<T> res = GramColumns(m);
+        });
+        PrintResult("GramColumns " + type_name + " 2000x1000", seconds);
+    }
+    {
+        Matrix<T> a = RandomMatrix<T>(1024, 1024, 1), b = RandomMatrix<T>(1024, 1024, 2);
+        Matrix<T> res = a;
+        double seconds = MeasureSeconds([&]{
+            res = a * T(2) - b + res * T(0.5);
+        });
+        PrintResult("a * 2 - b + res * 0.5 " + type_name + " 1024", seconds);
+    }
+    {
+        const size_t n = 2048;
+        Matrix<T> a(RandomMatrix<T>(n, n, 1), HugePageMemoryResource());
+        Matrix<T> b(RandomMatrix<T>(n, n, 2), HugePageMemoryResource());
+        Matrix<T> res(a, HugePageMemoryResource());
+        double seconds = MeasureSeconds([&]{
+            res = a * T(2) - b + res * T(0.5);
+        });
+        PrintResult("a * 2 - b + res * 0.5 huge pages " + type_name + " 2048", seconds);
+        Matrix<T> plain_a = RandomMatrix<T>(n, n, 1), plain_b = RandomMatrix<T>(n, n, 2), plain_res = plain_a;
+        seconds = MeasureSeconds([&]{
+            plain_res = plain_a * T(2) - plain_b + plain_res * T(0.5);
+        });
+        PrintResult("a * 2 - b + res * 0.5 " + type_name + " 2048", seconds);
+    }
+    {
+        Matrix<T> m = RandomMatrix<T>(2000, 200);
+        double seconds = MeasureSeconds([&]{
+            SVD<T> res = CalculateSVD<T>(m, 5, 1e-4);
+        }, 1);
+        PrintResult("CalculateSVD " + type_name + " 2000x200 k=5", seconds);
+    }
+    {
+        Matrix<T> m = RandomMatrix<T>(400, 100);
+        double seconds = MeasureSeconds([&]{
+            SVD<T> res = CalculateJacobiSVD<T>(m, 100, 1e-6);
+        }, 1);
+        PrintResult("CalculateJacobiSVD " + type_name + " 400x100", seconds);
+        seconds = MeasureSeconds([&]{
+            SVD<T> res = CalculateGolubKahanSVD<T>(m, 100, 1e-6);
+        }, 1);
+        PrintResult("CalculateGolubKahanSVD " + type_name + " 400x100", seconds);
+        seconds = MeasureSeconds([&]{
+            SVD<T> res = CalculateSVD<T>(m, 100, 1e-4);
+        }, 1);
+        PrintResult("CalculateSVD " + type_name + " 400x100 k=100", seconds);
+    }
+}
+
+// The CSR line parser before the block reader: a stringstream per line and operator>> per value
+template <typename T>
+std::vector<T> LegacyParceRowNumbers(std::istream& input){
+    std::vector<T> res;
+    std::string line;
+    std::getline(input, line);
+    std::stringstream numbers;
+    numbers << std::move(line);
+    for(T num; !numbers.eof(); ){
+        numbers >> num;
+        res.push_back(std::move(num));
+    }
+    return res;
+}
+
+inline void PrintThroughput(const std::string& name, const double seconds, const size_t bytes){
+    std::cout << std::left << std::setw(40) << name
+        << std::right << std::setw(12) << std::fixed << std::setprecision(3) << seconds * 1e3 << " ms"
+        << std::setw(12) << std::setprecision(1) << double(bytes) / seconds * 1e-6 << " MB/s" << '\n';
+}
+
+template <typename T>
+void BenchParceCSR(const std::string& type_name){
+    const size_t rows = 50000, columns = 10000, per_row = 40;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> column_dist(0, columns / per_row - 1);
+    std::uniform_real_distribution<double> value_dist(-100, 100);
+    std::string indices, indptr = "0", data;
+    for(size_t i = 0; i < rows; ++i){
+        // One column per stripe keeps the columns of a row sorted
+        for(size_t j = 0; j < per_row; ++j){
+            indices += std::to_string(j * (columns / per_row) + column_dist(generator)) + ' ';
+            std::ostringstream value;
+            value << static_cast<T>(value_dist(generator));
+            data += value.str() + ' ';
+        }
+        indptr += ' ' + std::to_string((i + 1) * per_row);
+    }
+    const std::string text = std::to_string(columns) + ' ' + std::to_string(rows) + '\n'
+        + indices + '\n' + indptr + '\n' + data + '\n';
+    const std::string size = " " + type_name + " " + std::to_string(text.size() >> 20) + " MiB";
+
+    double seconds = MeasureSeconds([&]{
+        std::istringstream input(text);
+        size_t size_row, size_column;
+        input >> size_row >> size_column;
+        input.get();
+        std::vector<size_t> legacy_indices = LegacyParceRowNumbers<size_t>(input);
+        std::vector<size_t> legacy_indptr = LegacyParceRowNumbers<size_t>(input);
+        std::vector<T> legacy_data = LegacyParceRowNumbers<T>(input);
+    }, 1);
+    PrintThroughput("CSR text stringstream" + size, seconds, text.size());
+    SparseMatrix<T> parsed;
+    seconds = MeasureSeconds([&]{
+        std::istringstream input(text);
+        parsed = ParceCSRFormat<T>(input);
+    }, 1);
+    PrintThroughput("ParceCSRFormat" + size, seconds, text.size());
+
+    // The same matrix from the binary container: mapped in place, or copied out of the mapping
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_csr.svdb").string();
+    SaveBinary(path, parsed);
+    const size_t bytes = std::filesystem::file_size(path);
+    // Only the count is read, so the view is timed without touching the arrays it maps
+    size_t non_zeros = 0;
+    seconds = MeasureSeconds([&]{
+        BinaryFile file(path);
+        SparseView<T> view = file.Sparse<T>(0);
+        non_zeros += view.NonZeros();
+    });
+    PrintThroughput("BinaryFile CSR view" + size, seconds, bytes);
+    seconds = MeasureSeconds([&]{
+        BinaryFile file(path);
+        SparseMatrix<T> res = file.Sparse<T>(0).ToSparse();
+    });
+    PrintThroughput("BinaryFile CSR copy" + size, seconds, bytes);
+    std::filesystem::remove(path);
+}
+
+// Batch jobs reload factorizations: the mapped triplets against a copy into SVD<T>
+template <typename T>
+void BenchBinarySVD(const std::string& type_name){
+    SVD<T> svd;
+    svd.left_singular_vectors = RandomMatrix<T>(100000, 50, 1);
+    svd.right_singular_vectors = RandomMatrix<T>(5000, 50, 2);
+    svd.eigenvalues = Matrix<T>(50, 50, T(1));
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_svd.svdb").string();
+    double seconds = MeasureSeconds([&]{
+        SaveSVD(path, svd);
+    }, 1);
+    const size_t bytes = std::filesystem::file_size(path);
+    PrintThroughput("SaveSVD " + type_name + " 100000x50", seconds, bytes);
+    T largest = 0;
+    seconds = MeasureSeconds([&]{
+        BinaryFile file(path);
+        SVDView<T> view = ViewSVD<T>(file);
+        largest += view.singular_values(0, 0);
+    });
+    PrintThroughput("ViewSVD " + type_name + " 100000x50", seconds, bytes);
+    seconds = MeasureSeconds([&]{
+        SVD<T> res = LoadSVD<T>(path);
+    });
+    PrintThroughput("LoadSVD " + type_name + " 100000x50", seconds, bytes);
+    std::filesystem::remove(path);
+}
+
+// Exchange with NumPy and Matrix Market tools: a dense block through .npy in both orders and
+// a sparse matrix through coordinate text
+template <typename T>
+void BenchExchangeFormats(const std::string& type_name){
+    const Matrix<T> dense = RandomMatrix<T>(100000, 50, 1);
+    for(bool fortran_order : {false, true}){
+        const std::string name = std::string(fortran_order ? " Fortran " : " C ") + type_name + " 100000x50";
+        std::string bytes;
+        double seconds = MeasureSeconds([&]{
+            std::ostringstream output;
+            WriteNpy(output, dense, fortran_order);
+            bytes = output.str();
+        }, 1);
+        PrintThroughput("WriteNpy" + name, seconds, bytes.size());
+        seconds = MeasureSeconds([&]{
+            std::istringstream input(bytes);
+            Matrix<T> res = ReadNpy<T>(input);
+        }, 1);
+        PrintThroughput("ReadNpy" + name, seconds, bytes.size());
+    }
+
+    const size_t rows = 50000, columns = 10000, per_row = 40;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> column_dist(0, columns / per_row - 1);
+    std::uniform_real_distribution<double> value_dist(-100, 100);
+    std::vector<size_t> offsets(1, 0), indices;
+    std::vector<T> values;
+    for(size_t i = 0; i < rows; ++i){
+        for(size_t j = 0; j < per_row; ++j){
+            indices.push_back(j * (columns / per_row) + column_dist(generator));
+            values.push_back(static_cast<T>(value_dist(generator)));
+        }
+        offsets.push_back(indices.size());
+    }
+    const SparseMatrix<T> sparse(rows, columns, std::move(offsets), std::move(indices), std::move(values));
+    const std::string name = " " + type_name + " 50000x10000";
+    std::string text;
+    double seconds = MeasureSeconds([&]{
+        std::ostringstream output;
+        WriteMatrixMarket(output, sparse);
+        text = output.str();
+    }, 1);
+    PrintThroughput("WriteMatrixMarket" + name, seconds, text.size());
+    seconds = MeasureSeconds([&]{
+        std::istringstream input(text);
+        SparseMatrix<T> res = ReadMatrixMarketSparse<T>(input);
+    }, 1);
+    PrintThroughput("ReadMatrixMarketSparse" + name, seconds, text.size());
+}
+
+int main(){
+    BenchMatrix<float>("float");
+    BenchMatrix<double>("double");
+    BenchParceCSR<float>("float");
+    BenchParceCSR<double>("double");
+    BenchBinarySVD<double>("double");
+    BenchExchangeFormats<float>("float");
+    BenchExchangeFormats<double>("double");
+}
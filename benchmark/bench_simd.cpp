@@ -0,0 +1,58 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "simd.h"
+
+#include <string>
+#include <vector>
+
+template <typename T>
+void BenchSimd(const std::string& type_name, const SimdLevel level){
+    const std::string suffix = " " + type_name + " " + SimdLevelName(level);
+    for(size_t size : {size_t(4096), size_t(1) << 20}){
+        std::vector<T, AlignedAllocator<T>> lhs(size, T(1.0001)), rhs(size, T(0.9999));
+        const std::string name = std::to_string(size) + suffix;
+        const size_t repeats = (size_t(1) << 24) / size;
+        PrintResult("SimdAdd " + name, MeasureSeconds([&]{
+            for(size_t i = 0; i < repeats; ++i){
+                SimdAdd(lhs.data(), rhs.data(), size);
+            }
+        }), double(size) * repeats);
+        PrintResult("SimdScale " + name, MeasureSeconds([&]{
+            for(size_t i = 0; i < repeats; ++i){
+                SimdScale(lhs.data(), T(0.5), size);
+            }
+        }), double(size) * repeats);
+        T sink = 0;
+        PrintResult("SimdDot " + name, MeasureSeconds([&]{
+            for(size_t i = 0; i < repeats; ++i){
+                sink += SimdDot(lhs.data(), rhs.data(), size);
+            }
+        }), 2.0 * size * repeats);
+        PrintResult("SimdSumSquares " + name, MeasureSeconds([&]{
+            for(size_t i = 0; i < repeats; ++i){
+                sink += SimdSumSquares(lhs.data(), size);
+            }
+        }), 2.0 * size * repeats);
+        if(sink == T(-1)){
+            std::cout << sink;
+        }
+    }
+    {
+        const size_t n = 512;
+        Matrix<T> lhs = RandomMatrix<T>(n, n, 1), rhs = RandomMatrix<T>(n, n, 2);
+        PrintResult("operator* 512" + suffix, MeasureSeconds([&]{
+            Matrix<T> res = lhs * rhs;
+        }), 2.0 * n * n * n);
+    }
+}
+
+int main(){
+    for(SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512}){
+        if(level > DetectedSimdLevel()){
+            continue;
+        }
+        SetSimdLevel(level);
+        BenchSimd<float>("float", level);
+        BenchSimd<double>("double", level);
+    }
+}
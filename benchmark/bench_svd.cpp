@@ -0,0 +1,311 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "orthonormalize.h"
+#include "svd.h"
+#include "randomized_svd.h"
+#include "subspace_svd.h"
+#include "lanczos_svd.h"
+#include "incremental_svd.h"
+#include "streaming_svd.h"
+#include "mixed_svd.h"
+#include "sparse_matrix.h"
+#include "linear_operator.h"
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+
+// rows x columns matrix with singular values sigma and random singular vectors
+template <typename T>
+Matrix<T> MatrixWithSpectrum(size_t rows, size_t columns, const std::vector<T>& sigma){
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal;
+    Matrix<T> left(sigma.size(), rows, T()), right(sigma.size(), columns, T());
+    for(Matrix<T>* factor : {&left, &right}){
+        for(size_t i = 0; i < factor->SizeColumn(); ++i){
+            for(T& val : (*factor)[i]){
+                val = static_cast<T>(normal(generator));
+            }
+        }
+        OrthonormalizeRows(*factor);
+    }
+    for(size_t i = 0; i < sigma.size(); ++i){
+        SimdScale(left[i].data(), sigma[i], left.SizeRow());
+    }
+    return Transposed(left) * right;
+}
+
+// Largest deviation of the computed singular values from the exact ones, relative to the largest
+template <typename T>
+double SpectrumError(const SVD<T>& res, const std::vector<T>& sigma){
+    double error = 0;
+    for(size_t i = 0; i < res.eigenvalues.SizeColumn(); ++i){
+        error = std::max(error, std::abs(double(res.eigenvalues[i][i]) - double(sigma[i])) / double(sigma[0]));
+    }
+    return error;
+}
+
+inline void PrintAccuracy(const std::string& name, const double seconds, const double error){
+    std::cout << std::left << std::setw(48) << name
+        << std::right << std::setw(12) << std::fixed << std::setprecision(3) << seconds * 1e3 << " ms"
+        << std::setw(14) << std::scientific << std::setprecision(2) << error << " rel. error" << '\n';
+}
+
+template <typename T>
+void BenchSVD(const std::string& type_name, const size_t rows, const size_t columns, const size_t rank){
+    std::vector<T> sigma(columns);
+    for(size_t i = 0; i < columns; ++i){
+        sigma[i] = static_cast<T>(std::exp(-double(i) / 20));
+    }
+    const Matrix<T> m = MatrixWithSpectrum(rows, columns, sigma);
+    const std::string size = " " + type_name + " " + std::to_string(rows) + "x" + std::to_string(columns)
+        + " k=" + std::to_string(rank);
+
+    SVD<T> res;
+    double seconds = MeasureSeconds([&]{
+        res = CalculateSVD<T>(m, rank, T(1e-4));
+    }, 1);
+    PrintAccuracy("CalculateSVD" + size, seconds, SpectrumError(res, sigma));
+    {
+        // Recompute after a small drift of the data, cold and from the previous factorization
+        Matrix<T> drifted = m;
+        std::mt19937 generator(7);
+        std::normal_distribution<double> normal;
+        for(size_t i = 0; i < drifted.SizeColumn(); ++i){
+            for(T& val : drifted[i]){
+                val += static_cast<T>(1e-4 * normal(generator) * val);
+            }
+        }
+        const SVD<T> previous = res;
+        std::vector<size_t> cold_iterations;
+        WarmStartReport report;
+        seconds = MeasureSeconds([&]{
+            res = CalculateSVD<T>(drifted, rank, T(1e-4), &cold_iterations);
+        }, 1);
+        PrintAccuracy("CalculateSVD drifted cold" + size, seconds, SpectrumError(res, sigma));
+        seconds = MeasureSeconds([&]{
+            res = CalculateSVD<T>(drifted, rank, T(1e-4), previous, &report);
+        }, 1);
+        PrintAccuracy("CalculateSVD drifted warm" + size, seconds, SpectrumError(res, sigma));
+        size_t cold_total = 0, warm_total = 0, estimated_total = 0;
+        for(size_t i = 0; i < rank; ++i){
+            cold_total += cold_iterations[i];
+            warm_total += report.iterations[i];
+            estimated_total += report.cold_iterations[i];
+        }
+        std::cout << "  power iterations cold " << cold_total << " (estimated " << estimated_total << "), warm "
+            << warm_total << ", saved " << report.Saved() << '\n';
+    }
+    seconds = MeasureSeconds([&]{
+        res = CalculateSubspaceSVD<T>(m, rank, T(1e-4));
+    }, 1);
+    PrintAccuracy("CalculateSubspaceSVD" + size, seconds, SpectrumError(res, sigma));
+    seconds = MeasureSeconds([&]{
+        res = CalculateLanczosSVD<T>(m, rank, T(1e-4));
+    }, 1);
+    PrintAccuracy("CalculateLanczosSVD" + size, seconds, SpectrumError(res, sigma));
+    for(size_t passes : {0, 1, 2}){
+        seconds = MeasureSeconds([&]{
+            res = CalculateRandomizedSVD<T>(m, rank, 10, passes);
+        }, 1);
+        PrintAccuracy("CalculateRandomizedSVD q=" + std::to_string(passes) + size, seconds, SpectrumError(res, sigma));
+    }
+}
+
+// Rows arrive in batches: fold each one into a truncated factorization instead of recomputing
+template <typename T>
+void BenchIncremental(const std::string& type_name, const size_t rows, const size_t columns, const size_t rank,
+    const size_t batch){
+    std::vector<T> sigma(columns);
+    for(size_t i = 0; i < columns; ++i){
+        sigma[i] = static_cast<T>(std::exp(-double(i) / 5));
+    }
+    const Matrix<T> m = MatrixWithSpectrum(rows, columns, sigma);
+    std::vector<Matrix<T>> batches;
+    for(size_t begin = 0; begin < rows; begin += batch){
+        Matrix<T> part(0);
+        for(size_t i = begin; i < std::min(rows, begin + batch); ++i){
+            part.PushBackRow(std::vector<T>(m[i].begin(), m[i].end()));
+        }
+        batches.push_back(std::move(part));
+    }
+    const std::string size = " " + type_name + " " + std::to_string(rows) + "x" + std::to_string(columns)
+        + " k=" + std::to_string(rank) + " batch=" + std::to_string(batch);
+
+    SVD<T> res;
+    T error = 0;
+    double seconds = MeasureSeconds([&]{
+        IncrementalSVD<T> inc(rank, columns);
+        for(const Matrix<T>& part : batches){
+            inc.Update(part);
+        }
+        res = inc.Result();
+        error = inc.TruncationError();
+    }, 1);
+    PrintAccuracy("IncrementalSVD per batch" + size, seconds / double(batches.size()), SpectrumError(res, sigma));
+    std::cout << "  truncation error " << error << '\n';
+    seconds = MeasureSeconds([&]{
+        res = CalculateSVD<T>(m, rank, T(1e-4));
+    }, 1);
+    PrintAccuracy("CalculateSVD full recompute" + size, seconds, SpectrumError(res, sigma));
+}
+
+// The matrix is only seen through a row source and a fixed memory budget
+template <typename T>
+void BenchStreaming(const std::string& type_name, const size_t rows, const size_t columns, const size_t rank,
+    const size_t memory_budget){
+    std::vector<T> sigma(columns);
+    for(size_t i = 0; i < columns; ++i){
+        sigma[i] = static_cast<T>(std::exp(-double(i) / 20));
+    }
+    const Matrix<T> m = MatrixWithSpectrum(rows, columns, sigma);
+    size_t position = 0;
+    CallbackRowSource<T> source(columns, [&m, &position](T* row){
+        if(position == m.SizeColumn()){
+            return false;
+        }
+        std::copy(m[position].begin(), m[position].end(), row);
+        ++position;
+        return true;
+    }, [&position]{
+        position = 0;
+    });
+    const std::string size = " " + type_name + " " + std::to_string(rows) + "x" + std::to_string(columns)
+        + " k=" + std::to_string(rank) + " " + std::to_string(memory_budget >> 20) + " MiB";
+
+    SVD<T> res;
+    double seconds = MeasureSeconds([&]{
+        source.Rewind();
+        res = CalculateStreamingSVD<T>(source, rank, memory_budget);
+    }, 1);
+    PrintAccuracy("CalculateStreamingSVD 1 pass" + size, seconds, SpectrumError(res, sigma));
+    // The rows of U are only summed, as a caller writing them out would only touch each once
+    T checksum = 0;
+    CallbackRowSink<T> sink([&checksum, rank](const T* row){
+        checksum += std::accumulate(row, row + rank, T(0));
+    });
+    seconds = MeasureSeconds([&]{
+        source.Rewind();
+        res = CalculateStreamingSVD<T>(source, rank, memory_budget, sink);
+    }, 1);
+    PrintAccuracy("CalculateStreamingSVD 2 passes" + size, seconds, SpectrumError(res, sigma));
+}
+
+// Largest residual max(|op * v - sigma * u|, |op^T * u - sigma * v|) of the computed triplets,
+// relative to the largest value
+template <LinearOperator Op, typename T>
+double ResidualError(const Op& op, const SVD<T>& res){
+    using V = typename Op::value_type;
+    Vector<V> left(op.SizeColumn()), right(op.SizeRow()), image(op.SizeColumn()), transposed_image(op.SizeRow());
+    double error = 0;
+    for(size_t j = 0; j < res.eigenvalues.SizeColumn(); ++j){
+        for(size_t i = 0; i < left.Size(); ++i){
+            left[i] = V(res.left_singular_vectors[i][j]);
+        }
+        for(size_t i = 0; i < right.Size(); ++i){
+            right[i] = V(res.right_singular_vectors[i][j]);
+        }
+        op.Apply(right.Data(), image.Data());
+        op.ApplyTransposed(left.Data(), transposed_image.Data());
+        const double value = double(res.eigenvalues[j][j]);
+        double residual = 0, transposed_residual = 0;
+        for(size_t i = 0; i < left.Size(); ++i){
+            const double diff = double(image[i]) - value * double(left[i]);
+            residual += diff * diff;
+        }
+        for(size_t i = 0; i < right.Size(); ++i){
+            const double diff = double(transposed_image[i]) - value * double(right[i]);
+            transposed_residual += diff * diff;
+        }
+        error = std::max(error, std::sqrt(std::max(residual, transposed_residual)) / double(res.eigenvalues[0][0]));
+    }
+    return error;
+}
+
+// Float storage: float throughout, double throughout on a widened copy, and double accumulation
+// over the float matrix, each to the tolerance its precision can reach. The error is the residual
+// against the stored values, exact in double.
+void BenchMixed(const size_t rows, const size_t columns, const size_t rank){
+    std::vector<float> sigma(columns);
+    for(size_t i = 0; i < columns; ++i){
+        sigma[i] = static_cast<float>(std::exp(-double(i) / 20));
+    }
+    const Matrix<float> m = MatrixWithSpectrum(rows, columns, sigma);
+    Matrix<double> exact(rows, columns, 0.0);
+    for(size_t i = 0; i < rows; ++i){
+        std::copy(m[i].begin(), m[i].end(), exact[i].begin());
+    }
+    const std::string size = std::string(" ") + std::to_string(rows) + "x" + std::to_string(columns) + " k=" + std::to_string(rank);
+
+    SVD<float> single;
+    double seconds = MeasureSeconds([&]{
+        single = CalculateSVD<float>(m, rank, 1e-6f);
+    }, 1);
+    PrintAccuracy("CalculateSVD float" + size, seconds, ResidualError(DenseOperator<double>(exact), single));
+    SVD<double> res;
+    seconds = MeasureSeconds([&]{
+        res = CalculateSVD<double>(exact, rank, 1e-10);
+    }, 1);
+    PrintAccuracy("CalculateSVD double" + size, seconds, ResidualError(DenseOperator<double>(exact), res));
+    for(size_t steps : {0, 1, 2}){
+        seconds = MeasureSeconds([&]{
+            res = CalculateMixedSVD(m, rank, 1e-10, steps);
+        }, 1);
+        PrintAccuracy("CalculateMixedSVD r=" + std::to_string(steps) + size, seconds, ResidualError(DenseOperator<double>(exact), res));
+    }
+}
+
+// CSR input with density nonzeros per element, columns scaled so that the spectrum decays. The power
+// iteration and Lanczos apply the sparse operator directly, the dense run needs the expanded copy.
+template <typename T>
+void BenchSparse(const std::string& type_name, const size_t rows, const size_t columns, const double density,
+    const size_t rank){
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> uniform;
+    std::normal_distribution<double> normal;
+    std::vector<size_t> offsets(1, 0), indices;
+    std::vector<T> values;
+    for(size_t i = 0; i < rows; ++i){
+        for(size_t j = 0; j < columns; ++j){
+            if(uniform(generator) < density){
+                indices.push_back(j);
+                values.push_back(static_cast<T>(normal(generator) * std::exp(-double(j) / 50)));
+            }
+        }
+        offsets.push_back(indices.size());
+    }
+    const SparseMatrix<T> sparse(rows, columns, std::move(offsets), std::move(indices), std::move(values));
+    const SparseOperator<T> op(sparse);
+    const std::string size = " " + type_name + " " + std::to_string(rows) + "x" + std::to_string(columns)
+        + " nnz=" + std::to_string(sparse.NonZeros()) + " k=" + std::to_string(rank);
+
+    SVD<T> res;
+    double seconds = MeasureSeconds([&]{
+        res = CalculateSVD<T>(op, rank, T(1e-4));
+    }, 1);
+    PrintAccuracy("CalculateSVD sparse" + size, seconds, ResidualError(op, res));
+    seconds = MeasureSeconds([&]{
+        res = CalculateLanczosSVD<T>(op, rank, T(1e-6));
+    }, 1);
+    PrintAccuracy("CalculateLanczosSVD sparse" + size, seconds, ResidualError(op, res));
+    const Matrix<T> dense = sparse.ToDense();
+    seconds = MeasureSeconds([&]{
+        res = CalculateSVD<T>(dense, rank, T(1e-4));
+    }, 1);
+    PrintAccuracy("CalculateSVD dense" + size, seconds, ResidualError(op, res));
+}
+
+int main(){
+    BenchSVD<float>("float", 20000, 300, 20);
+    BenchSVD<double>("double", 20000, 300, 20);
+    BenchSVD<float>("float", 10000, 1500, 20);
+    BenchSVD<double>("double", 10000, 1500, 20);
+    BenchIncremental<double>("double", 20000, 300, 20, 200);
+    BenchStreaming<double>("double", 20000, 300, 20, size_t(32) << 20);
+    BenchMixed(20000, 300, 20);
+    BenchSparse<double>("double", 20000, 1000, 0.01, 10);
+}
@@ -0,0 +1,50 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "symmetric_matrix.h"
+#include "thread_pool.h"
+#include "svd.h"
+
+#include <string>
+#include <thread>
+#include <algorithm>
+
+template <typename T>
+void BenchThreads(const std::string& type_name, const size_t num_threads){
+    const std::string suffix = " " + type_name + " threads=" + std::to_string(num_threads);
+    {
+        const size_t n = 1024;
+        Matrix<T> lhs = RandomMatrix<T>(n, n, 1), rhs = RandomMatrix<T>(n, n, 2);
+        double seconds = MeasureSeconds([&]{
+            Matrix<T> res = lhs * rhs;
+        });
+        PrintResult("A * B 1024" + suffix, seconds, 2.0 * n * n * n);
+    }
+    {
+        Matrix<T> m = RandomMatrix<T>(4000, 500);
+        double seconds = MeasureSeconds([&]{
+            SymmetricMatrix<T> res = GramColumns(m);
+        });
+        PrintResult("GramColumns 4000x500" + suffix, seconds, 4000.0 * 500 * 500);
+        seconds = MeasureSeconds([&]{
+            SVD<T> res = CalculateSVD<T>(m, 5, 1e-4);
+        }, 1);
+        PrintResult("CalculateSVD 4000x500 k=5" + suffix, seconds);
+    }
+    {
+        Matrix<T> a = RandomMatrix<T>(2048, 2048, 1), b = RandomMatrix<T>(2048, 2048, 2);
+        Matrix<T> res = a;
+        double seconds = MeasureSeconds([&]{
+            res = a * T(2) - b + res * T(0.5);
+        });
+        PrintResult("a * 2 - b + res * 0.5 2048" + suffix, seconds);
+    }
+}
+
+int main(){
+    const size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for(size_t threads = 1; threads <= max_threads; threads *= 2){
+        SetNumThreads(threads);
+        BenchThreads<float>("float", threads);
+        BenchThreads<double>("double", threads);
+    }
+}
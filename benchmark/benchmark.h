@@ -0,0 +1,44 @@
+#pragma once
+
+#include "matrix.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <limits>
+
+template <typename Func>
+double MeasureSeconds(Func&& func, const size_t repeats = 3){
+    double best = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < repeats; ++i){
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+template <typename T>
+Matrix<T> RandomMatrix(const size_t num_row, const size_t size_row, const unsigned seed = 42){
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform_dist(-1, 1);
+    Matrix<T> res(num_row, size_row, T());
+    for(size_t i = 0; i < num_row; ++i){
+        for(size_t j = 0; j < size_row; ++j){
+            res[i][j] = static_cast<T>(uniform_dist(generator));
+        }
+    }
+    return res;
+}
+
+inline void PrintResult(const std::string& name, const double seconds, const double flops = 0){
+    std::cout << std::left << std::setw(40) << name 
+        << std::right << std::setw(12) << std::fixed << std::setprecision(3) << seconds * 1e3 << " ms";
+    if(flops > 0){
+        std::cout << std::setw(12) << std::setprecision(2) << flops / seconds * 1e-9 << " GFLOP/s";
+    }
+    std::cout << '\n';
+}
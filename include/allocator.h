@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <limits>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <memory_resource>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+inline constexpr size_t MATRIX_ALIGNMENT = 64;
+inline constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+// Every resource below hands out memory aligned to at least MATRIX_ALIGNMENT.
+
+// Aligned operator new / delete, the default resource
+class AlignedResource final : public std::pmr::memory_resource{
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+// Bump allocator for scratch buffers that die together. Deallocation is a no-op, the memory
+// goes back to the upstream resource on Release() or destruction. Not thread-safe.
+class ArenaResource final : public std::pmr::memory_resource{
+public:
+    explicit ArenaResource(size_t block_bytes = size_t(1) << 20, std::pmr::memory_resource* upstream = nullptr);
+    ~ArenaResource() override;
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Bytes handed out since construction or the last Release()
+    size_t Used() const noexcept;
+    void Release() noexcept;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    struct Block{
+        void* data;
+        size_t bytes;
+    };
+
+    std::pmr::memory_resource* upstream_;
+    std::vector<Block> blocks_;
+    size_t block_bytes_;
+    size_t used_ = 0;
+    char* cursor_ = nullptr;
+    char* end_ = nullptr;
+};
+
+// Serves requests of at least threshold bytes from anonymous mappings aligned and rounded to
+// HUGE_PAGE_SIZE and marked for transparent huge pages, smaller ones from the upstream resource.
+// Everything goes upstream where mmap is not available.
+class HugePageResource final : public std::pmr::memory_resource{
+public:
+    explicit HugePageResource(size_t threshold = HUGE_PAGE_SIZE, std::pmr::memory_resource* upstream = nullptr);
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    size_t threshold_;
+    std::pmr::memory_resource* upstream_;
+};
+
+inline AlignedResource* AlignedMemoryResource() noexcept;
+inline HugePageResource* HugePageMemoryResource() noexcept;
+
+// Resource of default constructed allocators, AlignedMemoryResource() unless replaced.
+// The default resource is used from every thread, so it has to be thread-safe.
+inline std::pmr::memory_resource* DefaultMemoryResource() noexcept;
+// Returns the previous default, nullptr restores AlignedMemoryResource()
+inline std::pmr::memory_resource* SetDefaultMemoryResource(std::pmr::memory_resource* resource) noexcept;
+
+// Allocator of all the numeric buffers. It carries the memory resource it allocates from.
+// Moves and swaps take the resource along with the buffer, while copies of a container
+// start on the default resource, so a copy never outlives the arena it came from.
+template <typename T, size_t Alignment = MATRIX_ALIGNMENT>
+class AlignedAllocator{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind{
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept;
+    AlignedAllocator(std::pmr::memory_resource* resource) noexcept;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>& other) noexcept;
+
+    T* allocate(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+
+    AlignedAllocator select_on_container_copy_construction() const noexcept;
+
+    std::pmr::memory_resource* Resource() const noexcept;
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>& other) const noexcept{
+        return (resource_ == other.Resource()) || resource_->is_equal(*other.Resource());
+    }
+
+private:
+    static constexpr size_t ALIGNMENT = std::max(Alignment, alignof(T));
+
+    std::pmr::memory_resource* resource_;
+};
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+inline void* AlignedResource::do_allocate(size_t bytes, size_t alignment){
+    return ::operator new(bytes, std::align_val_t(std::max(alignment, MATRIX_ALIGNMENT)));
+}
+
+inline void AlignedResource::do_deallocate(void* p, size_t bytes, size_t alignment){
+    ::operator delete(p, bytes, std::align_val_t(std::max(alignment, MATRIX_ALIGNMENT)));
+}
+
+inline bool AlignedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept{
+    return dynamic_cast<const AlignedResource*>(&other) != nullptr;
+}
+
+
+inline ArenaResource::ArenaResource(size_t block_bytes, std::pmr::memory_resource* upstream)
+    : upstream_(upstream ? upstream : AlignedMemoryResource()), block_bytes_(std::max(block_bytes, MATRIX_ALIGNMENT)){}
+
+inline ArenaResource::~ArenaResource(){
+    Release();
+}
+
+inline size_t ArenaResource::Used() const noexcept{
+    return used_;
+}
+
+inline void ArenaResource::Release() noexcept{
+    for(const Block& block : blocks_){
+        upstream_->deallocate(block.data, block.bytes, MATRIX_ALIGNMENT);
+    }
+    blocks_.clear();
+    used_ = 0;
+    cursor_ = end_ = nullptr;
+}
+
+inline void* ArenaResource::do_allocate(size_t bytes, size_t alignment){
+    alignment = std::max(alignment, MATRIX_ALIGNMENT);
+    auto aligned = [alignment](char* p){
+        return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+    };
+    char* begin = aligned(cursor_);
+    if((cursor_ == nullptr) || (begin > end_) || (size_t(end_ - begin) < bytes)){
+        // Blocks grow geometrically so that a long run of requests needs few upstream calls
+        const size_t block_bytes = std::max(block_bytes_, bytes + alignment);
+        void* data = upstream_->allocate(block_bytes, MATRIX_ALIGNMENT);
+        blocks_.push_back({data, block_bytes});
+        block_bytes_ = std::max(block_bytes_, block_bytes) * 2;
+        cursor_ = static_cast<char*>(data);
+        end_ = cursor_ + block_bytes;
+        begin = aligned(cursor_);
+    }
+    cursor_ = begin + bytes;
+    used_ += bytes;
+    return begin;
+}
+
+inline void ArenaResource::do_deallocate(void*, size_t, size_t){}
+
+inline bool ArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept{
+    return this == &other;
+}
+
+
+inline HugePageResource::HugePageResource(size_t threshold, std::pmr::memory_resource* upstream)
+    : threshold_(threshold), upstream_(upstream ? upstream : AlignedMemoryResource()){}
+
+inline void* HugePageResource::do_allocate(size_t bytes, size_t alignment){
+#if defined(__linux__)
+    if((bytes >= threshold_) && (alignment <= HUGE_PAGE_SIZE)){
+        // Over-map by one huge page and trim both ends, so the kernel can back the range with huge pages
+        const size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void* raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED){
+            throw std::bad_alloc();
+        }
+        char* begin = static_cast<char*>(raw);
+        char* data = reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(begin) + HUGE_PAGE_SIZE - 1) & ~(uintptr_t(HUGE_PAGE_SIZE) - 1));
+        if(data != begin){
+            munmap(begin, data - begin);
+        }
+        if(data + size != begin + size + HUGE_PAGE_SIZE){
+            munmap(data + size, begin + size + HUGE_PAGE_SIZE - (data + size));
+        }
+#if defined(MADV_HUGEPAGE)
+        madvise(data, size, MADV_HUGEPAGE);
+#endif
+        return data;
+    }
+#endif
+    return upstream_->allocate(bytes, alignment);
+}
+
+inline void HugePageResource::do_deallocate(void* p, size_t bytes, size_t alignment){
+#if defined(__linux__)
+    if((bytes >= threshold_) && (alignment <= HUGE_PAGE_SIZE)){
+        munmap(p, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+        return;
+    }
+#endif
+    upstream_->deallocate(p, bytes, alignment);
+}
+
+inline bool HugePageResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept{
+    const HugePageResource* huge = dynamic_cast<const HugePageResource*>(&other);
+    return (huge != nullptr) && (huge->threshold_ == threshold_) && upstream_->is_equal(*huge->upstream_);
+}
+
+
+inline AlignedResource* AlignedMemoryResource() noexcept{
+    static AlignedResource resource;
+    return &resource;
+}
+
+inline HugePageResource* HugePageMemoryResource() noexcept{
+    static HugePageResource resource;
+    return &resource;
+}
+
+namespace allocator_detail{
+
+inline std::atomic<std::pmr::memory_resource*>& DefaultResource() noexcept{
+    static std::atomic<std::pmr::memory_resource*> resource = AlignedMemoryResource();
+    return resource;
+}
+
+} // namespace allocator_detail
+
+inline std::pmr::memory_resource* DefaultMemoryResource() noexcept{
+    return allocator_detail::DefaultResource().load(std::memory_order_acquire);
+}
+
+inline std::pmr::memory_resource* SetDefaultMemoryResource(std::pmr::memory_resource* resource) noexcept{
+    return allocator_detail::DefaultResource().exchange(resource ? resource : AlignedMemoryResource(),
+        std::memory_order_acq_rel);
+}
+
+
+template <typename T, size_t Alignment>
+AlignedAllocator<T, Alignment>::AlignedAllocator() noexcept
+    : resource_(DefaultMemoryResource()){}
+
+template <typename T, size_t Alignment>
+AlignedAllocator<T, Alignment>::AlignedAllocator(std::pmr::memory_resource* resource) noexcept
+    : resource_(resource ? resource : DefaultMemoryResource()){}
+
+template <typename T, size_t Alignment>
+template <typename U>
+AlignedAllocator<T, Alignment>::AlignedAllocator(const AlignedAllocator<U, Alignment>& other) noexcept
+    : resource_(other.Resource()){}
+
+template <typename T, size_t Alignment>
+T* AlignedAllocator<T, Alignment>::allocate(size_t n){
+    if(n > std::numeric_limits<size_t>::max() / sizeof(T)){
+        throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(resource_->allocate(n * sizeof(T), ALIGNMENT));
+}
+
+template <typename T, size_t Alignment>
+void AlignedAllocator<T, Alignment>::deallocate(T* p, size_t n) noexcept{
+    resource_->deallocate(p, n * sizeof(T), ALIGNMENT);
+}
+
+template <typename T, size_t Alignment>
+AlignedAllocator<T, Alignment> AlignedAllocator<T, Alignment>::select_on_container_copy_construction() const noexcept{
+    return AlignedAllocator();
+}
+
+template <typename T, size_t Alignment>
+std::pmr::memory_resource* AlignedAllocator<T, Alignment>::Resource() const noexcept{
+    return resource_;
+}
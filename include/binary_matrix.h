@@ -0,0 +1,684 @@
+#pragma once
+
+#include "matrix.h"
+#include "dense_vector.h"
+#include "sparse_matrix.h"
+#include "svd.h"
+#include "gemm.h"
+#include "allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <limits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Binary container of dense and CSR matrices. A file is a sequence of entries, each a 64 byte
+// header (dtype, shape, layout, alignment) followed by its arrays: the values of a dense entry in
+// row or column major order, or the row offsets, column indices (both uint64) and values of a CSR
+// entry. Every array starts at a multiple of the alignment from the start of the file and values
+// are little endian, so a mapped file is used in place: the views below never copy it.
+
+enum class BinaryType : uint8_t{
+    FLOAT32 = 1,
+    FLOAT64 = 2
+};
+
+enum class BinaryLayout : uint8_t{
+    ROW_MAJOR = 0,
+    COLUMN_MAJOR = 1,
+    CSR = 2
+};
+
+// Read-only mapping of a whole file, unmapped on destruction
+class MappedFile{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+
+    const char* Data() const noexcept;
+    size_t Size() const noexcept;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    // Where mmap is not available the file is read into this buffer instead
+    std::vector<char, AlignedAllocator<char>> buffer_;
+};
+
+// Read-only dense matrix over memory it does not own, in either layout
+template <typename T>
+class MatrixView{
+public:
+    using value_type = T;
+
+    MatrixView(const T* data, const size_t size_column, const size_t size_row, const bool column_major = false) noexcept;
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+    bool ColumnMajor() const noexcept;
+    const T* Data() const noexcept;
+
+    const T& operator()(size_t i, size_t j) const noexcept;
+    GemmOperand<T> Operand() const noexcept;
+
+    // A LinearOperator, so the SVD engines run on the view directly
+    void Apply(const T* x, T* y) const;
+    void ApplyTransposed(const T* x, T* y) const;
+
+    Matrix<T> ToMatrix(const AlignedAllocator<T>& alloc = AlignedAllocator<T>()) const;
+
+private:
+    const T* data_;
+    size_t size_column_;
+    size_t size_row_;
+    bool column_major_;
+};
+
+// Read-only CSR matrix over arrays it does not own
+template <typename T>
+class SparseView{
+public:
+    using value_type = T;
+
+    SparseView(const size_t size_column, const size_t size_row, const size_t* row_offsets, const size_t* columns,
+        const T* values) noexcept;
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+    size_t NonZeros() const noexcept;
+    const size_t* RowOffsets() const noexcept;
+    const size_t* Columns() const noexcept;
+    const T* Values() const noexcept;
+
+    void Apply(const T* x, T* y) const;
+    void ApplyTransposed(const T* x, T* y) const;
+
+    SparseMatrix<T> ToSparse() const;
+
+private:
+    size_t size_column_;
+    size_t size_row_;
+    const size_t* row_offsets_;
+    const size_t* columns_;
+    const T* values_;
+};
+
+// The singular triplets of a file written by SaveSVD, the values as a 1 x k row
+template <typename T>
+struct SVDView{
+    MatrixView<T> left_singular_vectors;
+    MatrixView<T> singular_values;
+    MatrixView<T> right_singular_vectors;
+};
+
+namespace binary_detail{
+
+inline constexpr char MAGIC[4] = {'S', 'V', 'D', 'B'};
+inline constexpr uint16_t VERSION = 1;
+inline constexpr size_t HEADER_BYTES = 64;
+
+struct Header{
+    char magic[4];
+    uint16_t version;
+    BinaryType type;
+    BinaryLayout layout;
+    uint32_t alignment;
+    uint32_t reserved;
+    uint64_t rows;
+    uint64_t columns;
+    // CSR only
+    uint64_t non_zeros;
+    // Header, arrays and padding: the next entry starts this many bytes after this one
+    uint64_t entry_bytes;
+    uint64_t unused[2];
+};
+static_assert(sizeof(Header) == HEADER_BYTES);
+static_assert(sizeof(size_t) == sizeof(uint64_t), "CSR indices are mapped as size_t");
+
+template <typename T>
+constexpr BinaryType TypeOf() noexcept;
+
+inline size_t AlignUp(size_t bytes, size_t alignment) noexcept;
+
+// lhs * rhs and lhs + rhs of sizes read from a header, throwing instead of wrapping around
+inline size_t MultiplySizes(size_t lhs, size_t rhs);
+inline size_t AddSizes(size_t lhs, size_t rhs);
+
+// Offsets of the arrays of an entry from its header, the last one is the end of the data.
+// Throws when a size of the header makes them overflow.
+inline std::vector<size_t> ArrayOffsets(const Header& header);
+
+// Checks the mapped CSR arrays of an entry once, so the products of a view stay in bounds:
+// nondecreasing offsets from 0 to non_zeros and every column below the row length
+inline void CheckCSR(const char* entry, const Header& header);
+
+inline void CheckEndian();
+
+} // namespace binary_detail
+
+// Entries of a mapped container
+class BinaryFile{
+public:
+    explicit BinaryFile(const std::string& path);
+
+    size_t Count() const noexcept;
+    BinaryType Type(size_t index) const;
+    BinaryLayout Layout(size_t index) const;
+
+    // Zero copy views of the entry, valid while the file is alive. Throw if the entry holds
+    // another type or layout.
+    template <typename T>
+    MatrixView<T> Dense(size_t index) const;
+    template <typename T>
+    SparseView<T> Sparse(size_t index) const;
+
+private:
+    const binary_detail::Header& Entry(size_t index) const;
+    template <typename T>
+    void CheckType(size_t index) const;
+
+    MappedFile file_;
+    std::vector<binary_detail::Header> headers_;
+    std::vector<size_t> offsets_;
+};
+
+// Appends entries to a binary stream
+class BinaryWriter{
+public:
+    explicit BinaryWriter(std::ostream& output);
+
+    template <typename T>
+    void Write(const Matrix<T>& mat);
+    template <typename T>
+    void Write(const MatrixView<T>& view);
+    template <typename T>
+    void Write(const SparseMatrix<T>& mat);
+
+private:
+    void WriteHeader(binary_detail::Header header);
+    void WriteArray(const void* data, size_t bytes);
+    void Pad(size_t bytes);
+
+    std::ostream& output_;
+    // Bytes written for the current entry
+    size_t written_ = 0;
+};
+
+// Single entry files
+template <typename T>
+void SaveBinary(const std::string& path, const Matrix<T>& mat);
+template <typename T>
+void SaveBinary(const std::string& path, const SparseMatrix<T>& mat);
+
+// U, the singular values and V as three entries
+template <typename T>
+void SaveSVD(const std::string& path, const SVD<T>& svd);
+template <typename T>
+SVDView<T> ViewSVD(const BinaryFile& file);
+template <typename T>
+SVD<T> LoadSVD(const std::string& path);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+inline MappedFile::MappedFile(const std::string& path){
+#if defined(__linux__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw std::invalid_argument("The file cannot be opened: " + path);
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        close(fd);
+        throw std::invalid_argument("The file cannot be opened: " + path);
+    }
+    size_ = size_t(info.st_size);
+    if(size_){
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED){
+            close(fd);
+            throw std::invalid_argument("The file cannot be mapped: " + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+#else
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+    if(!input){
+        throw std::invalid_argument("The file cannot be opened: " + path);
+    }
+    size_ = size_t(input.tellg());
+    buffer_.resize(size_);
+    input.seekg(0);
+    input.read(buffer_.data(), std::streamsize(size_));
+    data_ = buffer_.data();
+#endif
+}
+
+inline MappedFile::~MappedFile(){
+#if defined(__linux__)
+    if(data_ && size_){
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+inline MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , buffer_(std::move(other.buffer_)){}
+
+inline const char* MappedFile::Data() const noexcept{
+    return data_;
+}
+
+inline size_t MappedFile::Size() const noexcept{
+    return size_;
+}
+
+template <typename T>
+MatrixView<T>::MatrixView(const T* data, const size_t size_column, const size_t size_row, const bool column_major) noexcept
+    : data_(data)
+    , size_column_(size_column)
+    , size_row_(size_row)
+    , column_major_(column_major){}
+
+template <typename T>
+size_t MatrixView<T>::SizeRow() const noexcept{
+    return size_row_;
+}
+
+template <typename T>
+size_t MatrixView<T>::SizeColumn() const noexcept{
+    return size_column_;
+}
+
+template <typename T>
+bool MatrixView<T>::ColumnMajor() const noexcept{
+    return column_major_;
+}
+
+template <typename T>
+const T* MatrixView<T>::Data() const noexcept{
+    return data_;
+}
+
+template <typename T>
+const T& MatrixView<T>::operator()(size_t i, size_t j) const noexcept{
+    return column_major_ ? data_[j * size_column_ + i] : data_[i * size_row_ + j];
+}
+
+template <typename T>
+GemmOperand<T> MatrixView<T>::Operand() const noexcept{
+    return column_major_ ? GemmOperand<T>{data_, 1, size_column_} : GemmOperand<T>{data_, size_row_, 1};
+}
+
+template <typename T>
+void MatrixView<T>::Apply(const T* x, T* y) const{
+    Gemv<T>(size_column_, size_row_, Operand(), x, y);
+}
+
+template <typename T>
+void MatrixView<T>::ApplyTransposed(const T* x, T* y) const{
+    const GemmOperand<T> a = Operand();
+    Gemv<T>(size_row_, size_column_, {a.data, a.col_stride, a.row_stride}, x, y);
+}
+
+template <typename T>
+Matrix<T> MatrixView<T>::ToMatrix(const AlignedAllocator<T>& alloc) const{
+    Matrix<T> res(size_column_, size_row_, T(), alloc);
+    if(column_major_){
+        matrix_detail::TransposeBlock(data_, size_column_, res.Data(), res.Stride(), size_row_, size_column_);
+        return res;
+    }
+    for(size_t i = 0; i < size_column_; ++i){
+        std::copy(data_ + i * size_row_, data_ + (i + 1) * size_row_, res[i].begin());
+    }
+    return res;
+}
+
+template <typename T>
+SparseView<T>::SparseView(const size_t size_column, const size_t size_row, const size_t* row_offsets,
+    const size_t* columns, const T* values) noexcept
+    : size_column_(size_column)
+    , size_row_(size_row)
+    , row_offsets_(row_offsets)
+    , columns_(columns)
+    , values_(values){}
+
+template <typename T>
+size_t SparseView<T>::SizeRow() const noexcept{
+    return size_row_;
+}
+
+template <typename T>
+size_t SparseView<T>::SizeColumn() const noexcept{
+    return size_column_;
+}
+
+template <typename T>
+size_t SparseView<T>::NonZeros() const noexcept{
+    return row_offsets_[size_column_];
+}
+
+template <typename T>
+const size_t* SparseView<T>::RowOffsets() const noexcept{
+    return row_offsets_;
+}
+
+template <typename T>
+const size_t* SparseView<T>::Columns() const noexcept{
+    return columns_;
+}
+
+template <typename T>
+const T* SparseView<T>::Values() const noexcept{
+    return values_;
+}
+
+template <typename T>
+void SparseView<T>::Apply(const T* x, T* y) const{
+    sparse_detail::MultiplyVector(size_column_, row_offsets_, columns_, values_, x, y);
+}
+
+template <typename T>
+void SparseView<T>::ApplyTransposed(const T* x, T* y) const{
+    sparse_detail::MultiplyTransposedVector(size_column_, size_row_, row_offsets_, columns_, values_, x, y);
+}
+
+template <typename T>
+SparseMatrix<T> SparseView<T>::ToSparse() const{
+    return SparseMatrix<T>(size_column_, size_row_, std::vector<size_t>(row_offsets_, row_offsets_ + size_column_ + 1),
+        std::vector<size_t>(columns_, columns_ + NonZeros()), std::vector<T>(values_, values_ + NonZeros()));
+}
+
+namespace binary_detail{
+
+template <typename T>
+constexpr BinaryType TypeOf() noexcept{
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "Only float and double are stored");
+    return std::is_same_v<T, float> ? BinaryType::FLOAT32 : BinaryType::FLOAT64;
+}
+
+inline size_t AlignUp(size_t bytes, size_t alignment) noexcept{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+inline size_t MultiplySizes(size_t lhs, size_t rhs){
+    if(rhs && (lhs > std::numeric_limits<size_t>::max() / rhs)){
+        throw std::invalid_argument("The binary file has an incorrect entry");
+    }
+    return lhs * rhs;
+}
+
+inline size_t AddSizes(size_t lhs, size_t rhs){
+    if(lhs > std::numeric_limits<size_t>::max() - rhs){
+        throw std::invalid_argument("The binary file has an incorrect entry");
+    }
+    return lhs + rhs;
+}
+
+inline std::vector<size_t> ArrayOffsets(const Header& header){
+    const size_t value_bytes = (header.type == BinaryType::FLOAT32) ? sizeof(float) : sizeof(double);
+    // Rounding up adds less than the alignment, which the sums leave room for
+    const auto aligned_end = [&header](size_t begin, size_t bytes){
+        return AlignUp(AddSizes(AddSizes(begin, bytes), header.alignment), header.alignment) - header.alignment;
+    };
+    std::vector<size_t> res{AlignUp(HEADER_BYTES, header.alignment)};
+    if(header.layout == BinaryLayout::CSR){
+        res.push_back(aligned_end(res.back(), MultiplySizes(AddSizes(header.rows, 1), sizeof(uint64_t))));
+        res.push_back(aligned_end(res.back(), MultiplySizes(header.non_zeros, sizeof(uint64_t))));
+        res.push_back(AddSizes(res.back(), MultiplySizes(header.non_zeros, value_bytes)));
+    }
+    else{
+        res.push_back(AddSizes(res.back(), MultiplySizes(MultiplySizes(header.rows, header.columns), value_bytes)));
+    }
+    return res;
+}
+
+inline void CheckCSR(const char* entry, const Header& header){
+    const std::vector<size_t> arrays = ArrayOffsets(header);
+    const size_t* offsets = reinterpret_cast<const size_t*>(entry + arrays[0]);
+    const size_t* columns = reinterpret_cast<const size_t*>(entry + arrays[1]);
+    bool correct = (offsets[0] == 0) && (offsets[header.rows] == header.non_zeros);
+    for(size_t i = 0; correct && (i < header.rows); ++i){
+        correct = (offsets[i] <= offsets[i + 1]);
+    }
+    for(size_t j = 0; correct && (j < header.non_zeros); ++j){
+        correct = (columns[j] < header.columns);
+    }
+    if(!correct){
+        throw std::invalid_argument("The binary file has an incorrect entry");
+    }
+}
+
+inline void CheckEndian(){
+    if constexpr(std::endian::native != std::endian::little){
+        throw std::invalid_argument("The binary format is little endian only");
+    }
+}
+
+} // namespace binary_detail
+
+inline BinaryFile::BinaryFile(const std::string& path)
+    : file_(path){
+    binary_detail::CheckEndian();
+    for(size_t offset = 0; offset < file_.Size(); ){
+        binary_detail::Header header;
+        if(file_.Size() - offset < sizeof(header)){
+            throw std::invalid_argument("The binary file is truncated");
+        }
+        std::memcpy(&header, file_.Data() + offset, sizeof(header));
+        if(std::memcmp(header.magic, binary_detail::MAGIC, sizeof(header.magic)) || (header.version != binary_detail::VERSION)){
+            throw std::invalid_argument("The binary file has an unknown format");
+        }
+        if((header.alignment < alignof(double)) || (header.alignment & (header.alignment - 1))
+            || ((header.type != BinaryType::FLOAT32) && (header.type != BinaryType::FLOAT64))
+            || (header.layout > BinaryLayout::CSR) || (offset % header.alignment)
+            || (binary_detail::ArrayOffsets(header).back() > header.entry_bytes)
+            || (header.entry_bytes > file_.Size() - offset)){
+            throw std::invalid_argument("The binary file has an incorrect entry");
+        }
+        if(header.layout == BinaryLayout::CSR){
+            binary_detail::CheckCSR(file_.Data() + offset, header);
+        }
+        headers_.push_back(header);
+        offsets_.push_back(offset);
+        offset += header.entry_bytes;
+    }
+}
+
+inline size_t BinaryFile::Count() const noexcept{
+    return headers_.size();
+}
+
+inline const binary_detail::Header& BinaryFile::Entry(size_t index) const{
+    if(index >= headers_.size()){
+        throw std::invalid_argument("The binary file has no such entry");
+    }
+    return headers_[index];
+}
+
+inline BinaryType BinaryFile::Type(size_t index) const{
+    return Entry(index).type;
+}
+
+inline BinaryLayout BinaryFile::Layout(size_t index) const{
+    return Entry(index).layout;
+}
+
+template <typename T>
+void BinaryFile::CheckType(size_t index) const{
+    if(Entry(index).type != binary_detail::TypeOf<T>()){
+        throw std::invalid_argument("The binary entry holds another type");
+    }
+}
+
+template <typename T>
+MatrixView<T> BinaryFile::Dense(size_t index) const{
+    CheckType<T>(index);
+    const binary_detail::Header& header = headers_[index];
+    if(header.layout == BinaryLayout::CSR){
+        throw std::invalid_argument("The binary entry is sparse");
+    }
+    const char* entry = file_.Data() + offsets_[index];
+    return MatrixView<T>(reinterpret_cast<const T*>(entry + binary_detail::ArrayOffsets(header)[0]),
+        header.rows, header.columns, header.layout == BinaryLayout::COLUMN_MAJOR);
+}
+
+template <typename T>
+SparseView<T> BinaryFile::Sparse(size_t index) const{
+    CheckType<T>(index);
+    const binary_detail::Header& header = headers_[index];
+    if(header.layout != BinaryLayout::CSR){
+        throw std::invalid_argument("The binary entry is dense");
+    }
+    const char* entry = file_.Data() + offsets_[index];
+    const std::vector<size_t> arrays = binary_detail::ArrayOffsets(header);
+    // The arrays were checked when the file was opened
+    return SparseView<T>(header.rows, header.columns, reinterpret_cast<const size_t*>(entry + arrays[0]),
+        reinterpret_cast<const size_t*>(entry + arrays[1]), reinterpret_cast<const T*>(entry + arrays[2]));
+}
+
+inline BinaryWriter::BinaryWriter(std::ostream& output)
+    : output_(output){
+    binary_detail::CheckEndian();
+}
+
+inline void BinaryWriter::WriteHeader(binary_detail::Header header){
+    std::memcpy(header.magic, binary_detail::MAGIC, sizeof(header.magic));
+    header.version = binary_detail::VERSION;
+    header.alignment = MATRIX_ALIGNMENT;
+    header.reserved = 0;
+    header.unused[0] = header.unused[1] = 0;
+    header.entry_bytes = binary_detail::AlignUp(binary_detail::ArrayOffsets(header).back(), MATRIX_ALIGNMENT);
+    output_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    written_ = sizeof(header);
+}
+
+inline void BinaryWriter::WriteArray(const void* data, size_t bytes){
+    Pad(binary_detail::AlignUp(written_, MATRIX_ALIGNMENT) - written_);
+    output_.write(static_cast<const char*>(data), std::streamsize(bytes));
+    written_ += bytes;
+}
+
+inline void BinaryWriter::Pad(size_t bytes){
+    static constexpr char zeros[MATRIX_ALIGNMENT] = {};
+    output_.write(zeros, std::streamsize(bytes));
+    written_ += bytes;
+}
+
+template <typename T>
+void BinaryWriter::Write(const Matrix<T>& mat){
+    if(!mat.Correct() && (mat.SizeColumn() != 0)){
+        throw std::invalid_argument("The matrix is incorrect for writing");
+    }
+    const size_t columns = mat.SizeColumn() ? mat.SizeRow() : 0;
+    WriteHeader({{}, 0, binary_detail::TypeOf<T>(), BinaryLayout::ROW_MAJOR, 0, 0, mat.SizeColumn(), columns, 0, 0, {}});
+    Pad(binary_detail::AlignUp(written_, MATRIX_ALIGNMENT) - written_);
+    for(size_t i = 0; i < mat.SizeColumn(); ++i){
+        output_.write(reinterpret_cast<const char*>(mat[i].data()), std::streamsize(columns * sizeof(T)));
+        written_ += columns * sizeof(T);
+    }
+    Pad(binary_detail::AlignUp(written_, MATRIX_ALIGNMENT) - written_);
+}
+
+template <typename T>
+void BinaryWriter::Write(const MatrixView<T>& view){
+    const BinaryLayout layout = view.ColumnMajor() ? BinaryLayout::COLUMN_MAJOR : BinaryLayout::ROW_MAJOR;
+    WriteHeader({{}, 0, binary_detail::TypeOf<T>(), layout, 0, 0, view.SizeColumn(), view.SizeRow(), 0, 0, {}});
+    WriteArray(view.Data(), view.SizeColumn() * view.SizeRow() * sizeof(T));
+    Pad(binary_detail::AlignUp(written_, MATRIX_ALIGNMENT) - written_);
+}
+
+template <typename T>
+void BinaryWriter::Write(const SparseMatrix<T>& mat){
+    WriteHeader({{}, 0, binary_detail::TypeOf<T>(), BinaryLayout::CSR, 0, 0, mat.SizeColumn(), mat.SizeRow(),
+        mat.NonZeros(), 0, {}});
+    WriteArray(mat.RowOffsets().data(), mat.RowOffsets().size() * sizeof(size_t));
+    WriteArray(mat.Columns().data(), mat.NonZeros() * sizeof(size_t));
+    WriteArray(mat.Values().data(), mat.NonZeros() * sizeof(T));
+    Pad(binary_detail::AlignUp(written_, MATRIX_ALIGNMENT) - written_);
+}
+
+template <typename T>
+void SaveBinary(const std::string& path, const Matrix<T>& mat){
+    std::ofstream output(path, std::ios::binary);
+    BinaryWriter(output).Write(mat);
+    if(!output){
+        throw std::invalid_argument("The file cannot be written: " + path);
+    }
+}
+
+template <typename T>
+void SaveBinary(const std::string& path, const SparseMatrix<T>& mat){
+    std::ofstream output(path, std::ios::binary);
+    BinaryWriter(output).Write(mat);
+    if(!output){
+        throw std::invalid_argument("The file cannot be written: " + path);
+    }
+}
+
+template <typename T>
+void SaveSVD(const std::string& path, const SVD<T>& svd){
+    const size_t count = svd.eigenvalues.SizeColumn();
+    Matrix<T> values(1, std::max<size_t>(count, 1), T());
+    for(size_t i = 0; i < count; ++i){
+        values[0][i] = svd.eigenvalues[i][i];
+    }
+    std::ofstream output(path, std::ios::binary);
+    BinaryWriter writer(output);
+    writer.Write(svd.left_singular_vectors);
+    writer.Write(MatrixView<T>(values.Data(), 1, count));
+    writer.Write(svd.right_singular_vectors);
+    if(!output){
+        throw std::invalid_argument("The file cannot be written: " + path);
+    }
+}
+
+template <typename T>
+SVDView<T> ViewSVD(const BinaryFile& file){
+    if(file.Count() != 3){
+        throw std::invalid_argument("The binary file holds no SVD");
+    }
+    return {file.Dense<T>(0), file.Dense<T>(1), file.Dense<T>(2)};
+}
+
+template <typename T>
+SVD<T> LoadSVD(const std::string& path){
+    const BinaryFile file(path);
+    const SVDView<T> view = ViewSVD<T>(file);
+    SVD<T> res;
+    const size_t count = view.singular_values.SizeRow();
+    res.eigenvalues = Matrix<T>(count, count, T());
+    for(size_t i = 0; i < count; ++i){
+        res.eigenvalues[i][i] = view.singular_values(0, i);
+    }
+    if(view.left_singular_vectors.SizeColumn()){
+        res.left_singular_vectors = view.left_singular_vectors.ToMatrix();
+    }
+    if(view.right_singular_vectors.SizeColumn()){
+        res.right_singular_vectors = view.right_singular_vectors.ToMatrix();
+    }
+    return res;
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "allocator.h"
+#include "gemm.h"
+#include "simd.h"
+#include "matrix.h"
+
+#include <vector>
+#include <ostream>
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+#include <initializer_list>
+
+// Dense column vector in one aligned buffer, the operand of the matrix-vector kernels.
+template <typename T>
+class Vector final{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using allocator_type = AlignedAllocator<T>;
+
+    explicit Vector(const size_t size = 0, const T& val = T(), const allocator_type& alloc = allocator_type());
+    Vector(std::initializer_list<T> data);
+    // Copies an n x 1 matrix
+    explicit Vector(const Matrix<T>& column);
+
+    allocator_type GetAllocator() const noexcept;
+
+    size_t Size() const noexcept;
+    bool Empty() const noexcept;
+
+    T* Data() noexcept;
+    const T* Data() const noexcept;
+
+    T& operator[](size_t index) noexcept;
+    const T& operator[](size_t index) const noexcept;
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    void Resize(size_t size);
+
+    // The vector as an n x 1 matrix
+    Matrix<T> ToMatrix(const AlignedAllocator<T>& alloc = AlignedAllocator<T>()) const;
+
+    Vector& operator+=(const Vector& other);
+    Vector& operator-=(const Vector& other);
+    Vector& operator*=(const T& other);
+    Vector& operator/=(const T& other);
+
+    bool operator==(const Vector& rhs) const;
+    bool operator!=(const Vector& rhs) const;
+
+private:
+    std::vector<T, AlignedAllocator<T>> data_;
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& output, const Vector<T>& val);
+
+template <typename T>
+Vector<T> operator+(Vector<T> lhs, const Vector<T>& rhs);
+template <typename T>
+Vector<T> operator-(Vector<T> lhs, const Vector<T>& rhs);
+template <typename T>
+Vector<T> operator*(Vector<T> lhs, const T& rhs);
+template <typename T>
+Vector<T> operator*(const T& lhs, Vector<T> rhs);
+template <typename T>
+Vector<T> operator/(Vector<T> lhs, const T& rhs);
+
+// Matrix-vector products run the streaming GEMV kernels.
+// Multiply writes into res and only allocates when res has to grow.
+template <typename T>
+void Multiply(const Matrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res);
+template <typename T>
+void Multiply(const TransposedMatrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res);
+template <typename T>
+Vector<T> operator*(const Matrix<T>& lhs, const Vector<T>& rhs);
+template <typename T>
+Vector<T> operator*(const TransposedMatrix<T>& lhs, const Vector<T>& rhs);
+
+template <typename T>
+T Norma(const Vector<T>& v);
+
+template <typename T>
+Vector<T> Normalize(const Vector<T>& v);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+template <typename T>
+Vector<T>::Vector(const size_t size, const T& val, const allocator_type& alloc)
+    : data_(size, val, alloc){}
+
+template <typename T>
+Vector<T>::Vector(std::initializer_list<T> data)
+    : data_(data){}
+
+template <typename T>
+Vector<T>::Vector(const Matrix<T>& column)
+    : data_(column.SizeColumn()){
+    if((column.SizeColumn() != 0) && (column.SizeRow() != 1)){
+        throw std::invalid_argument("The matrix is not a column");
+    }
+    for(size_t i = 0; i < Size(); ++i){
+        data_[i] = column[i][0];
+    }
+}
+
+template <typename T>
+typename Vector<T>::allocator_type Vector<T>::GetAllocator() const noexcept{
+    return data_.get_allocator();
+}
+
+template <typename T>
+size_t Vector<T>::Size() const noexcept{
+    return data_.size();
+}
+
+template <typename T>
+bool Vector<T>::Empty() const noexcept{
+    return data_.empty();
+}
+
+template <typename T>
+T* Vector<T>::Data() noexcept{
+    return data_.data();
+}
+
+template <typename T>
+const T* Vector<T>::Data() const noexcept{
+    return data_.data();
+}
+
+template <typename T>
+T& Vector<T>::operator[](size_t index) noexcept{
+    return data_[index];
+}
+
+template <typename T>
+const T& Vector<T>::operator[](size_t index) const noexcept{
+    return data_[index];
+}
+
+template <typename T>
+typename Vector<T>::iterator Vector<T>::begin() noexcept{
+    return data_.data();
+}
+
+template <typename T>
+typename Vector<T>::iterator Vector<T>::end() noexcept{
+    return data_.data() + data_.size();
+}
+
+template <typename T>
+typename Vector<T>::const_iterator Vector<T>::begin() const noexcept{
+    return data_.data();
+}
+
+template <typename T>
+typename Vector<T>::const_iterator Vector<T>::end() const noexcept{
+    return data_.data() + data_.size();
+}
+
+template <typename T>
+void Vector<T>::Resize(size_t size){
+    data_.resize(size, T());
+}
+
+template <typename T>
+Matrix<T> Vector<T>::ToMatrix(const AlignedAllocator<T>& alloc) const{
+    Matrix<T> res(Size(), 1, T(), alloc);
+    std::copy(data_.begin(), data_.end(), res.Data());
+    return res;
+}
+
+template <typename T>
+Vector<T>& Vector<T>::operator+=(const Vector& other){
+    if(Size() != other.Size()){
+        throw std::invalid_argument("The vectors are incorrect for addition");
+    }
+    SimdAdd(data_.data(), other.data_.data(), Size());
+    return *this;
+}
+
+template <typename T>
+Vector<T>& Vector<T>::operator-=(const Vector& other){
+    if(Size() != other.Size()){
+        throw std::invalid_argument("The vectors are incorrect for addition");
+    }
+    SimdSub(data_.data(), other.data_.data(), Size());
+    return *this;
+}
+
+template <typename T>
+Vector<T>& Vector<T>::operator*=(const T& other){
+    SimdScale(data_.data(), other, Size());
+    return *this;
+}
+
+template <typename T>
+Vector<T>& Vector<T>::operator/=(const T& other){
+    return *this *= T(1.0 / other);
+}
+
+template <typename T>
+bool Vector<T>::operator==(const Vector& rhs) const{
+    return data_ == rhs.data_;
+}
+
+template <typename T>
+bool Vector<T>::operator!=(const Vector& rhs) const{
+    return !(*this == rhs);
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& output, const Vector<T>& val){
+    for(size_t i = 0; i < val.Size(); ++i){
+        output << val[i] << ((i == val.Size() - 1) ? "" : "\n");
+    }
+    return output;
+}
+
+template <typename T>
+Vector<T> operator+(Vector<T> lhs, const Vector<T>& rhs){
+    return lhs += rhs;
+}
+
+template <typename T>
+Vector<T> operator-(Vector<T> lhs, const Vector<T>& rhs){
+    return lhs -= rhs;
+}
+
+template <typename T>
+Vector<T> operator*(Vector<T> lhs, const T& rhs){
+    return lhs *= rhs;
+}
+
+template <typename T>
+Vector<T> operator*(const T& lhs, Vector<T> rhs){
+    return rhs *= lhs;
+}
+
+template <typename T>
+Vector<T> operator/(Vector<T> lhs, const T& rhs){
+    return lhs /= rhs;
+}
+
+template <typename T>
+void Multiply(const Matrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res){
+    if((lhs.SizeRow() != rhs.Size()) || (lhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    res.Resize(lhs.SizeColumn());
+    Gemv<T>(lhs.SizeColumn(), lhs.SizeRow(), {lhs.Data(), lhs.Stride(), 1}, rhs.Data(), res.Data());
+}
+
+template <typename T>
+void Multiply(const TransposedMatrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res){
+    if((lhs.SizeRow() != rhs.Size()) || (lhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    res.Resize(lhs.SizeColumn());
+    Gemv<T>(lhs.SizeColumn(), lhs.SizeRow(), lhs.Operand(), rhs.Data(), res.Data());
+}
+
+template <typename T>
+Vector<T> operator*(const Matrix<T>& lhs, const Vector<T>& rhs){
+    Vector<T> res;
+    Multiply(lhs, rhs, res);
+    return res;
+}
+
+template <typename T>
+Vector<T> operator*(const TransposedMatrix<T>& lhs, const Vector<T>& rhs){
+    Vector<T> res;
+    Multiply(lhs, rhs, res);
+    return res;
+}
+
+template <typename T>
+T Norma(const Vector<T>& v){
+    return std::sqrt(SimdSumSquares(v.Data(), v.Size()));
+}
+
+template <typename T>
+Vector<T> Normalize(const Vector<T>& v){
+    return v * (T(1) / Norma(v));
+}
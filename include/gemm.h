@@ -0,0 +1,363 @@
+#pragma once
+
+#include "allocator.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+// Operand of a general matrix product: element (i, j) lives at data[i * row_stride + j * col_stride],
+// so a row-major matrix and its transpose are described by the same pointer with swapped strides.
+template <typename T>
+struct GemmOperand{
+    const T* data;
+    size_t row_stride;
+    size_t col_stride;
+
+    const T& operator()(size_t i, size_t j) const noexcept{
+        return data[i * row_stride + j * col_stride];
+    }
+};
+
+// Blocking for a micro-kernel working on VectorBytes wide registers (0 is the scalar kernel).
+// The MR x NR accumulator tile takes 12 of the 16 vector registers, or 16 of the 32 with AVX-512.
+// KC keeps one packed NR-column panel of B within 16 KiB of L1, MC keeps the packed A block within 256 KiB of L2.
+template <typename T, size_t VectorBytes>
+struct GemmBlocking{
+    static constexpr size_t LANES = (VectorBytes == 0) ? 4 : VectorBytes / sizeof(T);
+    static constexpr size_t MR = (VectorBytes == 64) ? 8 : ((VectorBytes == 0) ? 4 : 6);
+    static constexpr size_t NR = (VectorBytes == 0) ? 4 : 2 * LANES;
+    static constexpr size_t KC = std::max<size_t>(16384 / (NR * sizeof(T)), 64);
+    static constexpr size_t MC = std::max<size_t>(262144 / (KC * sizeof(T)) / MR, 1) * MR;
+    static constexpr size_t NC = 4096;
+};
+
+// C[m x n] (row-major, row stride ldc) += A[m x k] * B[k x n]
+template <typename T>
+void Gemm(size_t m, size_t n, size_t k, GemmOperand<T> a, GemmOperand<T> b, T* c, size_t ldc);
+
+// y[m] = A[m x n] * x[n] for contiguous x and y
+template <typename T>
+void Gemv(size_t m, size_t n, GemmOperand<T> a, const T* x, T* y);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace gemm_detail{
+
+template <typename T>
+std::vector<T, AlignedAllocator<T>>& PackBuffer(size_t index){
+    // The buffers live as long as the thread, so they stay off any caller's memory resource
+    thread_local std::vector<T, AlignedAllocator<T>> buffers[2] = {
+        std::vector<T, AlignedAllocator<T>>(AlignedAllocator<T>(AlignedMemoryResource())),
+        std::vector<T, AlignedAllocator<T>>(AlignedAllocator<T>(AlignedMemoryResource()))};
+    return buffers[index];
+}
+
+// Packs an mc x kc block of A into MR-row panels, each stored column by column.
+template <typename T, size_t MR>
+void PackA(size_t mc, size_t kc, GemmOperand<T> a, T* packed){
+    for(size_t i = 0; i < mc; i += MR){
+        const size_t mr = std::min(MR, mc - i);
+        for(size_t p = 0; p < kc; ++p){
+            for(size_t r = 0; r < mr; ++r){
+                packed[r] = a(i + r, p);
+            }
+            for(size_t r = mr; r < MR; ++r){
+                packed[r] = T();
+            }
+            packed += MR;
+        }
+    }
+}
+
+// Packs a kc x nc block of B into NR-column panels, each stored row by row.
+template <typename T, size_t NR>
+void PackB(size_t kc, size_t nc, GemmOperand<T> b, T* packed){
+    for(size_t j = 0; j < nc; j += NR){
+        const size_t nr = std::min(NR, nc - j);
+        for(size_t p = 0; p < kc; ++p){
+            if(b.col_stride == 1){
+                std::copy(&b(p, j), &b(p, j) + nr, packed);
+            }
+            else{
+                for(size_t r = 0; r < nr; ++r){
+                    packed[r] = b(p, j + r);
+                }
+            }
+            std::fill(packed + nr, packed + NR, T());
+            packed += NR;
+        }
+    }
+}
+
+// Multiplies an MR-row panel of A by an NR-column panel of B and adds the valid mr x nr corner to C.
+template <typename T, size_t VectorBytes>
+struct MicroKernel{
+    using Blocking = GemmBlocking<T, VectorBytes>;
+
+    [[gnu::always_inline]] static void Run(size_t kc, const T* __restrict a, const T* __restrict b,
+        T* __restrict c, size_t ldc, size_t mr, size_t nr){
+        constexpr size_t MR = Blocking::MR, NR = Blocking::NR;
+        if constexpr(VectorBytes == 0){
+            T acc[MR][NR] = {};
+            for(size_t p = 0; p < kc; ++p){
+                for(size_t i = 0; i < MR; ++i){
+                    for(size_t j = 0; j < NR; ++j){
+                        acc[i][j] += a[i] * b[j];
+                    }
+                }
+                a += MR;
+                b += NR;
+            }
+            for(size_t i = 0; i < mr; ++i){
+                for(size_t j = 0; j < nr; ++j){
+                    c[i * ldc + j] += acc[i][j];
+                }
+            }
+        }
+        else{
+            using V = simd_detail::Vector<T, VectorBytes>;
+            constexpr size_t NV = NR / V::LANES;
+            typename V::Type acc[MR][NV] = {};
+            for(size_t p = 0; p < kc; ++p){
+                typename V::Type b_vec[NV];
+                #pragma GCC unroll 16
+                for(size_t v = 0; v < NV; ++v){
+                    V::Load(b_vec[v], b + v * V::LANES);
+                }
+                #pragma GCC unroll 16
+                for(size_t i = 0; i < MR; ++i){
+                    const T a_val = a[i];
+                    #pragma GCC unroll 16
+                    for(size_t v = 0; v < NV; ++v){
+                        acc[i][v] += a_val * b_vec[v];
+                    }
+                }
+                a += MR;
+                b += NR;
+            }
+            for(size_t i = 0; i < mr; ++i){
+                for(size_t j = 0; j < nr; ++j){
+                    c[i * ldc + j] += acc[i][j / V::LANES][j % V::LANES];
+                }
+            }
+        }
+    }
+};
+
+template <typename T, size_t VectorBytes>
+void RunMicroKernel(size_t kc, const T* a, const T* b, T* c, size_t ldc, size_t mr, size_t nr){
+    MicroKernel<T, VectorBytes>::Run(kc, a, b, c, ldc, mr, nr);
+}
+
+#ifdef SVD_SIMD_X86
+template <typename T>
+[[gnu::target("avx2,fma")]] void RunMicroKernelAvx2(size_t kc, const T* a, const T* b,
+    T* c, size_t ldc, size_t mr, size_t nr){
+    MicroKernel<T, 32>::Run(kc, a, b, c, ldc, mr, nr);
+}
+
+template <typename T>
+[[gnu::target("avx512f,avx512vl,avx2,fma")]] void RunMicroKernelAvx512(size_t kc, const T* a, const T* b,
+    T* c, size_t ldc, size_t mr, size_t nr){
+    MicroKernel<T, 64>::Run(kc, a, b, c, ldc, mr, nr);
+}
+#endif
+
+template <typename T>
+using MicroKernelFunc = void (*)(size_t, const T*, const T*, T*, size_t, size_t, size_t);
+
+template <typename T, size_t VectorBytes>
+void BlockedGemm(size_t m, size_t n, size_t k, GemmOperand<T> a, GemmOperand<T> b, T* c, size_t ldc,
+    MicroKernelFunc<T> kernel){
+    using Blocking = GemmBlocking<T, VectorBytes>;
+    constexpr size_t MR = Blocking::MR, NR = Blocking::NR;
+    auto& packed_a = PackBuffer<T>(0);
+    auto& packed_b = PackBuffer<T>(1);
+    packed_a.resize(Blocking::MC * Blocking::KC);
+    packed_b.resize(Blocking::KC * ((Blocking::NC + NR - 1) / NR * NR));
+    for(size_t jc = 0; jc < n; jc += Blocking::NC){
+        const size_t nc = std::min(Blocking::NC, n - jc);
+        for(size_t pc = 0; pc < k; pc += Blocking::KC){
+            const size_t kc = std::min(Blocking::KC, k - pc);
+            PackB<T, NR>(kc, nc, {&b(pc, jc), b.row_stride, b.col_stride}, packed_b.data());
+            for(size_t ic = 0; ic < m; ic += Blocking::MC){
+                const size_t mc = std::min(Blocking::MC, m - ic);
+                PackA<T, MR>(mc, kc, {&a(ic, pc), a.row_stride, a.col_stride}, packed_a.data());
+                for(size_t jr = 0; jr < nc; jr += NR){
+                    for(size_t ir = 0; ir < mc; ir += MR){
+                        kernel(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc,
+                            c + (ic + ir) * ldc + jc + jr, ldc,
+                            std::min(MR, mc - ir), std::min(NR, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Splits C into tiles, each computed by one BlockedGemm over the full k range. Every element
+// of C sees the same sequence of additions whatever the tiling, so the result does not
+// depend on the number of threads.
+template <typename T, size_t VectorBytes>
+void ParallelGemm(size_t m, size_t n, size_t k, GemmOperand<T> a, GemmOperand<T> b, T* c, size_t ldc,
+    MicroKernelFunc<T> kernel){
+    using Blocking = GemmBlocking<T, VectorBytes>;
+    constexpr size_t MR = Blocking::MR, NR = Blocking::NR;
+    ThreadPool& pool = SharedThreadPool();
+    const size_t tasks = 2 * pool.NumThreads();
+    if((pool.NumThreads() == 1) || (m * n * k < 128 * 128 * 128)){
+        BlockedGemm<T, VectorBytes>(m, n, k, a, b, c, ldc, kernel);
+        return;
+    }
+    const size_t tile_m = ((m + tasks - 1) / tasks + MR - 1) / MR * MR;
+    const size_t tiles_m = (m + tile_m - 1) / tile_m;
+    const size_t max_tiles_n = std::max<size_t>(n / (4 * NR), 1);
+    const size_t tiles_n_wanted = std::min((tasks + tiles_m - 1) / tiles_m, max_tiles_n);
+    const size_t tile_n = ((n + tiles_n_wanted - 1) / tiles_n_wanted + NR - 1) / NR * NR;
+    const size_t tiles_n = (n + tile_n - 1) / tile_n;
+    pool.ParallelFor(tiles_m * tiles_n, [&](size_t tile){
+        const size_t i0 = (tile / tiles_n) * tile_m, j0 = (tile % tiles_n) * tile_n;
+        const size_t mt = std::min(tile_m, m - i0), nt = std::min(tile_n, n - j0);
+        BlockedGemm<T, VectorBytes>(mt, nt, k, {&a(i0, 0), a.row_stride, a.col_stride},
+            {&b(0, j0), b.row_stride, b.col_stride}, c + i0 * ldc + j0, ldc, kernel);
+    });
+}
+
+template <typename T>
+void SmallGemm(size_t m, size_t n, size_t k, GemmOperand<T> a, GemmOperand<T> b, T* c, size_t ldc){
+    for(size_t i = 0; i < m; ++i){
+        T* __restrict c_row = c + i * ldc;
+        for(size_t p = 0; p < k; ++p){
+            const T a_val = a(i, p);
+            for(size_t j = 0; j < n; ++j){
+                c_row[j] += a_val * b(p, j);
+            }
+        }
+    }
+}
+
+// Rows of A are contiguous: four rows are reduced at once and share every load of x.
+struct GemvRows{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(size_t m, size_t n, const T* a, size_t lda, const T* x, T* y){
+        size_t i = 0;
+        for(; i + 4 <= m; i += 4){
+            T res[4] = {};
+            size_t j = 0;
+            if constexpr(Bytes != 0){
+                using V = simd_detail::Vector<T, Bytes>;
+                typename V::Type acc[4] = {}, x_vec, a_vec;
+                for(; j + V::LANES <= n; j += V::LANES){
+                    V::Load(x_vec, x + j);
+                    #pragma GCC unroll 4
+                    for(size_t r = 0; r < 4; ++r){
+                        V::Load(a_vec, a + (i + r) * lda + j);
+                        acc[r] += a_vec * x_vec;
+                    }
+                }
+                for(size_t r = 0; r < 4; ++r){
+                    res[r] = V::Sum(acc[r]);
+                }
+            }
+            for(; j < n; ++j){
+                for(size_t r = 0; r < 4; ++r){
+                    res[r] += a[(i + r) * lda + j] * x[j];
+                }
+            }
+            for(size_t r = 0; r < 4; ++r){
+                y[i + r] = res[r];
+            }
+        }
+        for(; i < m; ++i){
+            y[i] = simd_detail::Dot::Run<Bytes>(a + i * lda, x, n);
+        }
+    }
+};
+
+// Columns of A are contiguous (a transposed operand): y takes four scaled columns per pass.
+struct GemvColumns{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(size_t m, size_t n, const T* a, size_t lda, const T* x, T* y){
+        std::fill(y, y + m, T());
+        size_t j = 0;
+        for(; j + 4 <= n; j += 4){
+            const T* col[4] = {a + j * lda, a + (j + 1) * lda, a + (j + 2) * lda, a + (j + 3) * lda};
+            size_t i = 0;
+            if constexpr(Bytes != 0){
+                using V = simd_detail::Vector<T, Bytes>;
+                typename V::Type x_vec[4], y_vec, a_vec;
+                for(size_t r = 0; r < 4; ++r){
+                    x_vec[r] = typename V::Type{} + x[j + r];
+                }
+                for(; i + V::LANES <= m; i += V::LANES){
+                    V::Load(y_vec, y + i);
+                    #pragma GCC unroll 4
+                    for(size_t r = 0; r < 4; ++r){
+                        V::Load(a_vec, col[r] + i);
+                        y_vec += x_vec[r] * a_vec;
+                    }
+                    V::Store(y + i, y_vec);
+                }
+            }
+            for(; i < m; ++i){
+                y[i] += x[j] * col[0][i] + x[j + 1] * col[1][i] + x[j + 2] * col[2][i] + x[j + 3] * col[3][i];
+            }
+        }
+        for(; j < n; ++j){
+            simd_detail::Axpy::Run<Bytes>(y, x[j], a + j * lda, m);
+        }
+    }
+};
+
+} // namespace gemm_detail
+
+template <typename T>
+void Gemm(size_t m, size_t n, size_t k, GemmOperand<T> a, GemmOperand<T> b, T* c, size_t ldc){
+    if(m * n * k <= 32 * 32 * 32){
+        gemm_detail::SmallGemm(m, n, k, a, b, c, ldc);
+        return;
+    }
+    if constexpr(simd_detail::VECTORIZABLE<T>){
+        switch(ActiveSimdLevel()){
+#ifdef SVD_SIMD_X86
+        case SimdLevel::AVX512:
+            gemm_detail::ParallelGemm<T, 64>(m, n, k, a, b, c, ldc, gemm_detail::RunMicroKernelAvx512<T>);
+            return;
+        case SimdLevel::AVX2:
+            gemm_detail::ParallelGemm<T, 32>(m, n, k, a, b, c, ldc, gemm_detail::RunMicroKernelAvx2<T>);
+            return;
+#endif
+        case SimdLevel::SSE:
+            gemm_detail::ParallelGemm<T, 16>(m, n, k, a, b, c, ldc, gemm_detail::RunMicroKernel<T, 16>);
+            return;
+        default:
+            break;
+        }
+    }
+    gemm_detail::ParallelGemm<T, 0>(m, n, k, a, b, c, ldc, gemm_detail::RunMicroKernel<T, 0>);
+}
+
+template <typename T>
+void Gemv(size_t m, size_t n, GemmOperand<T> a, const T* x, T* y){
+    if(a.col_stride == 1){
+        simd_detail::Dispatch<T, gemm_detail::GemvRows>(m, n, a.data, a.row_stride, x, y);
+        return;
+    }
+    if(a.row_stride == 1){
+        simd_detail::Dispatch<T, gemm_detail::GemvColumns>(m, n, a.data, a.col_stride, x, y);
+        return;
+    }
+    for(size_t i = 0; i < m; ++i){
+        T res = 0;
+        for(size_t j = 0; j < n; ++j){
+            res += a(i, j) * x[j];
+        }
+        y[i] = res;
+    }
+}
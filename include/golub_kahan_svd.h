@@ -0,0 +1,348 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "simd.h"
+
+#include <vector>
+#include <cmath>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Golub-Kahan SVD: Householder reduction to an upper bidiagonal matrix, then implicit QR
+// sweeps on the bidiagonal (Wilkinson shift, or the zero shift of Demmel and Kahan once the
+// shift would spoil the small values). O(rows * columns * min(rows, columns)) regardless of
+// how the singular values are spread. Returns the num_vec largest triplets, at most
+// min(rows, columns), error_rate is the relative size below which off-diagonal entries count as zero.
+// Throws std::runtime_error when the QR sweeps do not converge, as for a matrix with NaN entries.
+template <typename T>
+SVD<T> CalculateGolubKahanSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate);
+
+namespace golub_kahan_detail{
+
+// Upper bidiagonal matrix with diagonal d and superdiagonal e, tall = ut^T * bidiagonal * vt
+template <typename T>
+struct Bidiagonal{
+    std::vector<T> d;
+    std::vector<T> e;
+    Matrix<T> ut;
+    Matrix<T> vt;
+};
+
+// Householder reflector H = I - tau * v * v^T with v[0] = 1 and H * x = (beta, 0, ..., 0)
+template <typename T>
+struct Reflector{
+    T tau;
+    T beta;
+};
+
+template <typename T>
+Reflector<T> MakeReflector(T alpha, T* tail, size_t tail_size, size_t tail_stride);
+
+// Reduces a tall matrix (rows >= columns) and forms both orthogonal factors
+template <typename T>
+Bidiagonal<T> Bidiagonalize(Matrix<T> a);
+
+// Rotation with c * f + s * g = r and c * g - s * f = 0
+template <typename T>
+void MakeRotation(T f, T g, T& c, T& s, T& r);
+
+// Runs QR sweeps until every superdiagonal entry is negligible, the rotations are applied to
+// the rows of ut and vt. Leaves the singular values in d, possibly negative and unsorted.
+// Throws std::runtime_error if 6 * n^2 sweeps leave a superdiagonal entry, like LAPACK's info > 0.
+template <typename T>
+void DiagonalizeBidiagonal(Bidiagonal<T>& bidiagonal, T tol);
+
+} // namespace golub_kahan_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace golub_kahan_detail{
+
+template <typename T>
+Reflector<T> MakeReflector(T alpha, T* tail, size_t tail_size, size_t tail_stride){
+    T tail_norm = 0;
+    for(size_t i = 0; i < tail_size; ++i){
+        tail_norm += tail[i * tail_stride] * tail[i * tail_stride];
+    }
+    tail_norm = std::sqrt(tail_norm);
+    if(tail_norm == T(0)){
+        return {T(0), alpha};
+    }
+    const T beta = -std::copysign(std::hypot(alpha, tail_norm), alpha);
+    const T scale = T(1) / (alpha - beta);
+    for(size_t i = 0; i < tail_size; ++i){
+        tail[i * tail_stride] *= scale;
+    }
+    return {(beta - alpha) / beta, beta};
+}
+
+template <typename T>
+Bidiagonal<T> Bidiagonalize(Matrix<T> a){
+    const size_t m = a.SizeColumn(), n = a.SizeRow();
+    std::vector<T> tau_left(n, T()), tau_right(n, T()), w(n);
+    Bidiagonal<T> res{std::vector<T>(n), std::vector<T>(n ? n - 1 : 0), Matrix<T>(), Matrix<T>()};
+    // Every reflector is applied row by row, as a sum of rows (w = v^T * A) followed by a
+    // rank one update, so all the work runs over contiguous rows
+    for(size_t k = 0; k < n; ++k){
+        const Reflector<T> left = MakeReflector(a[k][k], &a[k][k] + a.Stride(), m - k - 1, a.Stride());
+        tau_left[k] = left.tau;
+        res.d[k] = left.beta;
+        a[k][k] = T(1);
+        const size_t rest = n - k - 1;
+        if((left.tau != T(0)) && rest){
+            std::copy(&a[k][k + 1], &a[k][k + 1] + rest, w.begin());
+            for(size_t i = k + 1; i < m; ++i){
+                SimdAxpy(w.data(), a[i][k], &a[i][k + 1], rest);
+            }
+            for(size_t i = k; i < m; ++i){
+                SimdAxpy(&a[i][k + 1], -left.tau * a[i][k], w.data(), rest);
+            }
+        }
+        if(rest == 0){
+            continue;
+        }
+        const Reflector<T> right = MakeReflector(a[k][k + 1], &a[k][k + 1] + 1, rest - 1, size_t(1));
+        tau_right[k] = right.tau;
+        res.e[k] = right.beta;
+        a[k][k + 1] = T(1);
+        if(right.tau != T(0)){
+            for(size_t i = k + 1; i < m; ++i){
+                const T dot = SimdDot(&a[i][k + 1], &a[k][k + 1], rest);
+                SimdAxpy(&a[i][k + 1], -right.tau * dot, &a[k][k + 1], rest);
+            }
+        }
+    }
+
+    // U = H_0 * ... * H_{n-1} and V = G_0 * ... * G_{n-2}, accumulated from the last reflector
+    // so that each one only touches the trailing block
+    Matrix<T> u(m, n, T()), v(n, n, T());
+    for(size_t i = 0; i < n; ++i){
+        u[i][i] = T(1);
+        v[i][i] = T(1);
+    }
+    for(size_t k = n; k-- > 0;){
+        if(tau_left[k] == T(0)){
+            continue;
+        }
+        const size_t width = n - k;
+        std::fill(w.begin(), w.begin() + width, T());
+        for(size_t i = k; i < m; ++i){
+            SimdAxpy(w.data(), a[i][k], &u[i][k], width);
+        }
+        for(size_t i = k; i < m; ++i){
+            SimdAxpy(&u[i][k], -tau_left[k] * a[i][k], w.data(), width);
+        }
+    }
+    for(size_t k = (n > 1) ? n - 1 : 0; k-- > 0;){
+        if(tau_right[k] == T(0)){
+            continue;
+        }
+        const size_t width = n - k - 1;
+        const T* reflector = &a[k][k + 1];
+        std::fill(w.begin(), w.begin() + width, T());
+        for(size_t i = 0; i < width; ++i){
+            SimdAxpy(w.data(), reflector[i], &v[k + 1 + i][k + 1], width);
+        }
+        for(size_t i = 0; i < width; ++i){
+            SimdAxpy(&v[k + 1 + i][k + 1], -tau_right[k] * reflector[i], w.data(), width);
+        }
+    }
+    res.ut = Transp(u);
+    res.vt = Transp(v);
+    return res;
+}
+
+template <typename T>
+void MakeRotation(T f, T g, T& c, T& s, T& r){
+    if(g == T(0)){
+        c = T(1);
+        s = T(0);
+        r = f;
+        return;
+    }
+    r = std::hypot(f, g);
+    c = f / r;
+    s = g / r;
+}
+
+template <typename T>
+void DiagonalizeBidiagonal(Bidiagonal<T>& bidiagonal, T tol){
+    std::vector<T>& d = bidiagonal.d;
+    std::vector<T>& e = bidiagonal.e;
+    const size_t n = d.size();
+    if(n < 2){
+        return;
+    }
+    // Left rotations of rows (i, j) of the bidiagonal act on rows i, j of ut, right ones on rows of vt
+    auto rotate = [](Matrix<T>& rows, size_t i, size_t j, T c, T s){
+        SimdRotate(rows[i].data(), rows[j].data(), c, -s, rows.SizeRow());
+    };
+    T norm = 0;
+    for(size_t i = 0; i < n; ++i){
+        norm = std::max({norm, std::abs(d[i]), (i + 1 < n) ? std::abs(e[i]) : T(0)});
+    }
+    const T eps = std::numeric_limits<T>::epsilon();
+    const size_t max_sweeps = 6 * n * n;
+    for(size_t sweep = 0; sweep < max_sweeps; ++sweep){
+        for(size_t i = 0; i + 1 < n; ++i){
+            if(std::abs(e[i]) <= tol * (std::abs(d[i]) + std::abs(d[i + 1]))){
+                e[i] = T(0);
+            }
+        }
+        // Bottom block [lo, hi] with nonzero superdiagonal
+        size_t hi = n - 1;
+        while((hi > 0) && (e[hi - 1] == T(0))){
+            --hi;
+        }
+        if(hi == 0){
+            return;
+        }
+        size_t lo = hi - 1;
+        while((lo > 0) && (e[lo - 1] != T(0))){
+            --lo;
+        }
+
+        // A zero on the diagonal splits the block once its row or column is rotated away
+        size_t zero = hi + 1;
+        for(size_t i = lo; i <= hi; ++i){
+            if(std::abs(d[i]) <= tol * norm){
+                d[i] = T(0);
+                zero = i;
+                break;
+            }
+        }
+        if(zero < hi){
+            T f = e[zero], c, s, r;
+            e[zero] = T(0);
+            for(size_t j = zero + 1; j <= hi; ++j){
+                MakeRotation(d[j], f, c, s, r);
+                d[j] = r;
+                if(j < hi){
+                    f = -s * e[j];
+                    e[j] *= c;
+                }
+                rotate(bidiagonal.ut, j, zero, c, s);
+            }
+            continue;
+        }
+        if(zero == hi){
+            T f = e[hi - 1], c, s, r;
+            e[hi - 1] = T(0);
+            for(size_t j = hi; j-- > lo;){
+                MakeRotation(d[j], f, c, s, r);
+                d[j] = r;
+                if(j > lo){
+                    f = -s * e[j - 1];
+                    e[j - 1] *= c;
+                }
+                rotate(bidiagonal.vt, j, hi, c, s);
+            }
+            continue;
+        }
+
+        // Shift: the smaller singular value of the trailing 2 x 2 block
+        const T fa = std::abs(d[hi - 1]), ga = std::abs(e[hi - 1]), ha = std::abs(d[hi]);
+        const T larger = (std::hypot(fa + ha, ga) + std::hypot(fa - ha, ga)) / 2;
+        T shift = (larger > T(0)) ? fa * ha / larger : T(0);
+        if((shift / std::abs(d[lo])) * (shift / std::abs(d[lo])) < eps){
+            shift = T(0);
+        }
+
+        T c, s, r;
+        if(shift == T(0)){
+            // Zero shift step, keeps tiny singular values to full relative accuracy
+            T cs = T(1), old_cs = T(1), old_sn = T(0), sn;
+            for(size_t i = lo; i < hi; ++i){
+                MakeRotation(d[i] * cs, e[i], cs, sn, r);
+                if(i > lo){
+                    e[i - 1] = old_sn * r;
+                }
+                MakeRotation(old_cs * r, d[i + 1] * sn, old_cs, old_sn, d[i]);
+                rotate(bidiagonal.vt, i, i + 1, cs, sn);
+                rotate(bidiagonal.ut, i, i + 1, old_cs, old_sn);
+            }
+            const T h = d[hi] * cs;
+            d[hi] = h * old_cs;
+            e[hi - 1] = h * old_sn;
+            continue;
+        }
+        // Shifted step, the bulge introduced at the top is chased down to the bottom
+        T f = (std::abs(d[lo]) - shift) * (std::copysign(T(1), d[lo]) + shift / d[lo]);
+        T g = e[lo];
+        for(size_t i = lo; i < hi; ++i){
+            MakeRotation(f, g, c, s, r);
+            if(i > lo){
+                e[i - 1] = r;
+            }
+            f = c * d[i] + s * e[i];
+            e[i] = c * e[i] - s * d[i];
+            g = s * d[i + 1];
+            d[i + 1] *= c;
+            rotate(bidiagonal.vt, i, i + 1, c, s);
+            MakeRotation(f, g, c, s, r);
+            d[i] = r;
+            f = c * e[i] + s * d[i + 1];
+            d[i + 1] = c * d[i + 1] - s * e[i];
+            if(i + 1 < hi){
+                g = s * e[i + 1];
+                e[i + 1] *= c;
+            }
+            rotate(bidiagonal.ut, i, i + 1, c, s);
+        }
+        e[hi - 1] = f;
+    }
+    throw std::runtime_error("The bidiagonal QR iteration did not converge");
+}
+
+} // namespace golub_kahan_detail
+
+template <typename T>
+SVD<T> CalculateGolubKahanSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    const bool tall = mat.SizeColumn() >= mat.SizeRow();
+    const size_t count = std::min(mat.SizeColumn(), mat.SizeRow());
+    if(num_vec > count){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    golub_kahan_detail::Bidiagonal<T> bidiagonal = golub_kahan_detail::Bidiagonalize(tall ? mat : Transp(mat));
+    golub_kahan_detail::DiagonalizeBidiagonal(bidiagonal, std::max(error_rate, std::numeric_limits<T>::epsilon()));
+
+    std::vector<T>& sigma = bidiagonal.d;
+    for(size_t i = 0; i < count; ++i){
+        if(sigma[i] < T(0)){
+            sigma[i] = -sigma[i];
+            SimdScale(bidiagonal.vt[i].data(), T(-1), count);
+        }
+    }
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&sigma](size_t lhs, size_t rhs){
+        return sigma[lhs] > sigma[rhs];
+    });
+
+    const Matrix<T>& ut = bidiagonal.ut;
+    const Matrix<T>& vt = bidiagonal.vt;
+    Matrix<T> u(ut.SizeRow(), num_vec, T()), v(count, num_vec, T());
+    SVD<T> res;
+    res.eigenvalues = Matrix<T>(num_vec, num_vec, T());
+    for(size_t j = 0; j < num_vec; ++j){
+        const size_t index = order[j];
+        res.eigenvalues[j][j] = sigma[index];
+        for(size_t i = 0; i < u.SizeColumn(); ++i){
+            u[i][j] = ut[index][i];
+        }
+        for(size_t i = 0; i < count; ++i){
+            v[i][j] = vt[index][i];
+        }
+    }
+    res.left_singular_vectors = tall ? std::move(u) : std::move(v);
+    res.right_singular_vectors = tall ? std::move(v) : std::move(u);
+    return res;
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "golub_kahan_svd.h"
+#include "orthonormalize.h"
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Truncated SVD of a matrix that grows by rows, updated in the manner of Brand: a batch of b new
+// rows is split into its part in the current right subspace and an orthonormal remainder, and only
+// a (k + b) x (k + b) core matrix is decomposed. The left vectors are kept as a fixed basis times a
+// small rotation, so the rows seen before are not rewritten by an update. An update costs
+// O((k + b) * (b + k) * size_row + (k + b)^3), independent of the number of rows folded in so far.
+template <typename T>
+class IncrementalSVD{
+public:
+    // Empty factorization of rows with size_row entries
+    IncrementalSVD(const size_t rank, const size_t size_row);
+    // Continues from a factorization of the rows seen so far, cut to rank triplets
+    IncrementalSVD(const SVD<T>& svd, const size_t rank);
+
+    // Folds in the rows of mat, keeps at most rank triplets
+    void Update(const Matrix<T>& mat);
+
+    SVD<T> Result() const;
+
+    size_t Rank() const noexcept;
+    size_t SizeColumn() const noexcept;
+    size_t SizeRow() const noexcept;
+
+    // Frobenius norm of everything the truncations have dropped so far. It is exact while the
+    // dropped parts stay orthogonal and a close estimate of the distance of the folded rows
+    // from the current factorization otherwise.
+    T TruncationError() const noexcept;
+
+private:
+    // Keeps the leading triplets of dec, a factorization of the last rows folded in
+    void Reset(const SVD<T>& dec);
+
+    size_t rank_;
+    size_t size_row_;
+    size_t size_column_ = 0;
+    // U = left_ * rotation_, the rows of right_ are the right singular vectors
+    Matrix<T> left_;
+    Matrix<T> rotation_;
+    Matrix<T> right_;
+    std::vector<T> values_;
+    T dropped_ = 0;
+};
+
+namespace incremental_detail{
+
+// The rotation is folded into the basis once its inverse amplifies rounding beyond this
+inline constexpr double MIN_ROTATION_CONDITION = 1e-2;
+
+// count x count identity
+template <typename T>
+Matrix<T> Identity(size_t count);
+
+// Rows [row_begin, row_end) of the first count columns of mat
+template <typename T>
+Matrix<T> Block(const Matrix<T>& mat, size_t row_begin, size_t row_end, size_t count);
+
+// Number of leading triplets of dec to keep: at most rank, and only those with a nonzero value,
+// the vectors of zero values are arbitrary and would not stay orthonormal through later updates
+template <typename T>
+size_t KeptCount(const SVD<T>& dec, size_t rank);
+
+// Inverse of a square matrix through its SVD, empty when the matrix is too close to singular
+template <typename T>
+Matrix<T> ConditionedInverse(const Matrix<T>& mat);
+
+} // namespace incremental_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace incremental_detail{
+
+template <typename T>
+Matrix<T> Identity(size_t count){
+    Matrix<T> res(count, count, T());
+    for(size_t i = 0; i < count; ++i){
+        res[i][i] = T(1);
+    }
+    return res;
+}
+
+template <typename T>
+Matrix<T> Block(const Matrix<T>& mat, size_t row_begin, size_t row_end, size_t count){
+    Matrix<T> res(row_end - row_begin, count, T());
+    for(size_t i = row_begin; i < row_end; ++i){
+        std::copy(mat[i].begin(), mat[i].begin() + count, res[i - row_begin].begin());
+    }
+    return res;
+}
+
+template <typename T>
+size_t KeptCount(const SVD<T>& dec, size_t rank){
+    const size_t size = dec.eigenvalues.SizeColumn();
+    const T tol = T(size) * std::numeric_limits<T>::epsilon() * (size ? dec.eigenvalues[0][0] : T(0));
+    size_t count = 0;
+    while((count < std::min(rank, size)) && (dec.eigenvalues[count][count] > tol)){
+        ++count;
+    }
+    return count;
+}
+
+template <typename T>
+Matrix<T> ConditionedInverse(const Matrix<T>& mat){
+    const size_t n = mat.SizeRow();
+    const SVD<T> dec = CalculateGolubKahanSVD(mat, n, std::numeric_limits<T>::epsilon());
+    if(dec.eigenvalues[n - 1][n - 1] < T(MIN_ROTATION_CONDITION) * dec.eigenvalues[0][0]){
+        return Matrix<T>(0);
+    }
+    // V * S^-1 * U^T
+    Matrix<T> scaled = dec.right_singular_vectors;
+    for(size_t i = 0; i < n; ++i){
+        for(size_t j = 0; j < n; ++j){
+            scaled[i][j] /= dec.eigenvalues[j][j];
+        }
+    }
+    return scaled * Transposed(dec.left_singular_vectors);
+}
+
+} // namespace incremental_detail
+
+template <typename T>
+IncrementalSVD<T>::IncrementalSVD(const size_t rank, const size_t size_row)
+    : rank_(rank)
+    , size_row_(size_row)
+    , left_(0)
+    , rotation_(0)
+    , right_(0){
+    if((rank == 0) || (size_row == 0)){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+}
+
+template <typename T>
+IncrementalSVD<T>::IncrementalSVD(const SVD<T>& svd, const size_t rank)
+    : IncrementalSVD(rank, svd.right_singular_vectors.SizeColumn()){
+    const size_t size = svd.eigenvalues.SizeColumn();
+    if((svd.right_singular_vectors.SizeRow() < size) || (svd.left_singular_vectors.SizeRow() < size)){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    size_column_ = svd.left_singular_vectors.SizeColumn();
+    Reset(svd);
+}
+
+template <typename T>
+void IncrementalSVD<T>::Reset(const SVD<T>& dec){
+    const size_t count = incremental_detail::KeptCount(dec, std::min(rank_, size_row_));
+    values_.clear();
+    for(size_t i = 0; i < dec.eigenvalues.SizeColumn(); ++i){
+        const T value = dec.eigenvalues[i][i];
+        if(i < count){
+            values_.push_back(value);
+        }
+        else{
+            dropped_ += value * value;
+        }
+    }
+    if(count == 0){
+        return;
+    }
+    // Rows folded in before dec, if any, were all zero
+    const size_t rows = dec.left_singular_vectors.SizeColumn();
+    left_ = Matrix<T>(size_column_ - rows, count, T());
+    left_.PushBackRow(incremental_detail::Block(dec.left_singular_vectors, 0, rows, count));
+    rotation_ = incremental_detail::Identity<T>(count);
+    right_ = Transp(incremental_detail::Block(dec.right_singular_vectors, 0, size_row_, count));
+}
+
+template <typename T>
+void IncrementalSVD<T>::Update(const Matrix<T>& mat){
+    if(mat.SizeColumn() == 0){
+        return;
+    }
+    if(!mat.Correct() || (mat.SizeRow() != size_row_)){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    size_column_ += mat.SizeColumn();
+    if(values_.empty()){
+        Reset(CalculateGolubKahanSVD(mat, std::min(mat.SizeColumn(), size_row_), std::numeric_limits<T>::epsilon()));
+        return;
+    }
+    const size_t k = values_.size(), b = mat.SizeColumn();
+
+    // mat = proj * right_ + coupling * basis with orthonormal rows in basis (zero where dependent)
+    const Matrix<T> proj = mat * Transposed(right_);
+    const Matrix<T> residual = mat - proj * right_;
+    Matrix<T> basis = residual;
+    OrthonormalizeRows(basis);
+    const Matrix<T> coupling = residual * Transposed(basis);
+
+    // [S 0; proj coupling] is the new matrix in the bases [U 0; 0 I] and [right_; basis]
+    Matrix<T> core(k + b, k + b, T());
+    for(size_t i = 0; i < k; ++i){
+        core[i][i] = values_[i];
+    }
+    for(size_t i = 0; i < b; ++i){
+        std::copy(proj[i].begin(), proj[i].end(), core[k + i].begin());
+        std::copy(coupling[i].begin(), coupling[i].end(), core[k + i].begin() + k);
+    }
+    const SVD<T> dec = CalculateGolubKahanSVD(core, k + b, std::numeric_limits<T>::epsilon());
+    const size_t count = incremental_detail::KeptCount(dec, std::min(rank_, size_row_));
+    values_.resize(count);
+    for(size_t i = 0; i < k + b; ++i){
+        const T value = dec.eigenvalues[i][i];
+        if(i < count){
+            values_[i] = value;
+        }
+        else{
+            dropped_ += value * value;
+        }
+    }
+
+    Matrix<T> stacked = std::move(right_);
+    stacked.PushBackRow(basis);
+    const Matrix<T> turn = incremental_detail::Block(dec.right_singular_vectors, 0, k + b, count);
+    right_ = Transposed(turn) * stacked;
+
+    // The old rows of U turn with the top block of the core vectors, the new rows are its bottom
+    // block. Those are stored through the inverse of the new rotation so that left_ keeps its rows.
+    const Matrix<T> bottom = incremental_detail::Block(dec.left_singular_vectors, k, k + b, count);
+    Matrix<T> rotation = rotation_ * incremental_detail::Block(dec.left_singular_vectors, 0, k, count);
+    Matrix<T> inverse(0);
+    if(rotation.SizeColumn() == count){
+        inverse = incremental_detail::ConditionedInverse(rotation);
+    }
+    if(inverse.SizeColumn()){
+        left_.PushBackRow(bottom * inverse);
+        rotation_ = std::move(rotation);
+    }
+    else{
+        left_ = left_ * rotation;
+        left_.PushBackRow(bottom);
+        rotation_ = incremental_detail::Identity<T>(count);
+    }
+}
+
+template <typename T>
+SVD<T> IncrementalSVD<T>::Result() const{
+    SVD<T> res;
+    res.eigenvalues = Matrix<T>(values_.size(), values_.size(), T());
+    for(size_t i = 0; i < values_.size(); ++i){
+        res.eigenvalues[i][i] = values_[i];
+    }
+    if(values_.empty()){
+        return res;
+    }
+    res.left_singular_vectors = left_ * rotation_;
+    res.right_singular_vectors = Transp(right_);
+    return res;
+}
+
+template <typename T>
+size_t IncrementalSVD<T>::Rank() const noexcept{
+    return values_.size();
+}
+
+template <typename T>
+size_t IncrementalSVD<T>::SizeColumn() const noexcept{
+    return size_column_;
+}
+
+template <typename T>
+size_t IncrementalSVD<T>::SizeRow() const noexcept{
+    return size_row_;
+}
+
+template <typename T>
+T IncrementalSVD<T>::TruncationError() const noexcept{
+    return std::sqrt(dropped_);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <numeric>
+#include <limits>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+// One-sided Jacobi (Hestenes) SVD. Pairs of columns are rotated until every two of them are
+// orthogonal to within error_rate relative to their norms, the norms are then the singular values.
+// It works on the columns themselves instead of the Gram matrix, so small singular values keep
+// their relative accuracy. Returns the num_vec largest triplets, at most min(rows, columns).
+// Throws std::runtime_error when the sweeps do not converge, as for a matrix with NaN entries.
+template <typename T>
+SVD<T> CalculateJacobiSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate);
+
+namespace jacobi_detail{
+
+inline constexpr size_t MAX_SWEEPS = 64;
+
+// Pair index of round `round` in the circle method for an even number of players: the last
+// player stays put while the others rotate, so count - 1 rounds meet every two players once
+// and the pairs of one round are disjoint.
+inline std::pair<size_t, size_t> RoundRobinPair(size_t count, size_t round, size_t index) noexcept;
+
+// Rotates rows p and q of cols, and the same rows of basis, to make the two cols rows orthogonal.
+// norms holds the squared norms of the cols rows and is kept up to date. A NaN inner product is
+// left unrotated but counted as a rotation, so it can never pass for convergence.
+template <typename T>
+bool OrthogonalizePair(Matrix<T>& cols, Matrix<T>& basis, std::vector<T>& norms, size_t p, size_t q, T tol);
+
+// Orthogonalizes the rows of cols, applying every rotation to the rows of basis as well.
+// Returns the number of sweeps run, throws std::runtime_error if the last of MAX_SWEEPS still rotated.
+template <typename T>
+size_t OrthogonalizeRows(Matrix<T>& cols, Matrix<T>& basis, T tol);
+
+} // namespace jacobi_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace jacobi_detail{
+
+inline std::pair<size_t, size_t> RoundRobinPair(size_t count, size_t round, size_t index) noexcept{
+    auto player = [count, round](size_t position){
+        return (position == count - 1) ? position : (position + round) % (count - 1);
+    };
+    return {player(index), player(count - 1 - index)};
+}
+
+template <typename T>
+bool OrthogonalizePair(Matrix<T>& cols, Matrix<T>& basis, std::vector<T>& norms, size_t p, size_t q, T tol){
+    const T alpha = norms[p], beta = norms[q];
+    if((alpha == T(0)) || (beta == T(0))){
+        return false;
+    }
+    const T gamma = SimdDot(cols[p].data(), cols[q].data(), cols.SizeRow());
+    if(std::isnan(gamma)){
+        return true;
+    }
+    if(std::abs(gamma) <= tol * std::sqrt(alpha * beta)){
+        return false;
+    }
+    const T zeta = (beta - alpha) / (2 * gamma);
+    const T t = std::copysign(T(1), zeta) / (std::abs(zeta) + std::sqrt(1 + zeta * zeta));
+    const T c = 1 / std::sqrt(1 + t * t);
+    const T s = c * t;
+    SimdRotate(cols[p].data(), cols[q].data(), c, s, cols.SizeRow());
+    SimdRotate(basis[p].data(), basis[q].data(), c, s, basis.SizeRow());
+    norms[p] = alpha - t * gamma;
+    norms[q] = beta + t * gamma;
+    return true;
+}
+
+template <typename T>
+size_t OrthogonalizeRows(Matrix<T>& cols, Matrix<T>& basis, T tol){
+    const size_t count = cols.SizeColumn();
+    const size_t players = count + count % 2;
+    const size_t grain = std::max<size_t>(PARALLEL_GRAIN / (cols.SizeRow() + basis.SizeRow()), 1);
+    std::vector<T> norms(count);
+    for(size_t sweep = 1; ; ++sweep){
+        // Refreshed every sweep, the running updates drift from the true norms
+        ParallelChunks(count, grain, [&](size_t begin, size_t end){
+            for(size_t i = begin; i < end; ++i){
+                norms[i] = SimdSumSquares(cols[i].data(), cols.SizeRow());
+            }
+        });
+        std::atomic<size_t> rotations = 0;
+        for(size_t round = 0; round + 1 < players; ++round){
+            ParallelChunks(players / 2, grain, [&](size_t begin, size_t end){
+                size_t rotated = 0;
+                for(size_t i = begin; i < end; ++i){
+                    auto [p, q] = RoundRobinPair(players, round, i);
+                    if(std::max(p, q) < count){
+                        rotated += OrthogonalizePair(cols, basis, norms, std::min(p, q), std::max(p, q), tol);
+                    }
+                }
+                rotations += rotated;
+            });
+        }
+        if(rotations == 0){
+            return sweep;
+        }
+        if(sweep == MAX_SWEEPS){
+            throw std::runtime_error("The Jacobi rotations did not converge");
+        }
+    }
+}
+
+} // namespace jacobi_detail
+
+template <typename T>
+SVD<T> CalculateJacobiSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    const bool tall = mat.SizeColumn() >= mat.SizeRow();
+    const size_t count = std::min(mat.SizeColumn(), mat.SizeRow());
+    if(num_vec > count){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    // The rows of cols are the columns of the tall one of mat and mat^T, so every rotation
+    // runs over contiguous memory and the number of pairs is the smaller dimension squared
+    Matrix<T> cols = tall ? Transp(mat) : mat;
+    Matrix<T> basis(count, count, T());
+    for(size_t i = 0; i < count; ++i){
+        basis[i][i] = T(1);
+    }
+    jacobi_detail::OrthogonalizeRows(cols, basis, std::max(error_rate, std::numeric_limits<T>::epsilon()));
+
+    std::vector<T> sigma(count);
+    for(size_t i = 0; i < count; ++i){
+        sigma[i] = std::sqrt(SimdSumSquares(cols[i].data(), cols.SizeRow()));
+    }
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&sigma](size_t lhs, size_t rhs){
+        return sigma[lhs] > sigma[rhs];
+    });
+
+    // cols = (U * Sigma)^T and basis = V^T for the tall matrix
+    Matrix<T> u(cols.SizeRow(), num_vec, T()), v(count, num_vec, T());
+    SVD<T> res;
+    res.eigenvalues = Matrix<T>(num_vec, num_vec, T());
+    for(size_t j = 0; j < num_vec; ++j){
+        const size_t index = order[j];
+        res.eigenvalues[j][j] = sigma[index];
+        const T scale = (sigma[index] > T(0)) ? T(1) / sigma[index] : T(0);
+        for(size_t i = 0; i < u.SizeColumn(); ++i){
+            u[i][j] = cols[index][i] * scale;
+        }
+        for(size_t i = 0; i < count; ++i){
+            v[i][j] = basis[index][i];
+        }
+    }
+    res.left_singular_vectors = tall ? std::move(u) : std::move(v);
+    res.right_singular_vectors = tall ? std::move(v) : std::move(u);
+    return res;
+}
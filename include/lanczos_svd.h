@@ -0,0 +1,224 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "gemm.h"
+#include "linear_operator.h"
+#include "dense_vector.h"
+#include "golub_kahan_svd.h"
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <concepts>
+
+// Leading num_vec triplets by Golub-Kahan-Lanczos bidiagonalization with thick restart
+// (Baglama and Reichel). mat is only used through the products mat * x and mat^T * y, and
+// apart from it the memory is two bases of O(num_vec) vectors, O((rows + columns) * num_vec).
+// A triplet has converged once its residual is at most error_rate times the largest singular value.
+template <typename T>
+SVD<T> CalculateLanczosSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate);
+// The same on any linear operator, which is only ever applied to vectors
+template <typename T, LinearOperator Op>
+    requires std::same_as<T, typename Op::value_type>
+SVD<T> CalculateLanczosSVD(const Op& op, const size_t num_vec, const T error_rate);
+
+namespace lanczos_detail{
+
+inline constexpr size_t MAX_RESTARTS = 1000;
+
+// Number of Lanczos vectors per restart cycle
+inline size_t BasisSize(size_t num_vec, size_t size) noexcept;
+
+// Orthogonalizes vec against the first count rows of basis and returns its norm. The correction
+// is selective: it is only applied, at most twice, while some projection exceeds sqrt(eps) * norm,
+// which is where the Lanczos vectors start to lose orthogonality.
+template <typename T>
+T Reorthogonalize(const Matrix<T>& basis, size_t count, Vector<T>& vec, Vector<T>& coefs);
+
+// Replaces vec by a random unit vector orthogonal to the first count rows of basis, used when the
+// recurrence breaks down on an invariant subspace
+template <typename T>
+void RandomOrthogonal(const Matrix<T>& basis, size_t count, Vector<T>& vec, Vector<T>& coefs,
+    std::mt19937_64& generator);
+
+// Rows of the product of the transposed first columns of factor with the rows of basis
+template <typename T>
+Matrix<T> RotateRows(const Matrix<T>& factor, size_t columns, const Matrix<T>& basis);
+
+} // namespace lanczos_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace lanczos_detail{
+
+inline size_t BasisSize(size_t num_vec, size_t size) noexcept{
+    return std::min(size, num_vec + std::max<size_t>(num_vec, 16));
+}
+
+template <typename T>
+T Reorthogonalize(const Matrix<T>& basis, size_t count, Vector<T>& vec, Vector<T>& coefs){
+    T norm = Norma(vec);
+    for(size_t pass = 0; (pass < 2) && count; ++pass){
+        coefs.Resize(count);
+        Gemv<T>(count, vec.Size(), {basis.Data(), basis.Stride(), 1}, vec.Data(), coefs.Data());
+        T largest = 0;
+        for(T coef : coefs){
+            largest = std::max(largest, std::abs(coef));
+        }
+        if(largest <= std::sqrt(std::numeric_limits<T>::epsilon()) * norm){
+            break;
+        }
+        for(size_t i = 0; i < count; ++i){
+            SimdAxpy(vec.Data(), -coefs[i], basis[i].data(), vec.Size());
+        }
+        norm = Norma(vec);
+    }
+    return norm;
+}
+
+template <typename T>
+void RandomOrthogonal(const Matrix<T>& basis, size_t count, Vector<T>& vec, Vector<T>& coefs,
+    std::mt19937_64& generator){
+    std::normal_distribution<double> normal;
+    for(T& val : vec){
+        val = static_cast<T>(normal(generator));
+    }
+    vec /= Norma(vec);
+    // The random vector is far from the span, so the selective test always triggers here
+    vec /= Reorthogonalize(basis, count, vec, coefs);
+}
+
+template <typename T>
+Matrix<T> RotateRows(const Matrix<T>& factor, size_t columns, const Matrix<T>& basis){
+    Matrix<T> coefs(columns, factor.SizeColumn(), T());
+    for(size_t i = 0; i < factor.SizeColumn(); ++i){
+        for(size_t j = 0; j < columns; ++j){
+            coefs[j][i] = factor[i][j];
+        }
+    }
+    return coefs * basis;
+}
+
+} // namespace lanczos_detail
+
+template <typename T>
+SVD<T> CalculateLanczosSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    return CalculateLanczosSVD<T>(DenseOperator<T>(mat), num_vec, error_rate);
+}
+
+template <typename T, LinearOperator Op>
+    requires std::same_as<T, typename Op::value_type>
+SVD<T> CalculateLanczosSVD(const Op& op, const size_t num_vec, const T error_rate){
+    const size_t m = op.SizeColumn(), n = op.SizeRow();
+    if((num_vec == 0) || (num_vec > std::min(m, n))){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    const T eps = std::numeric_limits<T>::epsilon();
+    const size_t p = lanczos_detail::BasisSize(num_vec, std::min(m, n));
+
+    // mat * right^T = left^T * b and mat^T * left^T = right^T * b^T + beta * next * e_p^T, where the
+    // rows of right and left are the Lanczos vectors and b is upper triangular: bidiagonal apart
+    // from the column that couples the Ritz vectors kept by a restart to the next vector
+    Matrix<T> right(p, n, T()), left(p, m, T()), b(p, p, T());
+    Vector<T> next(n), u(m), coefs;
+    std::mt19937_64 generator(1);
+    lanczos_detail::RandomOrthogonal(right, 0, next, coefs, generator);
+    std::copy(next.begin(), next.end(), right[0].begin());
+
+    size_t start = 0;
+    T beta = 0, scale = 0;
+    SVD<T> ritz;
+    for(size_t restart = 0; restart < lanczos_detail::MAX_RESTARTS; ++restart){
+        for(size_t j = start; j < p; ++j){
+            op.Apply(right[j].data(), u.Data());
+            if((j == start) && start){
+                for(size_t i = 0; i < start; ++i){
+                    SimdAxpy(u.Data(), -b[i][start], left[i].data(), m);
+                }
+            }
+            else if(j){
+                SimdAxpy(u.Data(), -beta, left[j - 1].data(), m);
+            }
+            T alpha = lanczos_detail::Reorthogonalize(left, j, u, coefs);
+            scale = std::max(scale, alpha);
+            if(alpha <= eps * scale){
+                lanczos_detail::RandomOrthogonal(left, j, u, coefs, generator);
+                alpha = 0;
+            }
+            else{
+                u /= alpha;
+            }
+            std::copy(u.begin(), u.end(), left[j].begin());
+            b[j][j] = alpha;
+
+            op.ApplyTransposed(left[j].data(), next.Data());
+            SimdAxpy(next.Data(), -alpha, right[j].data(), n);
+            beta = lanczos_detail::Reorthogonalize(right, j + 1, next, coefs);
+            scale = std::max(scale, beta);
+            if(beta <= eps * scale){
+                beta = 0;
+                if(j + 1 < p){
+                    lanczos_detail::RandomOrthogonal(right, j + 1, next, coefs, generator);
+                }
+            }
+            else{
+                next /= beta;
+            }
+            if(j + 1 < p){
+                std::copy(next.begin(), next.end(), right[j + 1].begin());
+                b[j][j + 1] = beta;
+            }
+        }
+
+        // Ritz triplets: the residual of the i-th is beta times the last entry of its left vector of b
+        ritz = CalculateGolubKahanSVD(b, p, eps);
+        const T largest = ritz.eigenvalues[0][0];
+        size_t converged = 0;
+        while((converged < num_vec)
+            && (std::abs(beta * ritz.left_singular_vectors[p - 1][converged]) <= error_rate * largest)){
+            ++converged;
+        }
+        if(converged == num_vec){
+            break;
+        }
+
+        // Thick restart: keep the leading Ritz vectors and continue from the residual direction
+        const size_t kept = std::min(p - 1, num_vec + (p - num_vec) / 2);
+        Matrix<T> new_right = lanczos_detail::RotateRows(ritz.right_singular_vectors, kept, right);
+        Matrix<T> new_left = lanczos_detail::RotateRows(ritz.left_singular_vectors, kept, left);
+        b = Matrix<T>(p, p, T());
+        for(size_t i = 0; i < kept; ++i){
+            std::copy(new_right[i].begin(), new_right[i].end(), right[i].begin());
+            std::copy(new_left[i].begin(), new_left[i].end(), left[i].begin());
+            b[i][i] = ritz.eigenvalues[i][i];
+            b[i][kept] = beta * ritz.left_singular_vectors[p - 1][i];
+        }
+        std::copy(next.begin(), next.end(), right[kept].begin());
+        start = kept;
+    }
+
+    SVD<T> res;
+    res.eigenvalues = Matrix<T>(num_vec, num_vec, T());
+    Matrix<T> left_factor(p, num_vec, T()), right_factor(p, num_vec, T());
+    for(size_t i = 0; i < num_vec; ++i){
+        res.eigenvalues[i][i] = ritz.eigenvalues[i][i];
+    }
+    for(size_t i = 0; i < p; ++i){
+        std::copy(ritz.left_singular_vectors[i].begin(), ritz.left_singular_vectors[i].begin() + num_vec,
+            left_factor[i].begin());
+        std::copy(ritz.right_singular_vectors[i].begin(), ritz.right_singular_vectors[i].begin() + num_vec,
+            right_factor[i].begin());
+    }
+    res.left_singular_vectors = Transposed(left) * left_factor;
+    res.right_singular_vectors = Transposed(right) * right_factor;
+    return res;
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "matrix.h"
+#include "dense_vector.h"
+#include "sparse_matrix.h"
+#include "gemm.h"
+
+#include <concepts>
+#include <stdexcept>
+#include <utility>
+
+// A linear operator is anything that can be multiplied by a vector and by its transpose without
+// being materialized. For a SizeColumn() x SizeRow() operator A over value_type T:
+//   Apply(x, y)           - y = A * x for contiguous x of SizeRow() and y of SizeColumn() elements;
+//   ApplyTransposed(x, y) - y = A^T * x for contiguous x of SizeColumn() and y of SizeRow() elements.
+// The adapters below hold their operands by reference and the views hold their inner operator by
+// value, so a composition is cheap to copy but must not outlive the matrices it wraps.
+template <typename Op>
+concept LinearOperator = requires(const Op& op, const typename Op::value_type* x, typename Op::value_type* y){
+    { op.SizeRow() } -> std::convertible_to<size_t>;
+    { op.SizeColumn() } -> std::convertible_to<size_t>;
+    op.Apply(x, y);
+    op.ApplyTransposed(x, y);
+};
+
+template <typename T>
+class DenseOperator{
+public:
+    using value_type = T;
+
+    explicit DenseOperator(const Matrix<T>& mat);
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    void Apply(const T* x, T* y) const;
+    void ApplyTransposed(const T* x, T* y) const;
+
+private:
+    const Matrix<T>* mat_;
+};
+
+template <typename T>
+class SparseOperator{
+public:
+    using value_type = T;
+
+    explicit SparseOperator(const SparseMatrix<T>& mat) noexcept;
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    void Apply(const T* x, T* y) const;
+    void ApplyTransposed(const T* x, T* y) const;
+
+private:
+    const SparseMatrix<T>* mat_;
+};
+
+// A - 1 * mean^T: every column of op shifted to zero mean, as for PCA, without densifying op
+template <LinearOperator Op>
+class CenteredOperator{
+public:
+    using value_type = typename Op::value_type;
+
+    explicit CenteredOperator(Op op);
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+    const Vector<value_type>& Mean() const noexcept;
+
+    void Apply(const value_type* x, value_type* y) const;
+    void ApplyTransposed(const value_type* x, value_type* y) const;
+
+private:
+    Op op_;
+    Vector<value_type> mean_;
+};
+
+// A * diag(scale): column j of op multiplied by scale[j]
+template <LinearOperator Op>
+class ScaledOperator{
+public:
+    using value_type = typename Op::value_type;
+
+    ScaledOperator(Op op, Vector<value_type> scale);
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    void Apply(const value_type* x, value_type* y) const;
+    void ApplyTransposed(const value_type* x, value_type* y) const;
+
+private:
+    Op op_;
+    Vector<value_type> scale_;
+    mutable Vector<value_type> buffer_;
+};
+
+// lhs * rhs, applied one factor after the other
+template <LinearOperator Lhs, LinearOperator Rhs>
+class ProductOperator{
+public:
+    using value_type = typename Lhs::value_type;
+
+    ProductOperator(Lhs lhs, Rhs rhs);
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    void Apply(const value_type* x, value_type* y) const;
+    void ApplyTransposed(const value_type* x, value_type* y) const;
+
+private:
+    Lhs lhs_;
+    Rhs rhs_;
+    mutable Vector<value_type> buffer_;
+};
+
+// op^T * op, the square operator whose eigenpairs are the squared singular values of op and its
+// right singular vectors
+template <LinearOperator Op>
+class NormalOperator{
+public:
+    using value_type = typename Op::value_type;
+
+    explicit NormalOperator(Op op);
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    void Apply(const value_type* x, value_type* y) const;
+    void ApplyTransposed(const value_type* x, value_type* y) const;
+
+private:
+    Op op_;
+    mutable Vector<value_type> buffer_;
+};
+
+// res = op * rhs, the product the power iteration and DeflatedMatrix use
+template <LinearOperator Op>
+void Multiply(const Op& op, const Vector<typename Op::value_type>& rhs, Vector<typename Op::value_type>& res);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+template <typename T>
+DenseOperator<T>::DenseOperator(const Matrix<T>& mat)
+    : mat_(&mat){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for an operator");
+    }
+}
+
+template <typename T>
+size_t DenseOperator<T>::SizeRow() const noexcept{
+    return mat_->SizeRow();
+}
+
+template <typename T>
+size_t DenseOperator<T>::SizeColumn() const noexcept{
+    return mat_->SizeColumn();
+}
+
+template <typename T>
+void DenseOperator<T>::Apply(const T* x, T* y) const{
+    Gemv<T>(mat_->SizeColumn(), mat_->SizeRow(), {mat_->Data(), mat_->Stride(), 1}, x, y);
+}
+
+template <typename T>
+void DenseOperator<T>::ApplyTransposed(const T* x, T* y) const{
+    Gemv<T>(mat_->SizeRow(), mat_->SizeColumn(), {mat_->Data(), 1, mat_->Stride()}, x, y);
+}
+
+template <typename T>
+SparseOperator<T>::SparseOperator(const SparseMatrix<T>& mat) noexcept
+    : mat_(&mat){}
+
+template <typename T>
+size_t SparseOperator<T>::SizeRow() const noexcept{
+    return mat_->SizeRow();
+}
+
+template <typename T>
+size_t SparseOperator<T>::SizeColumn() const noexcept{
+    return mat_->SizeColumn();
+}
+
+template <typename T>
+void SparseOperator<T>::Apply(const T* x, T* y) const{
+    mat_->MultiplyVector(x, y);
+}
+
+template <typename T>
+void SparseOperator<T>::ApplyTransposed(const T* x, T* y) const{
+    mat_->MultiplyTransposedVector(x, y);
+}
+
+template <LinearOperator Op>
+CenteredOperator<Op>::CenteredOperator(Op op)
+    : op_(std::move(op))
+    , mean_(op_.SizeRow()){
+    if(op_.SizeColumn() == 0){
+        throw std::invalid_argument("The operator is empty for centering");
+    }
+    const Vector<value_type> ones(op_.SizeColumn(), value_type(1));
+    op_.ApplyTransposed(ones.Data(), mean_.Data());
+    mean_ /= value_type(op_.SizeColumn());
+}
+
+template <LinearOperator Op>
+size_t CenteredOperator<Op>::SizeRow() const noexcept{
+    return op_.SizeRow();
+}
+
+template <LinearOperator Op>
+size_t CenteredOperator<Op>::SizeColumn() const noexcept{
+    return op_.SizeColumn();
+}
+
+template <LinearOperator Op>
+const Vector<typename Op::value_type>& CenteredOperator<Op>::Mean() const noexcept{
+    return mean_;
+}
+
+template <LinearOperator Op>
+void CenteredOperator<Op>::Apply(const value_type* x, value_type* y) const{
+    op_.Apply(x, y);
+    const value_type shift = SimdDot(mean_.Data(), x, mean_.Size());
+    for(size_t i = 0; i < op_.SizeColumn(); ++i){
+        y[i] -= shift;
+    }
+}
+
+template <LinearOperator Op>
+void CenteredOperator<Op>::ApplyTransposed(const value_type* x, value_type* y) const{
+    op_.ApplyTransposed(x, y);
+    value_type sum = 0;
+    for(size_t i = 0; i < op_.SizeColumn(); ++i){
+        sum += x[i];
+    }
+    SimdAxpy(y, -sum, mean_.Data(), mean_.Size());
+}
+
+template <LinearOperator Op>
+ScaledOperator<Op>::ScaledOperator(Op op, Vector<value_type> scale)
+    : op_(std::move(op))
+    , scale_(std::move(scale))
+    , buffer_(scale_.Size()){
+    if(scale_.Size() != op_.SizeRow()){
+        throw std::invalid_argument("The scale is incorrect for the operator");
+    }
+}
+
+template <LinearOperator Op>
+size_t ScaledOperator<Op>::SizeRow() const noexcept{
+    return op_.SizeRow();
+}
+
+template <LinearOperator Op>
+size_t ScaledOperator<Op>::SizeColumn() const noexcept{
+    return op_.SizeColumn();
+}
+
+template <LinearOperator Op>
+void ScaledOperator<Op>::Apply(const value_type* x, value_type* y) const{
+    for(size_t j = 0; j < scale_.Size(); ++j){
+        buffer_[j] = scale_[j] * x[j];
+    }
+    op_.Apply(buffer_.Data(), y);
+}
+
+template <LinearOperator Op>
+void ScaledOperator<Op>::ApplyTransposed(const value_type* x, value_type* y) const{
+    op_.ApplyTransposed(x, y);
+    for(size_t j = 0; j < scale_.Size(); ++j){
+        y[j] *= scale_[j];
+    }
+}
+
+template <LinearOperator Lhs, LinearOperator Rhs>
+ProductOperator<Lhs, Rhs>::ProductOperator(Lhs lhs, Rhs rhs)
+    : lhs_(std::move(lhs))
+    , rhs_(std::move(rhs))
+    , buffer_(rhs_.SizeColumn()){
+    if(lhs_.SizeRow() != rhs_.SizeColumn()){
+        throw std::invalid_argument("The operators are incorrect for multiplication");
+    }
+}
+
+template <LinearOperator Lhs, LinearOperator Rhs>
+size_t ProductOperator<Lhs, Rhs>::SizeRow() const noexcept{
+    return rhs_.SizeRow();
+}
+
+template <LinearOperator Lhs, LinearOperator Rhs>
+size_t ProductOperator<Lhs, Rhs>::SizeColumn() const noexcept{
+    return lhs_.SizeColumn();
+}
+
+template <LinearOperator Lhs, LinearOperator Rhs>
+void ProductOperator<Lhs, Rhs>::Apply(const value_type* x, value_type* y) const{
+    rhs_.Apply(x, buffer_.Data());
+    lhs_.Apply(buffer_.Data(), y);
+}
+
+template <LinearOperator Lhs, LinearOperator Rhs>
+void ProductOperator<Lhs, Rhs>::ApplyTransposed(const value_type* x, value_type* y) const{
+    lhs_.ApplyTransposed(x, buffer_.Data());
+    rhs_.ApplyTransposed(buffer_.Data(), y);
+}
+
+template <LinearOperator Op>
+NormalOperator<Op>::NormalOperator(Op op)
+    : op_(std::move(op))
+    , buffer_(op_.SizeColumn()){}
+
+template <LinearOperator Op>
+size_t NormalOperator<Op>::SizeRow() const noexcept{
+    return op_.SizeRow();
+}
+
+template <LinearOperator Op>
+size_t NormalOperator<Op>::SizeColumn() const noexcept{
+    return op_.SizeRow();
+}
+
+template <LinearOperator Op>
+void NormalOperator<Op>::Apply(const value_type* x, value_type* y) const{
+    op_.Apply(x, buffer_.Data());
+    op_.ApplyTransposed(buffer_.Data(), y);
+}
+
+template <LinearOperator Op>
+void NormalOperator<Op>::ApplyTransposed(const value_type* x, value_type* y) const{
+    Apply(x, y);
+}
+
+template <LinearOperator Op>
+void Multiply(const Op& op, const Vector<typename Op::value_type>& rhs, Vector<typename Op::value_type>& res){
+    if((op.SizeRow() != rhs.Size()) || (op.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    res.Resize(op.SizeColumn());
+    op.Apply(rhs.Data(), res.Data());
+}
@@ -1,5 +1,12 @@
 #pragma once
 
+#include "allocator.h"
+#include "gemm.h"
+#include "simd.h"
+#include "matrix_expression.h"
+#include "thread_pool.h"
+#include "text_reader.h"
+
 #include <vector>
 #include <utility>
 #include <ostream>
@@ -10,38 +17,91 @@
 #include <iterator>
 #include <numeric>
 #include <algorithm>
+#include <initializer_list>
+#include <type_traits>
+
+template <typename T>
+class RowView final{
+public:
+    using value_type = std::remove_const_t<T>;
+    using iterator = T*;
+
+    RowView(T* data, size_t size) noexcept;
+    template <typename U> requires std::is_same_v<const U, T>
+    RowView(const RowView<U>& other) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    T* data() const noexcept;
+
+    T& operator[](size_t index) const noexcept;
+    T& front() const noexcept;
+    T& back() const noexcept;
+
+    iterator begin() const noexcept;
+    iterator end() const noexcept;
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+// Elementwise work below this many elements stays on the calling thread
+inline constexpr size_t PARALLEL_GRAIN = 1 << 16;
+
+template <typename T>
+class TransposedMatrix;
 
 template <typename T>
 class Matrix final{
 public:
-    explicit Matrix(const size_t num_row = 0);
-    explicit Matrix(const size_t num_row, const size_t size_row, const T& val);
+    using value_type = T;
+    using allocator_type = AlignedAllocator<T>;
 
+    explicit Matrix(const size_t num_row = 0, const allocator_type& alloc = allocator_type());
+    explicit Matrix(const size_t num_row, const size_t size_row, const T& val,
+        const allocator_type& alloc = allocator_type());
+
+    Matrix(std::initializer_list<std::vector<T>> data);
     Matrix(const std::vector<std::vector<T>>& data);
     Matrix(std::vector<std::vector<T>>&& data);
 
+    explicit Matrix(const TransposedMatrix<T>& view);
+
+    template <MatrixExpression E>
+    Matrix(const E& expr);
 
     Matrix(const Matrix& other);
+    // Copies other into memory from the resource of alloc
+    Matrix(const Matrix& other, const allocator_type& alloc);
     Matrix(Matrix&& other) noexcept;
 
+    allocator_type GetAllocator() const noexcept;
+
     size_t SizeRow() const noexcept;
     size_t SizeColumn() const noexcept;
     size_t Size() const noexcept;
     size_t ActualSize() const;
 
-    const std::vector<T>& operator[](size_t index) const noexcept;
-    std::vector<T>& operator[](size_t index) noexcept;
+    size_t Stride() const noexcept;
+    T* Data() noexcept;
+    const T* Data() const noexcept;
+
+    RowView<const T> operator[](size_t index) const noexcept;
+    RowView<T> operator[](size_t index) noexcept;
 
     void Swap(Matrix& other) noexcept;
 
     Matrix& operator=(const Matrix& rhs);
     Matrix& operator=(Matrix&& rhs) noexcept;
+    template <MatrixExpression E>
+    Matrix& operator=(const E& expr);
 
-    std::vector<T>& FrontRow();
-    const std::vector<T>& FrontRow() const;
+    RowView<T> FrontRow();
+    RowView<const T> FrontRow() const;
 
-    std::vector<T>& BackRow();
-    const std::vector<T>& BackRow() const;
+    RowView<T> BackRow();
+    RowView<const T> BackRow() const;
 
     void PushBackRow(const std::vector<T>& row);
     void PushBackRow(std::vector<T>&& row);
@@ -55,16 +115,20 @@ public:
 
     void PopBackColumn() noexcept;
 
-    Matrix operator*=(const T& other);
-    Matrix operator*=(const Matrix& other);
+    Matrix& operator*=(const T& other);
+    Matrix& operator*=(const Matrix& other);
 
-    Matrix operator+=(const T& other);
-    Matrix operator+=(const Matrix& other);
+    Matrix& operator+=(const T& other);
+    Matrix& operator+=(const Matrix& other);
+    template <MatrixExpression E>
+    Matrix& operator+=(const E& expr);
 
-    Matrix operator-=(const Matrix& other);
-    Matrix operator-=(const T& other);
+    Matrix& operator-=(const Matrix& other);
+    Matrix& operator-=(const T& other);
+    template <MatrixExpression E>
+    Matrix& operator-=(const E& expr);
 
-    Matrix operator/=(const T& other);
+    Matrix& operator/=(const T& other);
 
     bool operator==(const Matrix& rhs) const;
     bool operator!=(const Matrix& rhs) const;
@@ -73,9 +137,52 @@ public:
     bool Correct() const;
 
 private:
-    std::vector<std::vector<T>> data_;
+    // Rows live back to back in one aligned buffer, each occupying stride_ elements.
+    // Rows may be shorter than the stride, the tail of such a row is kept equal to T().
+    void Restride(size_t new_stride);
+    void AppendRow(const T* row, size_t size);
+    bool Contiguous() const noexcept;
+    // Runs func(begin, end) over ranges of rows, split across the thread pool for large matrices
+    template <typename Func>
+    void ParallelRows(Func&& func) const;
+    // Evaluates the expression in one pass, reusing the buffer when the shape already matches.
+    // Every node reads only the element it writes, so the expression may refer to *this.
+    template <MatrixExpression E>
+    void Assign(const E& expr);
+    template <typename Op, MatrixExpression E>
+    void Update(const E& expr);
+
+    std::vector<T, AlignedAllocator<T>> data_;
+    std::vector<size_t> row_sizes_;
+    size_t stride_ = 0;
 };
 
+// Read-only view of the transpose of a matrix. Products read it through swapped strides,
+// so the transpose is never materialized. The view must not outlive the matrix.
+template <typename T>
+class TransposedMatrix final{
+public:
+    using value_type = T;
+
+    explicit TransposedMatrix(const Matrix<T>& mat) noexcept;
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    const T& operator()(size_t i, size_t j) const noexcept;
+
+    const Matrix<T>& Base() const noexcept;
+    GemmOperand<T> Operand() const noexcept;
+
+private:
+    const Matrix<T>* mat_;
+};
+
+template<typename T>
+TransposedMatrix<T> Transposed(const Matrix<T>& m);
+template<typename T>
+TransposedMatrix<T> Transposed(Matrix<T>&& m) = delete;
+
 template<typename T>
 Matrix<T> Transp(const Matrix<T>& m);
 template<typename T>
@@ -86,80 +193,159 @@ template <typename T>
 std::ostream& operator<<(std::ostream& output, const Matrix<T>& val);
 
 template <typename T>
-Matrix<T> operator-(Matrix<T> m);
+Matrix<T> operator+(Matrix<T> m);
+
 template<typename T>
-Matrix<T> operator-(Matrix<T> lhs, const Matrix<T>& rhs);
-template <typename T>
-Matrix<T> operator-(Matrix<T> lhs, const T& rhs);
+Matrix<T> Multiply(const Matrix<T>& lhs, const Matrix<T>& rhs);
+template<typename T>
+Matrix<T> Multiply(const TransposedMatrix<T>& lhs, const Matrix<T>& rhs);
+template<typename T>
+Matrix<T> Multiply(const Matrix<T>& lhs, const TransposedMatrix<T>& rhs);
+template<typename T>
+Matrix<T> Multiply(const TransposedMatrix<T>& lhs, const TransposedMatrix<T>& rhs);
+
+template<typename T>
+Matrix<T> operator*(const Matrix<T>& lhs, const Matrix<T>& rhs);
+template<typename T>
+Matrix<T> operator*(const TransposedMatrix<T>& lhs, const Matrix<T>& rhs);
+template<typename T>
+Matrix<T> operator*(const Matrix<T>& lhs, const TransposedMatrix<T>& rhs);
+template<typename T>
+Matrix<T> operator*(const TransposedMatrix<T>& lhs, const TransposedMatrix<T>& rhs);
 
 template <typename T>
-Matrix<T> operator+(Matrix<T> m);
+std::vector<T> ParceRowNumbers(std::istream& input);
+
 template<typename T>
-Matrix<T> operator+(Matrix<T> lhs, const Matrix<T>& rhs);
+T Norma(const Matrix<T>& m, size_t num_column = 0);
+
+template<typename T>
+Matrix<T> Normalize(const Matrix<T>& m);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
 template <typename T>
-Matrix<T> operator+(const T& lhs, Matrix<T> rhs);
+RowView<T>::RowView(T* data, size_t size) noexcept
+    : data_(data), size_(size){}
+
 template <typename T>
-Matrix<T> operator+(Matrix<T> lhs, const T& rhs);
+template <typename U> requires std::is_same_v<const U, T>
+RowView<T>::RowView(const RowView<U>& other) noexcept
+    : data_(other.data()), size_(other.size()){}
 
-template<typename T>
-Matrix<T> operator*(Matrix<T> lhs, const Matrix<T>& rhs);
 template <typename T>
-Matrix<T> operator*(const T& lhs, Matrix<T> rhs);
+size_t RowView<T>::size() const noexcept{
+    return size_;
+}
+
 template <typename T>
-Matrix<T> operator*(Matrix<T> lhs, const T& rhs);
+bool RowView<T>::empty() const noexcept{
+    return size_ == 0;
+}
 
 template <typename T>
-Matrix<T> operator/(Matrix<T> lhs, const T& rhs);
+T* RowView<T>::data() const noexcept{
+    return data_;
+}
 
 template <typename T>
-std::vector<T> ParceRowNumbers(std::istream& input);
+T& RowView<T>::operator[](size_t index) const noexcept{
+    return data_[index];
+}
 
 template <typename T>
-Matrix<T> ParceCSRFormat(std::istream& input);
+T& RowView<T>::front() const noexcept{
+    return data_[0];
+}
 
-template<typename T>
-T Norma(const Matrix<T>& m, size_t num_column = 0);
+template <typename T>
+T& RowView<T>::back() const noexcept{
+    return data_[size_ - 1];
+}
 
-template<typename T>
-Matrix<T> Normalize(const Matrix<T>& m);
+template <typename T>
+typename RowView<T>::iterator RowView<T>::begin() const noexcept{
+    return data_;
+}
 
+template <typename T>
+typename RowView<T>::iterator RowView<T>::end() const noexcept{
+    return data_ + size_;
+}
 
-/*---------------------------------------------------------------------------------*/
 
+template<typename T>
+Matrix<T>::Matrix(const size_t num_row, const allocator_type& alloc)
+    : data_(alloc), row_sizes_(num_row, 0){}
 
 template<typename T>
-Matrix<T>::Matrix(const size_t num_row)
-    : Matrix<T>(std::vector<std::vector<T>>(num_row)){}
+Matrix<T>::Matrix(const size_t num_row, const size_t size_row, const T& val, const allocator_type& alloc)
+    : data_(num_row * size_row, val, alloc), row_sizes_(num_row, size_row), stride_(size_row){}
 
 template<typename T>
-Matrix<T>::Matrix(const size_t num_row, const size_t size_row, const T& val)
-    : Matrix<T>(std::vector<std::vector<T>>(num_row, std::vector<T>(size_row, val))){}
+Matrix<T>::Matrix(std::initializer_list<std::vector<T>> data)
+    : Matrix<T>(std::vector<std::vector<T>>(data)){}
 
 template<typename T>
-Matrix<T>::Matrix(const std::vector<std::vector<T>>& data)
-    : data_(data){}
+Matrix<T>::Matrix(const std::vector<std::vector<T>>& data){
+    for(const std::vector<T>& row : data){
+        stride_ = std::max(stride_, row.size());
+    }
+    data_.reserve(data.size() * stride_);
+    row_sizes_.reserve(data.size());
+    for(const std::vector<T>& row : data){
+        AppendRow(row.data(), row.size());
+    }
+}
 
 template<typename T>
 Matrix<T>::Matrix(std::vector<std::vector<T>>&& data)
-    : data_(std::move(data)){}
+    : Matrix<T>(static_cast<const std::vector<std::vector<T>>&>(data)){
+    data.clear();
+}
+
+template<typename T>
+Matrix<T>::Matrix(const TransposedMatrix<T>& view)
+    : Matrix<T>(Transp(view.Base())){}
 
 
+template<typename T>
+template <MatrixExpression E>
+Matrix<T>::Matrix(const E& expr){
+    Assign(expr);
+}
+
 template<typename T>
 Matrix<T>::Matrix(const Matrix<T>& other)
-    : data_(other.data_){}
+    : data_(other.data_), row_sizes_(other.row_sizes_), stride_(other.stride_){}
+
+template<typename T>
+Matrix<T>::Matrix(const Matrix<T>& other, const allocator_type& alloc)
+    : data_(other.data_, alloc), row_sizes_(other.row_sizes_), stride_(other.stride_){}
 
 template<typename T>
 Matrix<T>::Matrix(Matrix&& other) noexcept
-    : data_(std::move(other.data_)){}
+    : data_(std::move(other.data_)), row_sizes_(std::move(other.row_sizes_)), 
+    stride_(std::exchange(other.stride_, 0)){
+    other.data_.clear();
+    other.row_sizes_.clear();
+}
+
+template<typename T>
+typename Matrix<T>::allocator_type Matrix<T>::GetAllocator() const noexcept{
+    return data_.get_allocator();
+}
 
 template<typename T>
 size_t Matrix<T>::SizeRow() const noexcept {
-    return ((data_.size() == 0) ? 0 : data_.front().size());
+    return ((row_sizes_.size() == 0) ? 0 : row_sizes_.front());
 }
 
 template<typename T>
 size_t Matrix<T>::SizeColumn() const noexcept {
-    return data_.size();
+    return row_sizes_.size();
 }
 
 template<typename T>
@@ -169,24 +355,40 @@ size_t Matrix<T>::Size() const noexcept {
 
 template<typename T>
 size_t Matrix<T>::ActualSize() const{
-    return std::accumulate(data_.begin(), data_.end(), 0, 
-    [](size_t sum, const std::vector<T>& row){return sum += row.size();});
+    return std::accumulate(row_sizes_.begin(), row_sizes_.end(), size_t(0));
 }
 
 template<typename T>
-const std::vector<T>& Matrix<T>::operator[](size_t index) const noexcept{
-    return data_[index];
+size_t Matrix<T>::Stride() const noexcept{
+    return stride_;
 }
 
 template<typename T>
-std::vector<T>& Matrix<T>::operator[](size_t index) noexcept{
-    return data_[index];
+T* Matrix<T>::Data() noexcept{
+    return data_.data();
+}
+
+template<typename T>
+const T* Matrix<T>::Data() const noexcept{
+    return data_.data();
+}
+
+template<typename T>
+RowView<const T> Matrix<T>::operator[](size_t index) const noexcept{
+    return {data_.data() + index * stride_, row_sizes_[index]};
+}
+
+template<typename T>
+RowView<T> Matrix<T>::operator[](size_t index) noexcept{
+    return {data_.data() + index * stride_, row_sizes_[index]};
 }
 
 template<typename T>
 void Matrix<T>::Swap(Matrix<T>& other) noexcept{
     if(this != &other){
         std::swap(data_, other.data_);
+        std::swap(row_sizes_, other.row_sizes_);
+        std::swap(stride_, other.stride_);
     }
 }
 
@@ -201,176 +403,331 @@ Matrix<T>& Matrix<T>::operator=(const Matrix<T>& rhs){
 
 template<typename T>
 Matrix<T>& Matrix<T>::operator=(Matrix<T>&& rhs) noexcept{
-    data_ = std::move(rhs.data_);
+    if(this != &rhs){
+        Matrix rhs_moved(std::move(rhs));
+        Swap(rhs_moved);
+    }
+    return *this;
+}
+
+template<typename T>
+template <MatrixExpression E>
+Matrix<T>& Matrix<T>::operator=(const E& expr){
+    Assign(expr);
     return *this;
 }
 
 template<typename T>
-std::vector<T>& Matrix<T>::FrontRow(){
-    return data_.front();
+RowView<T> Matrix<T>::FrontRow(){
+    return (*this)[0];
+}
+
+template<typename T>
+RowView<const T> Matrix<T>::FrontRow() const{
+    return (*this)[0];
+}
+
+template<typename T>
+RowView<T> Matrix<T>::BackRow(){
+    return (*this)[SizeColumn() - 1];
+}
+
+template<typename T>
+RowView<const T> Matrix<T>::BackRow() const{
+    return (*this)[SizeColumn() - 1];
+}
+
+template<typename T>
+void Matrix<T>::Restride(size_t new_stride){
+    std::vector<T, AlignedAllocator<T>> new_data(SizeColumn() * new_stride, T(), data_.get_allocator());
+    for(size_t i = 0; i < SizeColumn(); ++i){
+        std::move(data_.begin() + i * stride_, data_.begin() + i * stride_ + row_sizes_[i],
+            new_data.begin() + i * new_stride);
+    }
+    data_.swap(new_data);
+    stride_ = new_stride;
 }
 
 template<typename T>
-const std::vector<T>& Matrix<T>::FrontRow() const{
-    return data_.front();
+void Matrix<T>::AppendRow(const T* row, size_t size){
+    if(size > stride_){
+        Restride(std::max(size, 2 * stride_));
+    }
+    data_.resize((SizeColumn() + 1) * stride_, T());
+    std::copy(row, row + size, data_.end() - stride_);
+    row_sizes_.push_back(size);
 }
 
 template<typename T>
-std::vector<T>& Matrix<T>::BackRow(){
-    return data_.back();
+bool Matrix<T>::Contiguous() const noexcept{
+    return std::all_of(row_sizes_.begin(), row_sizes_.end(), 
+    [this](size_t size){return size == stride_;});
 }
 
 template<typename T>
-const std::vector<T>& Matrix<T>::BackRow() const{
-    return data_.back();
+template <typename Func>
+void Matrix<T>::ParallelRows(Func&& func) const{
+    ParallelChunks(SizeColumn(), std::max<size_t>(PARALLEL_GRAIN / std::max<size_t>(stride_, 1), 1), func);
+}
+
+template<typename T>
+template <MatrixExpression E>
+void Matrix<T>::Assign(const E& expr){
+    bool same_shape = (SizeColumn() == expr.SizeColumn());
+    for(size_t i = 0; same_shape && (i < SizeColumn()); ++i){
+        same_shape = (row_sizes_[i] == expr.RowSize(i));
+    }
+    if(!same_shape){
+        Matrix res(expr.SizeColumn(), GetAllocator());
+        for(size_t i = 0; i < res.SizeColumn(); ++i){
+            res.row_sizes_[i] = expr.RowSize(i);
+            res.stride_ = std::max(res.stride_, res.row_sizes_[i]);
+        }
+        res.data_.assign(res.SizeColumn() * res.stride_, T());
+        res.Assign(expr);
+        Swap(res);
+        return;
+    }
+    const bool regular = expr.Regular();
+    ParallelRows([&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            T* row = data_.data() + i * stride_;
+            if(regular){
+                for(size_t j = 0; j < row_sizes_[i]; ++j){
+                    row[j] = expr(i, j);
+                }
+            }
+            else{
+                for(size_t j = 0; j < row_sizes_[i]; ++j){
+                    row[j] = expr.At(i, j);
+                }
+            }
+        }
+    });
+}
+
+template<typename T>
+template <typename Op, MatrixExpression E>
+void Matrix<T>::Update(const E& expr){
+    if((SizeRow() != expr.SizeRow()) 
+    || (SizeColumn() != expr.SizeColumn()) 
+    || (expr.SizeRow() == 0)|| (SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for addition");
+    }
+    const bool regular = Correct() && expr.Regular();
+    ParallelRows([&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            T* row = data_.data() + i * stride_;
+            const size_t size = std::min(row_sizes_[i], expr.RowSize(i));
+            if(regular){
+                for(size_t j = 0; j < size; ++j){
+                    row[j] = Op::Apply(row[j], expr(i, j));
+                }
+            }
+            else{
+                for(size_t j = 0; j < size; ++j){
+                    row[j] = Op::Apply(row[j], expr.At(i, j));
+                }
+            }
+        }
+    });
 }
 
 template<typename T>
 void Matrix<T>::PushBackRow(const std::vector<T>& row){
     if(!row.empty()){
-        data_.push_back(row);
+        AppendRow(row.data(), row.size());
     }
 }
 
 template<typename T>
 void Matrix<T>::PushBackRow(std::vector<T>&& row){
-    if(!row.empty()){
-        data_.push_back(std::move(row));
-    }
+    PushBackRow(static_cast<const std::vector<T>&>(row));
 }
 
 template<typename T>
 void Matrix<T>::PushBackRow(const Matrix<T>& mat){
-    for(const std::vector<T>& row : mat.data_){
-        if(!row.empty()){
-            data_.push_back(row);
+    if(this == &mat){
+        PushBackRow(Matrix<T>(mat));
+        return;
+    }
+    for(size_t i = 0; i < mat.SizeColumn(); ++i){
+        if(mat.row_sizes_[i]){
+            AppendRow(mat[i].data(), mat.row_sizes_[i]);
         }
     }
 }
 
 template<typename T>
 void Matrix<T>::PushBackRow(Matrix<T>&& mat){
-    for(std::vector<T>&& row : mat.data_){
-        if(!row.empty()){
-            data_.push_back(std::move(row));
-        }
-    }
+    PushBackRow(static_cast<const Matrix<T>&>(mat));
 }
 
 template<typename T>
 void Matrix<T>::PushBackColumn(const Matrix& mat){
-    data_.resize(std::max(SizeColumn(), mat.SizeColumn()));
-    for(size_t i = 0; i < SizeColumn(); ++i){
-        data_[i].insert(data_[i].end(), mat[i].begin(), mat[i].end());
+    size_t new_size_column = std::max(SizeColumn(), mat.SizeColumn());
+    size_t new_stride = stride_;
+    for(size_t i = 0; i < new_size_column; ++i){
+        size_t lhs_size = (i < SizeColumn()) ? row_sizes_[i] : 0;
+        size_t rhs_size = (i < mat.SizeColumn()) ? mat.row_sizes_[i] : 0;
+        new_stride = std::max(new_stride, lhs_size + rhs_size);
+    }
+    if(new_stride > stride_){
+        Restride(std::max(new_stride, 2 * stride_));
+    }
+    data_.resize(new_size_column * stride_, T());
+    row_sizes_.resize(new_size_column, 0);
+    for(size_t i = 0; i < mat.SizeColumn(); ++i){
+        std::copy(mat[i].begin(), mat[i].end(), data_.begin() + i * stride_ + row_sizes_[i]);
+        row_sizes_[i] += mat.row_sizes_[i];
     }
 }
 
 template<typename T>
 void Matrix<T>::PushBackColumn(Matrix&& mat){
-    data_.resize(std::max(SizeColumn(), mat.SizeColumn()));
-    for(size_t i = 0; i < SizeColumn(); ++i){
-        data_[i].insert(data_[i].end(),
-            std::make_move_iterator(mat[i].begin()), 
-            std::make_move_iterator(mat[i].end()));
-    }
+    PushBackColumn(static_cast<const Matrix&>(mat));
 }
 
 template<typename T>
 void Matrix<T>::PopBackRow() noexcept{
     if(SizeColumn()){
-        data_.pop_back();
+        row_sizes_.pop_back();
+        data_.resize(SizeColumn() * stride_);
     }
 }
 
 template<typename T>
 void Matrix<T>::PopBackColumn() noexcept{
     for(size_t i = 0; i < SizeColumn(); ++i){
-        if(!data_[i].empty()){
-            data_[i].pop_back();
+        if(row_sizes_[i]){
+            data_[i * stride_ + --row_sizes_[i]] = T();
         }
     }
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator*=(const Matrix<T>& other){
-    if((SizeRow() != other.SizeColumn())
-     || (other.SizeRow() == 0) || (SizeRow() == 0)){
-        throw std::invalid_argument("The matrices are incorrect for multiplication");
-    }
-    Matrix res(SizeColumn(), other.SizeRow(), T());
-    for(size_t i = 0; i < SizeColumn(); ++i){
-        for(size_t j = 0; j < other.SizeRow(); ++j){
-            T new_val = 0;
-            for(size_t k = 0; k < SizeRow(); ++k){
-                new_val += data_[i][k] * other[k][j];
-            }
-            res[i][j] = new_val;
-        }
-    }
+Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& other){
+    Matrix res = Multiply(*this, other);
     Swap(res);
     return *this;
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator*=(const T& other){
+Matrix<T>& Matrix<T>::operator*=(const T& other){
     if(Empty()){
         throw std::invalid_argument("The matrix is empty for multiplication");
     }
-    for(size_t i = 0; i < SizeColumn(); ++i){
-        for(size_t j = 0; j < data_[i].size(); ++j){
-            data_[i][j] *= other;
+    const bool contiguous = Contiguous();
+    ParallelRows([&](size_t begin, size_t end){
+        if(contiguous){
+            SimdScale(data_.data() + begin * stride_, other, (end - begin) * stride_);
+            return;
         }
-    }
+        for(size_t i = begin; i < end; ++i){
+            SimdScale(data_.data() + i * stride_, other, row_sizes_[i]);
+        }
+    });
     return *this;
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator+=(const T& other){
+Matrix<T>& Matrix<T>::operator+=(const T& other){
     if(Empty()){
         throw std::invalid_argument("The matrix is empty for addition");
     }
-    for(size_t i = 0; i < SizeColumn(); ++i){
-        for(size_t j = 0; j < data_[i].size(); ++j){
-            data_[i][j] += other;
+    const bool contiguous = Contiguous();
+    ParallelRows([&](size_t begin, size_t end){
+        if(contiguous){
+            SimdAddScalar(data_.data() + begin * stride_, other, (end - begin) * stride_);
+            return;
         }
-    }
+        for(size_t i = begin; i < end; ++i){
+            SimdAddScalar(data_.data() + i * stride_, other, row_sizes_[i]);
+        }
+    });
     return *this;
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator+=(const Matrix& other){
+Matrix<T>& Matrix<T>::operator+=(const Matrix& other){
     if((SizeRow() != other.SizeRow()) 
     || (SizeColumn() != other.SizeColumn()) 
     || (other.SizeRow() == 0)|| (SizeRow() == 0)){
         throw std::invalid_argument("The matrices are incorrect for addition");
     }
-    for(size_t i = 0; i < SizeColumn(); ++i){
-        size_t size_row = std::min(data_[i].size(), other[i].size());
-        for(size_t j = 0; j < size_row; ++j){
-            data_[i][j] += other[i][j];
+    const bool contiguous = (stride_ == other.stride_) && Contiguous() && other.Contiguous();
+    ParallelRows([&](size_t begin, size_t end){
+        if(contiguous){
+            SimdAdd(data_.data() + begin * stride_, other.data_.data() + begin * stride_, (end - begin) * stride_);
+            return;
+        }
+        for(size_t i = begin; i < end; ++i){
+            SimdAdd(data_.data() + i * stride_, other.data_.data() + i * other.stride_,
+                std::min(row_sizes_[i], other.row_sizes_[i]));
         }
+    });
+    return *this;
+}
+
+template<typename T>
+template <MatrixExpression E>
+Matrix<T>& Matrix<T>::operator+=(const E& expr){
+    Update<AddOp>(expr);
+    return *this;
+}
+
+template<typename T>
+Matrix<T>& Matrix<T>::operator-=(const Matrix& other){
+    if((SizeRow() != other.SizeRow()) 
+    || (SizeColumn() != other.SizeColumn()) 
+    || (other.SizeRow() == 0)|| (SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for addition");
     }
+    const bool contiguous = (stride_ == other.stride_) && Contiguous() && other.Contiguous();
+    ParallelRows([&](size_t begin, size_t end){
+        if(contiguous){
+            SimdSub(data_.data() + begin * stride_, other.data_.data() + begin * stride_, (end - begin) * stride_);
+            return;
+        }
+        for(size_t i = begin; i < end; ++i){
+            SimdSub(data_.data() + i * stride_, other.data_.data() + i * other.stride_,
+                std::min(row_sizes_[i], other.row_sizes_[i]));
+        }
+    });
     return *this;
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator-=(const Matrix& other){
+Matrix<T>& Matrix<T>::operator-=(const T& other){
     return *this += -other;
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator-=(const T& other){
-    return *this += -other;
+template <MatrixExpression E>
+Matrix<T>& Matrix<T>::operator-=(const E& expr){
+    Update<SubOp>(expr);
+    return *this;
 }
 
 template<typename T>
-Matrix<T> Matrix<T>::operator/=(const T& other){
+Matrix<T>& Matrix<T>::operator/=(const T& other){
     return *this *= 1.0 / other;
 }
 
 template<typename T>
 bool Matrix<T>::operator==(const Matrix& rhs) const{
-    return (this == &rhs) || (data_ == rhs.data_);
+    if(this == &rhs){
+        return true;
+    }
+    if(row_sizes_ != rhs.row_sizes_){
+        return false;
+    }
+    for(size_t i = 0; i < SizeColumn(); ++i){
+        if(!std::equal((*this)[i].begin(), (*this)[i].end(), rhs[i].begin())){
+            return false;
+        }
+    }
+    return true;
 }
 
 template<typename T>
@@ -380,48 +737,147 @@ bool Matrix<T>::operator!=(const Matrix& rhs) const{
 
 template<typename T>
 bool Matrix<T>::Empty() const{
-    return (std::find_if(data_.begin(), data_.end(), 
-    [](const std::vector<T>& row){return row.size();}) 
-    == data_.end());
+    return (std::find_if(row_sizes_.begin(), row_sizes_.end(), 
+    [](size_t size){return size;}) 
+    == row_sizes_.end());
 }
 
 template<typename T>
 bool Matrix<T>::Correct() const{
-    for(const std::vector<T>& row : data_){
-        if(row.size() != SizeRow()){
+    for(size_t size : row_sizes_){
+        if(size != SizeRow()){
             return false;
         }
     }
     return SizeRow();
 }
 
+template <typename T>
+TransposedMatrix<T>::TransposedMatrix(const Matrix<T>& mat) noexcept
+    : mat_(&mat){}
+
+template <typename T>
+size_t TransposedMatrix<T>::SizeRow() const noexcept{
+    return mat_->SizeColumn();
+}
+
+template <typename T>
+size_t TransposedMatrix<T>::SizeColumn() const noexcept{
+    return mat_->SizeRow();
+}
+
+template <typename T>
+const T& TransposedMatrix<T>::operator()(size_t i, size_t j) const noexcept{
+    return mat_->Data()[j * mat_->Stride() + i];
+}
+
+template <typename T>
+const Matrix<T>& TransposedMatrix<T>::Base() const noexcept{
+    return *mat_;
+}
+
+template <typename T>
+GemmOperand<T> TransposedMatrix<T>::Operand() const noexcept{
+    return {mat_->Data(), 1, mat_->Stride()};
+}
+
 template<typename T>
-Matrix<T> Transp(const Matrix<T>& m){
-    Matrix<T> res;
-    for(size_t i = 0; i < m.SizeRow(); ++i){
-        std::vector<T> new_row;
-        for(size_t j = 0; j < m.SizeColumn(); ++j){
-            new_row.push_back(m[j][i]);
+TransposedMatrix<T> Transposed(const Matrix<T>& m){
+    return TransposedMatrix<T>(m);
+}
+
+
+namespace matrix_detail{
+
+// Halves the longer side until the block fits in L1, so every level of the cache is used
+// without tuning the block size for it.
+template <typename T>
+void TransposeBlock(const T* src, size_t src_stride, T* dst, size_t dst_stride, size_t rows, size_t cols){
+    if((rows <= 32) && (cols <= 32)){
+        // Reading the block across rows keeps the stores sequential
+        for(size_t j = 0; j < cols; ++j){
+            for(size_t i = 0; i < rows; ++i){
+                dst[j * dst_stride + i] = src[i * src_stride + j];
+            }
         }
-        res.PushBackRow(std::move(new_row));
+        return;
+    }
+    if(rows >= cols){
+        const size_t half = rows / 2;
+        TransposeBlock(src, src_stride, dst, dst_stride, half, cols);
+        TransposeBlock(src + half * src_stride, src_stride, dst + half, dst_stride, rows - half, cols);
+        return;
+    }
+    const size_t half = cols / 2;
+    TransposeBlock(src, src_stride, dst, dst_stride, rows, half);
+    TransposeBlock(src + half, src_stride, dst + half * dst_stride, dst_stride, rows, cols - half);
+}
+
+// res[m x n] = A[m x k] * B[k x n] for operands in any layout.
+template <typename T>
+Matrix<T> Product(size_t m, size_t n, size_t k, GemmOperand<T> a, GemmOperand<T> b){
+    Matrix<T> res(m, n, T());
+    if((n == 1) && (b.row_stride == 1)){
+        Gemv<T>(m, k, a, b.data, res.Data());
+        return res;
     }
+    Gemm<T>(m, n, k, a, b, res.Data(), res.Stride());
     return res;
 }
 
+template <typename L, typename R>
+void CheckProduct(const L& lhs, const R& rhs){
+    if((lhs.SizeRow() != rhs.SizeColumn())
+     || (rhs.SizeRow() == 0) || (lhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+}
+
+} // namespace matrix_detail
+
 template<typename T>
-Matrix<T> Transp(Matrix<T>&& m){
-    Matrix<T> res;
-    for(size_t i = 0; i < m.SizeRow(); ++i){
-        std::vector<T> new_row;
-        new_row.reserve(m.SizeColumn());
-        for(size_t j = 0; j < m.SizeColumn(); ++j){
-            new_row.push_back(std::move(m[j][i]));
-        }
-        res.PushBackRow(std::move(new_row));
+Matrix<T> Transp(const Matrix<T>& m){
+    if(m.SizeRow() == 0){
+        return Matrix<T>();
     }
+    Matrix<T> res(m.SizeRow(), m.SizeColumn(), T());
+    matrix_detail::TransposeBlock(m.Data(), m.Stride(), res.Data(), res.Stride(), m.SizeColumn(), m.SizeRow());
     return res;
 }
 
+template<typename T>
+Matrix<T> Transp(Matrix<T>&& m){
+    return Transp(static_cast<const Matrix<T>&>(m));
+}
+
+template<typename T>
+Matrix<T> Multiply(const Matrix<T>& lhs, const Matrix<T>& rhs){
+    matrix_detail::CheckProduct(lhs, rhs);
+    return matrix_detail::Product<T>(lhs.SizeColumn(), rhs.SizeRow(), lhs.SizeRow(),
+        {lhs.Data(), lhs.Stride(), 1}, {rhs.Data(), rhs.Stride(), 1});
+}
+
+template<typename T>
+Matrix<T> Multiply(const TransposedMatrix<T>& lhs, const Matrix<T>& rhs){
+    matrix_detail::CheckProduct(lhs, rhs);
+    return matrix_detail::Product<T>(lhs.SizeColumn(), rhs.SizeRow(), lhs.SizeRow(),
+        lhs.Operand(), {rhs.Data(), rhs.Stride(), 1});
+}
+
+template<typename T>
+Matrix<T> Multiply(const Matrix<T>& lhs, const TransposedMatrix<T>& rhs){
+    matrix_detail::CheckProduct(lhs, rhs);
+    return matrix_detail::Product<T>(lhs.SizeColumn(), rhs.SizeRow(), lhs.SizeRow(),
+        {lhs.Data(), lhs.Stride(), 1}, rhs.Operand());
+}
+
+template<typename T>
+Matrix<T> Multiply(const TransposedMatrix<T>& lhs, const TransposedMatrix<T>& rhs){
+    matrix_detail::CheckProduct(lhs, rhs);
+    return matrix_detail::Product<T>(lhs.SizeColumn(), rhs.SizeRow(), lhs.SizeRow(),
+        lhs.Operand(), rhs.Operand());
+}
+
 template <typename T>
 std::ostream& operator<<(std::ostream& output, const Matrix<T>& val) {
     for(size_t i = 0; i < val.SizeColumn(); ++i){
@@ -434,52 +890,26 @@ std::ostream& operator<<(std::ostream& output, const Matrix<T>& val) {
     return output;
 }
 
-template <typename T>
-Matrix<T> operator-(Matrix<T> m){
-    return m *= -1;
-}
-template <typename T>
-Matrix<T> operator-(Matrix<T> lhs, const T& rhs){
-    return lhs -= rhs;
-}
-template<typename T>
-Matrix<T> operator-(Matrix<T> lhs, const Matrix<T>& rhs) {
-    return lhs -= rhs;
-}
-
 template <typename T>
 Matrix<T> operator+(Matrix<T> m){
     return m;
 }
-template <typename T>
-Matrix<T> operator+(const T& lhs, Matrix<T> rhs){
-    return rhs += lhs;
-}
-template <typename T>
-Matrix<T> operator+(Matrix<T> lhs, const T& rhs){
-    return lhs += rhs;
-}
-template<typename T>
-Matrix<T> operator+(Matrix<T> lhs, const Matrix<T>& rhs) {
-    return lhs += rhs;
-}
 
-template <typename T>
-Matrix<T> operator*(const T& lhs, Matrix<T> rhs){
-    return rhs *= lhs;
+template<typename T>
+Matrix<T> operator*(const Matrix<T>& lhs, const Matrix<T>& rhs) {
+    return Multiply(lhs, rhs);
 }
-template <typename T>
-Matrix<T> operator*(Matrix<T> lhs, const T& rhs){
-    return lhs *= rhs;
+template<typename T>
+Matrix<T> operator*(const TransposedMatrix<T>& lhs, const Matrix<T>& rhs) {
+    return Multiply(lhs, rhs);
 }
 template<typename T>
-Matrix<T> operator*(Matrix<T> lhs, const Matrix<T>& rhs) {
-    return lhs *= rhs;
+Matrix<T> operator*(const Matrix<T>& lhs, const TransposedMatrix<T>& rhs) {
+    return Multiply(lhs, rhs);
 }
-
-template <typename T>
-Matrix<T> operator/(Matrix<T> lhs, const T& rhs){
-    return lhs /= rhs;
+template<typename T>
+Matrix<T> operator*(const TransposedMatrix<T>& lhs, const TransposedMatrix<T>& rhs) {
+    return Multiply(lhs, rhs);
 }
 
 
@@ -488,37 +918,20 @@ std::vector<T> ParceRowNumbers(std::istream& input){
     std::vector<T> res;
     std::string line;
     std::getline(input, line);
-    std::stringstream numbers;
-    numbers << std::move(line);
-    for(T num; !numbers.eof(); ){
-        numbers >> num;
-        res.push_back(std::move(num));
-    }
-    return res;
-}
-
-template <typename T>
-Matrix<T> ParceCSRFormat(std::istream& input){
-    size_t size_row, size_column;
-    input >> size_row >> size_column;
-    input.get();
-    std::vector<size_t> indices = ParceRowNumbers<size_t>(input);
-    std::vector<size_t> indptr = ParceRowNumbers<size_t>(input);
-    std::vector<T> data = ParceRowNumbers<T>(input);
-    Matrix<T> res(size_column, size_row, T());
-    for(size_t i = 1; i < size_column + 1; ++i){
-        for(size_t j = indptr[i - 1]; j < indptr[i]; ++j){
-            res[i - 1][indices[j]] = data[j];
-        }
-    }
+    ParceNumbers(line.data(), line.data() + line.size(), res);
     return res;
 }
 
 template<typename T>
 T Norma(const Matrix<T>& m, size_t num_column){
+    if(m.Stride() == 1){
+        return std::sqrt(SimdSumSquares(m.Data(), m.SizeColumn()));
+    }
     T res = 0;
+    const T* column = m.Data() + num_column;
     for(size_t j = 0; j < m.SizeColumn(); ++j){
-        res += std::pow(m[j][num_column], 2);
+        const T val = column[j * m.Stride()];
+        res += val * val;
     }
     res = std::sqrt(res);
     return res;
@@ -527,11 +940,23 @@ T Norma(const Matrix<T>& m, size_t num_column){
 template<typename T>
 Matrix<T> Normalize(const Matrix<T>& m){
     Matrix res(m.SizeColumn(), m.SizeRow(), T());
-    for(size_t i = 0; i < m.SizeRow(); ++i){
-        T coef = Norma(m, i);
+    if(m.SizeRow() == 1){
         for(size_t j = 0; j < m.SizeColumn(); ++j){
-            res[j][i] = m[j][i] / coef;
+            res[j][0] = m.Data()[j * m.Stride()];
         }
+        SimdScale(res.Data(), T(1) / Norma(m), m.SizeColumn());
+        return res;
+    }
+    std::vector<T, AlignedAllocator<T>> coefs(m.SizeRow(), T());
+    for(size_t j = 0; j < m.SizeColumn(); ++j){
+        SimdAddSquares(coefs.data(), m.Data() + j * m.Stride(), m.SizeRow());
+    }
+    for(T& coef : coefs){
+        coef = T(1) / std::sqrt(coef);
+    }
+    for(size_t j = 0; j < m.SizeColumn(); ++j){
+        std::copy(m.Data() + j * m.Stride(), m.Data() + j * m.Stride() + m.SizeRow(), res[j].begin());
+        SimdMul(res[j].data(), coefs.data(), m.SizeRow());
     }
     return res;
-}
\ No newline at end of file
+}
@@ -0,0 +1,435 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <ostream>
+#include <cmath>
+
+template <typename T>
+class Matrix;
+
+// Elementwise arithmetic on matrices builds a tree of lightweight nodes instead of temporaries.
+// The whole tree is evaluated in a single pass when it is assigned to a Matrix.
+// Every node exposes the same interface:
+//   SizeColumn(), SizeRow(), RowSize(i), Empty() - the shape of the result;
+//   Regular() - every row of every operand holds exactly SizeRow() elements;
+//   operator()(i, j) - the element, valid for j < SizeRow() of a regular tree;
+//   At(i, j) - the element for any j < RowSize(i), missing elements of an operand count as zero.
+
+template <typename E>
+struct IsMatrixExpression : std::false_type{};
+
+template <typename E>
+concept MatrixExpression = IsMatrixExpression<std::remove_cvref_t<E>>::value;
+
+template <typename E>
+struct IsMatrix : std::false_type{};
+template <typename T>
+struct IsMatrix<Matrix<T>> : std::true_type{};
+
+template <typename E>
+concept MatrixOperand = MatrixExpression<E> || IsMatrix<std::remove_cvref_t<E>>::value;
+
+template <MatrixOperand E>
+using ExpressionValue = typename std::remove_cvref_t<E>::value_type;
+
+template <typename T, typename Storage>
+class MatrixLeaf{
+public:
+    using value_type = T;
+
+    template <typename M>
+    explicit MatrixLeaf(M&& mat);
+
+    size_t SizeColumn() const noexcept;
+    size_t SizeRow() const noexcept;
+    size_t RowSize(size_t i) const noexcept;
+    bool Empty() const;
+    bool Regular() const;
+
+    T operator()(size_t i, size_t j) const noexcept;
+    T At(size_t i, size_t j) const noexcept;
+
+private:
+    Storage mat_;
+};
+
+template <typename Op, typename L, typename R>
+class BinaryExpression{
+public:
+    using value_type = typename L::value_type;
+
+    BinaryExpression(L lhs, R rhs);
+
+    size_t SizeColumn() const noexcept;
+    size_t SizeRow() const noexcept;
+    size_t RowSize(size_t i) const noexcept;
+    bool Empty() const;
+    bool Regular() const;
+
+    value_type operator()(size_t i, size_t j) const noexcept;
+    value_type At(size_t i, size_t j) const noexcept;
+
+private:
+    L lhs_;
+    R rhs_;
+};
+
+template <typename Op, typename E>
+class ScalarExpression{
+public:
+    using value_type = typename E::value_type;
+
+    ScalarExpression(E expr, const value_type& val);
+
+    size_t SizeColumn() const noexcept;
+    size_t SizeRow() const noexcept;
+    size_t RowSize(size_t i) const noexcept;
+    bool Empty() const;
+    bool Regular() const;
+
+    value_type operator()(size_t i, size_t j) const noexcept;
+    value_type At(size_t i, size_t j) const noexcept;
+
+private:
+    E expr_;
+    value_type val_;
+};
+
+template <typename T, typename Storage>
+struct IsMatrixExpression<MatrixLeaf<T, Storage>> : std::true_type{};
+template <typename Op, typename L, typename R>
+struct IsMatrixExpression<BinaryExpression<Op, L, R>> : std::true_type{};
+template <typename Op, typename E>
+struct IsMatrixExpression<ScalarExpression<Op, E>> : std::true_type{};
+
+struct AddOp{
+    template <typename T>
+    static T Apply(const T& lhs, const T& rhs){
+        return lhs + rhs;
+    }
+};
+
+struct SubOp{
+    template <typename T>
+    static T Apply(const T& lhs, const T& rhs){
+        return lhs - rhs;
+    }
+};
+
+struct MulOp{
+    template <typename T>
+    static T Apply(const T& lhs, const T& rhs){
+        return lhs * rhs;
+    }
+};
+
+template <MatrixOperand L, MatrixOperand R>
+    requires std::is_same_v<ExpressionValue<L>, ExpressionValue<R>>
+auto operator+(L&& lhs, R&& rhs);
+template <MatrixOperand L, MatrixOperand R>
+    requires std::is_same_v<ExpressionValue<L>, ExpressionValue<R>>
+auto operator-(L&& lhs, R&& rhs);
+
+template <MatrixOperand E>
+auto operator-(E&& m);
+template <MatrixOperand E>
+auto operator-(E&& lhs, const ExpressionValue<E>& rhs);
+
+template <MatrixOperand E>
+auto operator+(E&& lhs, const ExpressionValue<E>& rhs);
+template <MatrixOperand E>
+auto operator+(const ExpressionValue<E>& lhs, E&& rhs);
+
+template <MatrixOperand E>
+auto operator*(E&& lhs, const ExpressionValue<E>& rhs);
+template <MatrixOperand E>
+auto operator*(const ExpressionValue<E>& lhs, E&& rhs);
+
+template <MatrixOperand E>
+auto operator/(E&& lhs, const ExpressionValue<E>& rhs);
+
+template <MatrixOperand L, MatrixOperand R>
+    requires (MatrixExpression<L> || MatrixExpression<R>)
+Matrix<ExpressionValue<L>> operator*(const L& lhs, const R& rhs);
+
+template <MatrixExpression E>
+bool operator==(const E& lhs, const Matrix<ExpressionValue<E>>& rhs);
+template <MatrixExpression E>
+bool operator!=(const E& lhs, const Matrix<ExpressionValue<E>>& rhs);
+
+template <MatrixExpression E>
+std::ostream& operator<<(std::ostream& output, const E& expr);
+
+template <MatrixExpression E>
+ExpressionValue<E> Norma(const E& expr, size_t num_column = 0);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+template <typename T, typename Storage>
+template <typename M>
+MatrixLeaf<T, Storage>::MatrixLeaf(M&& mat)
+    : mat_(std::forward<M>(mat)){}
+
+template <typename T, typename Storage>
+size_t MatrixLeaf<T, Storage>::SizeColumn() const noexcept{
+    return mat_.SizeColumn();
+}
+
+template <typename T, typename Storage>
+size_t MatrixLeaf<T, Storage>::SizeRow() const noexcept{
+    return mat_.SizeRow();
+}
+
+template <typename T, typename Storage>
+size_t MatrixLeaf<T, Storage>::RowSize(size_t i) const noexcept{
+    return mat_[i].size();
+}
+
+template <typename T, typename Storage>
+bool MatrixLeaf<T, Storage>::Empty() const{
+    return mat_.Empty();
+}
+
+template <typename T, typename Storage>
+bool MatrixLeaf<T, Storage>::Regular() const{
+    return mat_.Correct();
+}
+
+template <typename T, typename Storage>
+T MatrixLeaf<T, Storage>::operator()(size_t i, size_t j) const noexcept{
+    return mat_.Data()[i * mat_.Stride() + j];
+}
+
+template <typename T, typename Storage>
+T MatrixLeaf<T, Storage>::At(size_t i, size_t j) const noexcept{
+    return (j < mat_[i].size()) ? (*this)(i, j) : T();
+}
+
+
+template <typename Op, typename L, typename R>
+BinaryExpression<Op, L, R>::BinaryExpression(L lhs, R rhs)
+    : lhs_(std::move(lhs)), rhs_(std::move(rhs)){
+    if((lhs_.SizeRow() != rhs_.SizeRow())
+    || (lhs_.SizeColumn() != rhs_.SizeColumn())
+    || (rhs_.SizeRow() == 0)|| (lhs_.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for addition");
+    }
+}
+
+template <typename Op, typename L, typename R>
+size_t BinaryExpression<Op, L, R>::SizeColumn() const noexcept{
+    return lhs_.SizeColumn();
+}
+
+template <typename Op, typename L, typename R>
+size_t BinaryExpression<Op, L, R>::SizeRow() const noexcept{
+    return lhs_.SizeRow();
+}
+
+template <typename Op, typename L, typename R>
+size_t BinaryExpression<Op, L, R>::RowSize(size_t i) const noexcept{
+    return lhs_.RowSize(i);
+}
+
+template <typename Op, typename L, typename R>
+bool BinaryExpression<Op, L, R>::Empty() const{
+    return lhs_.Empty();
+}
+
+template <typename Op, typename L, typename R>
+bool BinaryExpression<Op, L, R>::Regular() const{
+    return lhs_.Regular() && rhs_.Regular();
+}
+
+template <typename Op, typename L, typename R>
+typename BinaryExpression<Op, L, R>::value_type
+BinaryExpression<Op, L, R>::operator()(size_t i, size_t j) const noexcept{
+    return Op::Apply(lhs_(i, j), rhs_(i, j));
+}
+
+template <typename Op, typename L, typename R>
+typename BinaryExpression<Op, L, R>::value_type
+BinaryExpression<Op, L, R>::At(size_t i, size_t j) const noexcept{
+    return Op::Apply(lhs_.At(i, j), rhs_.At(i, j));
+}
+
+
+template <typename Op, typename E>
+ScalarExpression<Op, E>::ScalarExpression(E expr, const value_type& val)
+    : expr_(std::move(expr)), val_(val){
+    if(expr_.Empty()){
+        throw std::invalid_argument("The matrix is empty for this operation");
+    }
+}
+
+template <typename Op, typename E>
+size_t ScalarExpression<Op, E>::SizeColumn() const noexcept{
+    return expr_.SizeColumn();
+}
+
+template <typename Op, typename E>
+size_t ScalarExpression<Op, E>::SizeRow() const noexcept{
+    return expr_.SizeRow();
+}
+
+template <typename Op, typename E>
+size_t ScalarExpression<Op, E>::RowSize(size_t i) const noexcept{
+    return expr_.RowSize(i);
+}
+
+template <typename Op, typename E>
+bool ScalarExpression<Op, E>::Empty() const{
+    return expr_.Empty();
+}
+
+template <typename Op, typename E>
+bool ScalarExpression<Op, E>::Regular() const{
+    return expr_.Regular();
+}
+
+template <typename Op, typename E>
+typename ScalarExpression<Op, E>::value_type
+ScalarExpression<Op, E>::operator()(size_t i, size_t j) const noexcept{
+    return Op::Apply(expr_(i, j), val_);
+}
+
+template <typename Op, typename E>
+typename ScalarExpression<Op, E>::value_type
+ScalarExpression<Op, E>::At(size_t i, size_t j) const noexcept{
+    // Elements missing from a ragged row stay missing, the result keeps the operand's shape
+    return Op::Apply(expr_.At(i, j), val_);
+}
+
+
+namespace expression_detail{
+
+// Named matrices are referenced, temporaries are moved into the node that uses them,
+// so an expression built from the result of a product stays valid until it is evaluated.
+template <typename E>
+struct Operand{
+    using type = std::remove_cvref_t<E>;
+};
+
+template <typename T>
+struct Operand<Matrix<T>&>{
+    using type = MatrixLeaf<T, const Matrix<T>&>;
+};
+
+template <typename T>
+struct Operand<const Matrix<T>&>{
+    using type = MatrixLeaf<T, const Matrix<T>&>;
+};
+
+template <typename T>
+struct Operand<Matrix<T>>{
+    using type = MatrixLeaf<T, Matrix<T>>;
+};
+
+template <typename T>
+struct Operand<const Matrix<T>>{
+    using type = MatrixLeaf<T, Matrix<T>>;
+};
+
+template <typename E>
+typename Operand<E>::type MakeOperand(E&& expr){
+    return typename Operand<E>::type(std::forward<E>(expr));
+}
+
+} // namespace expression_detail
+
+template <MatrixOperand L, MatrixOperand R>
+    requires std::is_same_v<ExpressionValue<L>, ExpressionValue<R>>
+auto operator+(L&& lhs, R&& rhs){
+    using namespace expression_detail;
+    return BinaryExpression<AddOp, typename Operand<L>::type, typename Operand<R>::type>(
+        MakeOperand(std::forward<L>(lhs)), MakeOperand(std::forward<R>(rhs)));
+}
+
+template <MatrixOperand L, MatrixOperand R>
+    requires std::is_same_v<ExpressionValue<L>, ExpressionValue<R>>
+auto operator-(L&& lhs, R&& rhs){
+    using namespace expression_detail;
+    return BinaryExpression<SubOp, typename Operand<L>::type, typename Operand<R>::type>(
+        MakeOperand(std::forward<L>(lhs)), MakeOperand(std::forward<R>(rhs)));
+}
+
+template <MatrixOperand E>
+auto operator-(E&& m){
+    using namespace expression_detail;
+    return ScalarExpression<MulOp, typename Operand<E>::type>(
+        MakeOperand(std::forward<E>(m)), ExpressionValue<E>(-1));
+}
+
+template <MatrixOperand E>
+auto operator-(E&& lhs, const ExpressionValue<E>& rhs){
+    return std::forward<E>(lhs) + ExpressionValue<E>(-rhs);
+}
+
+template <MatrixOperand E>
+auto operator+(E&& lhs, const ExpressionValue<E>& rhs){
+    using namespace expression_detail;
+    return ScalarExpression<AddOp, typename Operand<E>::type>(MakeOperand(std::forward<E>(lhs)), rhs);
+}
+
+template <MatrixOperand E>
+auto operator+(const ExpressionValue<E>& lhs, E&& rhs){
+    return std::forward<E>(rhs) + lhs;
+}
+
+template <MatrixOperand E>
+auto operator*(E&& lhs, const ExpressionValue<E>& rhs){
+    using namespace expression_detail;
+    return ScalarExpression<MulOp, typename Operand<E>::type>(MakeOperand(std::forward<E>(lhs)), rhs);
+}
+
+template <MatrixOperand E>
+auto operator*(const ExpressionValue<E>& lhs, E&& rhs){
+    return std::forward<E>(rhs) * lhs;
+}
+
+template <MatrixOperand E>
+auto operator/(E&& lhs, const ExpressionValue<E>& rhs){
+    return std::forward<E>(lhs) * ExpressionValue<E>(1.0 / rhs);
+}
+
+template <MatrixOperand L, MatrixOperand R>
+    requires (MatrixExpression<L> || MatrixExpression<R>)
+Matrix<ExpressionValue<L>> operator*(const L& lhs, const R& rhs){
+    using T = ExpressionValue<L>;
+    if constexpr(MatrixExpression<L>){
+        return Matrix<T>(lhs) * rhs;
+    }
+    else{
+        return lhs * Matrix<T>(rhs);
+    }
+}
+
+template <MatrixExpression E>
+bool operator==(const E& lhs, const Matrix<ExpressionValue<E>>& rhs){
+    return Matrix<ExpressionValue<E>>(lhs) == rhs;
+}
+
+template <MatrixExpression E>
+bool operator!=(const E& lhs, const Matrix<ExpressionValue<E>>& rhs){
+    return !(lhs == rhs);
+}
+
+template <MatrixExpression E>
+std::ostream& operator<<(std::ostream& output, const E& expr){
+    return output << Matrix<ExpressionValue<E>>(expr);
+}
+
+template <MatrixExpression E>
+ExpressionValue<E> Norma(const E& expr, size_t num_column){
+    ExpressionValue<E> res = 0;
+    for(size_t i = 0; i < expr.SizeColumn(); ++i){
+        const ExpressionValue<E> val = expr.At(i, num_column);
+        res += val * val;
+    }
+    return std::sqrt(res);
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+#include "matrix.h"
+#include "sparse_matrix.h"
+#include "text_reader.h"
+
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <charconv>
+#include <algorithm>
+#include <utility>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+// Matrix Market exchange format: "coordinate" files of 1-based (row, column, value) entries and
+// "array" files of values in column-major order, with real, integer or pattern fields and general,
+// symmetric or skew-symmetric storage. Both readers take either kind of file; the text goes
+// through TextReader blocks straight into the result. Coordinate entries may come in any order,
+// repeated entries are summed, a symmetric matrix is expanded to both triangles. The stream is
+// left right after the last entry.
+template <typename T>
+SparseMatrix<T> ReadMatrixMarketSparse(std::istream& input);
+template <typename T>
+Matrix<T> ReadMatrixMarketDense(std::istream& input);
+
+// "coordinate real general" with the stored entries of mat, in row order
+template <typename T>
+void WriteMatrixMarket(std::ostream& output, const SparseMatrix<T>& mat);
+// "array real general" with every element of mat, column by column
+template <typename T>
+void WriteMatrixMarket(std::ostream& output, const Matrix<T>& mat);
+
+namespace matrix_market_detail{
+
+inline constexpr size_t CHUNK_BYTES = size_t(1) << 20;
+
+enum class Symmetry{
+    GENERAL,
+    SYMMETRIC,
+    SKEW_SYMMETRIC
+};
+
+struct Header{
+    bool coordinate = true;
+    bool pattern = false;
+    Symmetry symmetry = Symmetry::GENERAL;
+    size_t rows = 0;
+    size_t columns = 0;
+    // Stored entries of a coordinate file
+    size_t entries = 0;
+};
+
+// Reads the banner, the comments and the size line
+inline Header ParceHeader(TextReader& reader);
+
+// A 1-based index of the file as a 0-based index below size
+inline size_t ParceIndex(double value, size_t size);
+
+// Calls func(row, column, value) for every stored entry of a coordinate file and its mirror
+template <typename T, typename Func>
+void ForEachEntry(TextReader& reader, const Header& header, Func func);
+
+template <typename T>
+SparseMatrix<T> ReadCoordinate(TextReader& reader, const Header& header);
+template <typename T>
+Matrix<T> ReadArray(TextReader& reader, const Header& header);
+
+// Text output gathered in a fixed size buffer and written to the stream when it fills up
+class ChunkWriter{
+public:
+    explicit ChunkWriter(std::ostream& output);
+
+    void Write(const std::string& text);
+    template <typename Number>
+    void Write(Number value, char separator);
+
+    void Flush();
+
+private:
+    std::ostream& output_;
+    std::vector<char> buffer_;
+    size_t size_ = 0;
+};
+
+} // namespace matrix_market_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace matrix_market_detail{
+
+inline Header ParceHeader(TextReader& reader){
+    std::string line;
+    if(!reader.ReadLine(line)){
+        throw std::invalid_argument("The Matrix Market stream is empty");
+    }
+    std::transform(line.begin(), line.end(), line.begin(), [](unsigned char c){return char(std::tolower(c));});
+    std::vector<std::string> tokens;
+    for(size_t pos = 0; pos < line.size(); ){
+        const size_t begin = line.find_first_not_of(" \t", pos);
+        if(begin == std::string::npos){
+            break;
+        }
+        const size_t end = std::min(line.find_first_of(" \t", begin), line.size());
+        tokens.push_back(line.substr(begin, end - begin));
+        pos = end;
+    }
+    if((tokens.size() != 5) || (tokens[0] != "%%matrixmarket") || (tokens[1] != "matrix")){
+        throw std::invalid_argument("The Matrix Market banner is incorrect");
+    }
+    Header res;
+    if((tokens[2] != "coordinate") && (tokens[2] != "array")){
+        throw std::invalid_argument("The Matrix Market format is not supported: " + tokens[2]);
+    }
+    res.coordinate = (tokens[2] == "coordinate");
+    if((tokens[3] != "real") && (tokens[3] != "integer") && (tokens[3] != "double") && (tokens[3] != "pattern")){
+        throw std::invalid_argument("The Matrix Market field is not supported: " + tokens[3]);
+    }
+    res.pattern = (tokens[3] == "pattern");
+    if(res.pattern && !res.coordinate){
+        throw std::invalid_argument("The Matrix Market array can not be a pattern");
+    }
+    // A real hermitian matrix is symmetric
+    if((tokens[4] == "symmetric") || (tokens[4] == "hermitian")){
+        res.symmetry = Symmetry::SYMMETRIC;
+    }
+    else if(tokens[4] == "skew-symmetric"){
+        res.symmetry = Symmetry::SKEW_SYMMETRIC;
+    }
+    else if(tokens[4] != "general"){
+        throw std::invalid_argument("The Matrix Market symmetry is not supported: " + tokens[4]);
+    }
+
+    do{
+        if(!reader.ReadLine(line)){
+            throw std::invalid_argument("The Matrix Market stream has no sizes");
+        }
+    } while(line.empty() || (line[0] == '%') || (line.find_first_not_of(" \t") == std::string::npos));
+    std::vector<size_t> sizes;
+    ParceNumbers(line.data(), line.data() + line.size(), sizes);
+    if(sizes.size() != (res.coordinate ? 3 : 2)){
+        throw std::invalid_argument("The Matrix Market sizes are incorrect");
+    }
+    res.rows = sizes[0];
+    res.columns = sizes[1];
+    res.entries = res.coordinate ? sizes[2] : 0;
+    if((res.symmetry != Symmetry::GENERAL) && (res.rows != res.columns)){
+        throw std::invalid_argument("The symmetric Matrix Market matrix is not square");
+    }
+    return res;
+}
+
+inline size_t ParceIndex(double value, size_t size){
+    if(!(value >= 1) || (value > double(size)) || (value != std::floor(value))){
+        throw std::invalid_argument("The Matrix Market index is incorrect");
+    }
+    return size_t(value) - 1;
+}
+
+template <typename T, typename Func>
+void ForEachEntry(TextReader& reader, const Header& header, Func func){
+    std::vector<double> numbers;
+    const size_t count = header.pattern ? 2 : 3;
+    for(size_t k = 0; k < header.entries; ){
+        if(!reader.ReadLine(numbers)){
+            throw std::invalid_argument("The Matrix Market entries are truncated");
+        }
+        if(numbers.empty()){
+            continue;
+        }
+        if(numbers.size() != count){
+            throw std::invalid_argument("The Matrix Market entry is incorrect");
+        }
+        const size_t i = ParceIndex(numbers[0], header.rows), j = ParceIndex(numbers[1], header.columns);
+        const T value = header.pattern ? T(1) : static_cast<T>(numbers[2]);
+        func(i, j, value);
+        if((header.symmetry == Symmetry::SYMMETRIC) && (i != j)){
+            func(j, i, value);
+        }
+        else if(header.symmetry == Symmetry::SKEW_SYMMETRIC){
+            if(i == j){
+                throw std::invalid_argument("The skew-symmetric Matrix Market matrix has a diagonal entry");
+            }
+            func(j, i, -value);
+        }
+        ++k;
+    }
+}
+
+template <typename T>
+SparseMatrix<T> ReadCoordinate(TextReader& reader, const Header& header){
+    std::vector<size_t> rows, columns;
+    std::vector<T> values;
+    const size_t capacity = (header.symmetry == Symmetry::GENERAL) ? header.entries : 2 * header.entries;
+    rows.reserve(capacity);
+    columns.reserve(capacity);
+    values.reserve(capacity);
+    ForEachEntry<T>(reader, header, [&](size_t i, size_t j, T value){
+        rows.push_back(i);
+        columns.push_back(j);
+        values.push_back(value);
+    });
+
+    // Counting sort by row, then every row by column with the repeated entries summed
+    std::vector<size_t> row_offsets(header.rows + 1, 0);
+    for(size_t i : rows){
+        ++row_offsets[i + 1];
+    }
+    for(size_t i = 0; i < header.rows; ++i){
+        row_offsets[i + 1] += row_offsets[i];
+    }
+    std::vector<size_t> sorted_columns(columns.size());
+    std::vector<T> sorted_values(values.size());
+    {
+        std::vector<size_t> next(row_offsets.begin(), row_offsets.end() - 1);
+        for(size_t k = 0; k < rows.size(); ++k){
+            const size_t pos = next[rows[k]]++;
+            sorted_columns[pos] = columns[k];
+            sorted_values[pos] = values[k];
+        }
+    }
+    sparse_detail::SortRows(row_offsets, sorted_columns, sorted_values);
+    return SparseMatrix<T>(header.rows, header.columns, std::move(row_offsets), std::move(sorted_columns),
+        std::move(sorted_values));
+}
+
+template <typename T>
+Matrix<T> ReadArray(TextReader& reader, const Header& header){
+    Matrix<T> res(header.rows, header.columns, T());
+    // The stored part of column j starts at row first(j): the whole column, the lower triangle
+    // with the diagonal, or the strict lower triangle
+    const size_t skip = (header.symmetry == Symmetry::SKEW_SYMMETRIC) ? 1 : 0;
+    const auto first = [&](size_t j){
+        return (header.symmetry == Symmetry::GENERAL) ? 0 : std::min(j + skip, header.rows);
+    };
+    size_t i = first(0), j = 0;
+    while((j < header.columns) && (i == header.rows)){
+        ++j;
+        i = first(j);
+    }
+    std::vector<double> numbers;
+    while(j < header.columns){
+        if(!reader.ReadLine(numbers)){
+            throw std::invalid_argument("The Matrix Market values are truncated");
+        }
+        for(double number : numbers){
+            if(j == header.columns){
+                throw std::invalid_argument("The Matrix Market array has too many values");
+            }
+            const T value = static_cast<T>(number);
+            res[i][j] = value;
+            if((header.symmetry == Symmetry::SYMMETRIC) && (i != j)){
+                res[j][i] = value;
+            }
+            else if(header.symmetry == Symmetry::SKEW_SYMMETRIC){
+                res[j][i] = -value;
+            }
+            ++i;
+            while((j < header.columns) && (i == header.rows)){
+                ++j;
+                i = (j < header.columns) ? first(j) : 0;
+            }
+        }
+    }
+    return res;
+}
+
+inline ChunkWriter::ChunkWriter(std::ostream& output)
+    : output_(output)
+    , buffer_(CHUNK_BYTES){}
+
+inline void ChunkWriter::Write(const std::string& text){
+    Flush();
+    output_.write(text.data(), std::streamsize(text.size()));
+}
+
+template <typename Number>
+void ChunkWriter::Write(Number value, char separator){
+    // Enough for the shortest round trip form of any double and a separator
+    constexpr size_t MAX_NUMBER = 64;
+    if(size_ + MAX_NUMBER > buffer_.size()){
+        Flush();
+    }
+    char* const begin = buffer_.data() + size_;
+    const auto [ptr, ec] = std::to_chars(begin, buffer_.data() + buffer_.size() - 1, value);
+    if(ec != std::errc()){
+        throw std::invalid_argument("The number can not be written");
+    }
+    *ptr = separator;
+    size_ += size_t(ptr - begin) + 1;
+}
+
+inline void ChunkWriter::Flush(){
+    output_.write(buffer_.data(), std::streamsize(size_));
+    size_ = 0;
+}
+
+} // namespace matrix_market_detail
+
+template <typename T>
+SparseMatrix<T> ReadMatrixMarketSparse(std::istream& input){
+    TextReader reader(input);
+    const matrix_market_detail::Header header = matrix_market_detail::ParceHeader(reader);
+    if(!header.coordinate){
+        Matrix<T> res = matrix_market_detail::ReadArray<T>(reader, header);
+        reader.Finish();
+        return SparseMatrix<T>(res);
+    }
+    SparseMatrix<T> res = matrix_market_detail::ReadCoordinate<T>(reader, header);
+    reader.Finish();
+    return res;
+}
+
+template <typename T>
+Matrix<T> ReadMatrixMarketDense(std::istream& input){
+    TextReader reader(input);
+    const matrix_market_detail::Header header = matrix_market_detail::ParceHeader(reader);
+    if(!header.coordinate){
+        Matrix<T> res = matrix_market_detail::ReadArray<T>(reader, header);
+        reader.Finish();
+        return res;
+    }
+    Matrix<T> res(header.rows, header.columns, T());
+    matrix_market_detail::ForEachEntry<T>(reader, header, [&](size_t i, size_t j, T value){
+        res[i][j] += value;
+    });
+    reader.Finish();
+    return res;
+}
+
+template <typename T>
+void WriteMatrixMarket(std::ostream& output, const SparseMatrix<T>& mat){
+    matrix_market_detail::ChunkWriter writer(output);
+    writer.Write("%%MatrixMarket matrix coordinate real general\n" + std::to_string(mat.SizeColumn()) + " "
+        + std::to_string(mat.SizeRow()) + " " + std::to_string(mat.NonZeros()) + "\n");
+    const auto& offsets = mat.RowOffsets();
+    const auto& columns = mat.Columns();
+    const auto& values = mat.Values();
+    for(size_t i = 0; i < mat.SizeColumn(); ++i){
+        for(size_t k = offsets[i]; k < offsets[i + 1]; ++k){
+            writer.Write(i + 1, ' ');
+            writer.Write(columns[k] + 1, ' ');
+            writer.Write(values[k], '\n');
+        }
+    }
+    writer.Flush();
+}
+
+template <typename T>
+void WriteMatrixMarket(std::ostream& output, const Matrix<T>& mat){
+    if(!mat.Correct() && !mat.Empty()){
+        throw std::invalid_argument("The matrix is incorrect for writing");
+    }
+    matrix_market_detail::ChunkWriter writer(output);
+    writer.Write("%%MatrixMarket matrix array real general\n" + std::to_string(mat.SizeColumn()) + " "
+        + std::to_string(mat.SizeRow()) + "\n");
+    for(size_t j = 0; j < mat.SizeRow(); ++j){
+        for(size_t i = 0; i < mat.SizeColumn(); ++i){
+            writer.Write(mat[i][j], '\n');
+        }
+    }
+    writer.Flush();
+}
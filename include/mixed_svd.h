@@ -0,0 +1,150 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "gemm.h"
+#include "symmetric_matrix.h"
+#include "orthonormalize.h"
+#include "golub_kahan_svd.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Mixed precision SVD: mat keeps its storage type (float, half the memory and bandwidth of
+// double) and is read in row slabs converted to double, so the Gram matrix, the deflated power
+// iteration and every inner product accumulate in double. Each of the refinement_steps is one
+// Rayleigh-Ritz step against mat in double (Y = mat * V, Q = orth(Y), SVD of Q^T * mat), which
+// brings vectors and values to double accuracy for the stored matrix.
+template <typename T>
+SVD<double> CalculateMixedSVD(const Matrix<T>& mat, const size_t num_vec, const double error_rate,
+    const size_t refinement_steps = 1);
+
+namespace mixed_detail{
+
+// Bytes of the double slab a stored row block is converted into
+inline constexpr size_t SLAB_BYTES = size_t(4) << 20;
+
+// Calls func(slab, begin, rows) for consecutive row blocks of mat converted to double, only the
+// first rows rows of slab are valid
+template <typename T, typename Func>
+void ForEachSlab(const Matrix<T>& mat, Func func);
+
+// mat^T * mat accumulated in double, every slab is added straight into the packed result
+template <typename T>
+SymmetricMatrix<double> GramColumns(const Matrix<T>& mat);
+
+// mat * rhs accumulated in double
+template <typename T>
+Matrix<double> MultiplyRight(const Matrix<T>& mat, const Matrix<double>& rhs);
+
+// lhs * mat accumulated in double
+template <typename T>
+Matrix<double> MultiplyLeft(const Matrix<double>& lhs, const Matrix<T>& mat);
+
+} // namespace mixed_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace mixed_detail{
+
+template <typename T, typename Func>
+void ForEachSlab(const Matrix<T>& mat, Func func){
+    const size_t m = mat.SizeColumn(), n = mat.SizeRow();
+    const size_t slab_rows = std::min(m, std::max<size_t>(64, SLAB_BYTES / (n * sizeof(double))));
+    Matrix<double> slab(slab_rows, n, 0.0);
+    for(size_t begin = 0; begin < m; begin += slab_rows){
+        const size_t rows = std::min(slab_rows, m - begin);
+        for(size_t i = 0; i < rows; ++i){
+            std::copy(mat[begin + i].begin(), mat[begin + i].end(), slab[i].begin());
+        }
+        func(slab, begin, rows);
+    }
+}
+
+template <typename T>
+SymmetricMatrix<double> GramColumns(const Matrix<T>& mat){
+    const size_t n = mat.SizeRow();
+    SymmetricMatrix<double> res(n);
+    ForEachSlab(mat, [&res](const Matrix<double>& slab, size_t, size_t rows){
+        symmetric_detail::AddGram<double>(rows, {slab.Data(), 1, slab.Stride()}, res);
+    });
+    return res;
+}
+
+template <typename T>
+Matrix<double> MultiplyRight(const Matrix<T>& mat, const Matrix<double>& rhs){
+    const size_t n = mat.SizeRow(), k = rhs.SizeRow();
+    Matrix<double> res(mat.SizeColumn(), k, 0.0);
+    ForEachSlab(mat, [&](const Matrix<double>& slab, size_t begin, size_t rows){
+        Gemm<double>(rows, k, n, {slab.Data(), slab.Stride(), 1}, {rhs.Data(), rhs.Stride(), 1},
+            res[begin].data(), res.Stride());
+    });
+    return res;
+}
+
+template <typename T>
+Matrix<double> MultiplyLeft(const Matrix<double>& lhs, const Matrix<T>& mat){
+    const size_t n = mat.SizeRow(), k = lhs.SizeColumn();
+    Matrix<double> res(k, n, 0.0);
+    ForEachSlab(mat, [&](const Matrix<double>& slab, size_t begin, size_t rows){
+        Gemm<double>(k, n, rows, {lhs.Data() + begin, lhs.Stride(), 1}, {slab.Data(), slab.Stride(), 1},
+            res.Data(), res.Stride());
+    });
+    return res;
+}
+
+} // namespace mixed_detail
+
+template <typename T>
+SVD<double> CalculateMixedSVD(const Matrix<T>& mat, const size_t num_vec, const double error_rate,
+    const size_t refinement_steps){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    const size_t n = mat.SizeRow();
+    if((num_vec == 0) || (num_vec > std::min(n, mat.SizeColumn()))){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+
+    // Deflated power iteration on the double Gram matrix, its vectors are the columns of right
+    const SymmetricMatrix<double> gram = mixed_detail::GramColumns(mat);
+    DeflatedMatrix<double, SymmetricMatrix<double>> deflated(gram, num_vec);
+    PowerIterationWorkspace<double> workspace;
+    SVD<double> res;
+    res.eigenvalues = Matrix<double>(num_vec, num_vec, 0.0);
+    res.right_singular_vectors = Matrix<double>(n, num_vec, 0.0);
+    for(size_t i = 0; i < num_vec; ++i){
+        const double value = CalculateMaxEigenval(deflated, error_rate, workspace);
+        deflated.Deflate(value, workspace.u);
+        res.eigenvalues[i][i] = std::sqrt(std::max(value, 0.0));
+        for(size_t j = 0; j < n; ++j){
+            res.right_singular_vectors[j][i] = workspace.u[j];
+        }
+    }
+
+    if(refinement_steps == 0){
+        res.left_singular_vectors = mixed_detail::MultiplyRight(mat, res.right_singular_vectors);
+        for(size_t i = 0; i < res.left_singular_vectors.SizeColumn(); ++i){
+            for(size_t j = 0; j < num_vec; ++j){
+                const double sigma = res.eigenvalues[j][j];
+                res.left_singular_vectors[i][j] = (sigma > 0.0) ? res.left_singular_vectors[i][j] / sigma : 0.0;
+            }
+        }
+        return res;
+    }
+    for(size_t step = 0; step < refinement_steps; ++step){
+        // The rows of basis span mat * V, the small k x n projection is decomposed exactly
+        Matrix<double> basis = Transp(mixed_detail::MultiplyRight(mat, res.right_singular_vectors));
+        OrthonormalizeRows(basis);
+        const Matrix<double> projection = mixed_detail::MultiplyLeft(basis, mat);
+        SVD<double> small = CalculateGolubKahanSVD(projection, num_vec, std::numeric_limits<double>::epsilon());
+        res.eigenvalues = std::move(small.eigenvalues);
+        res.right_singular_vectors = std::move(small.right_singular_vectors);
+        res.left_singular_vectors = Transposed(basis) * small.left_singular_vectors;
+    }
+    return res;
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "matrix.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ios>
+#include <limits>
+#include <ostream>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <type_traits>
+
+// NumPy .npy arrays of float32 or float64 in either byte order, one or two dimensional, in C or
+// Fortran order. The data is converted into the matrix through a fixed size chunk, so there is
+// no full size intermediate buffer. The shape is checked against the bytes left in a seekable
+// stream before the matrix is allocated. A one dimensional array of n values is a 1 x n matrix.
+template <typename T>
+Matrix<T> ReadNpy(std::istream& input);
+
+// Writes mat as little endian float32 or float64, as T, in C or Fortran order
+template <typename T>
+void WriteNpy(std::ostream& output, const Matrix<T>& mat, const bool fortran_order = false);
+
+namespace npy_detail{
+
+inline constexpr char MAGIC[6] = {'\x93', 'N', 'U', 'M', 'P', 'Y'};
+inline constexpr size_t CHUNK_BYTES = size_t(1) << 20;
+
+struct Header{
+    // 4 or 8
+    size_t value_bytes = 0;
+    bool swap_bytes = false;
+    bool fortran_order = false;
+    size_t rows = 0;
+    size_t columns = 0;
+};
+
+// The value of key in the header dictionary, up to the next top level ',' or '}'
+inline std::string DictValue(const std::string& dict, const std::string& key);
+
+inline Header ParceHeader(std::istream& input);
+
+// Converts count stored values of chunk into dst, swapping their bytes first if needed
+template <typename T>
+void ConvertValues(const char* chunk, size_t count, const Header& header, T* dst, size_t dst_stride);
+
+// Throws if the shape does not fit in memory for values of value_size bytes or, when the stream
+// can seek, if fewer bytes are left than the shape needs
+inline void CheckDataSize(std::istream& input, const Header& header, size_t value_size);
+
+} // namespace npy_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace npy_detail{
+
+inline std::string DictValue(const std::string& dict, const std::string& key){
+    const size_t pos = dict.find("'" + key + "'");
+    if(pos == std::string::npos){
+        throw std::invalid_argument("The npy header has no " + key);
+    }
+    size_t begin = dict.find(':', pos);
+    if(begin == std::string::npos){
+        throw std::invalid_argument("The npy header is incorrect");
+    }
+    ++begin;
+    size_t end = begin;
+    for(int depth = 0; end < dict.size(); ++end){
+        const char c = dict[end];
+        if(c == '('){
+            ++depth;
+        }
+        else if(c == ')'){
+            --depth;
+        }
+        else if(((c == ',') || (c == '}')) && (depth == 0)){
+            break;
+        }
+    }
+    std::string res = dict.substr(begin, end - begin);
+    res.erase(0, res.find_first_not_of(" "));
+    res.erase(res.find_last_not_of(" ") + 1);
+    return res;
+}
+
+inline Header ParceHeader(std::istream& input){
+    char magic[8];
+    if(!input.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC))){
+        throw std::invalid_argument("The stream is not an npy array");
+    }
+    const uint8_t major = uint8_t(magic[6]);
+    size_t dict_bytes = 0;
+    unsigned char size_bytes[4] = {};
+    if(major == 1){
+        input.read(reinterpret_cast<char*>(size_bytes), 2);
+        dict_bytes = size_t(size_bytes[0]) | (size_t(size_bytes[1]) << 8);
+    }
+    else if((major == 2) || (major == 3)){
+        input.read(reinterpret_cast<char*>(size_bytes), 4);
+        dict_bytes = size_t(size_bytes[0]) | (size_t(size_bytes[1]) << 8) | (size_t(size_bytes[2]) << 16)
+            | (size_t(size_bytes[3]) << 24);
+    }
+    else{
+        throw std::invalid_argument("The npy version is not supported");
+    }
+    std::string dict(dict_bytes, ' ');
+    if(!input.read(dict.data(), std::streamsize(dict_bytes))){
+        throw std::invalid_argument("The npy header is truncated");
+    }
+
+    Header res;
+    const std::string descr = DictValue(dict, "descr");
+    // '<f8', '>f4', '=f8' or '|f4' between quotes
+    if((descr.size() != 5) || (descr[2] != 'f') || ((descr[3] != '4') && (descr[3] != '8'))){
+        throw std::invalid_argument("The npy type is not supported: " + descr);
+    }
+    res.value_bytes = size_t(descr[3] - '0');
+    const bool big = (descr[1] == '>');
+    res.swap_bytes = (big != (std::endian::native == std::endian::big)) && (descr[1] != '=') && (descr[1] != '|');
+
+    const std::string order = DictValue(dict, "fortran_order");
+    if((order != "True") && (order != "False")){
+        throw std::invalid_argument("The npy order is incorrect");
+    }
+    res.fortran_order = (order == "True");
+
+    const std::string shape = DictValue(dict, "shape");
+    std::vector<size_t> dims;
+    for(size_t pos = 0; pos < shape.size(); ){
+        if((shape[pos] < '0') || (shape[pos] > '9')){
+            ++pos;
+            continue;
+        }
+        size_t end = pos;
+        size_t dim = 0;
+        while((end < shape.size()) && (shape[end] >= '0') && (shape[end] <= '9')){
+            if(dim > (std::numeric_limits<size_t>::max() - 9) / 10){
+                throw std::invalid_argument("The npy shape is too large");
+            }
+            dim = dim * 10 + size_t(shape[end++] - '0');
+        }
+        dims.push_back(dim);
+        pos = end;
+    }
+    if(dims.size() == 1){
+        res.rows = 1;
+        res.columns = dims[0];
+    }
+    else if(dims.size() == 2){
+        res.rows = dims[0];
+        res.columns = dims[1];
+    }
+    else{
+        throw std::invalid_argument("Only one and two dimensional npy arrays are supported");
+    }
+    return res;
+}
+
+template <typename T>
+void ConvertValues(const char* chunk, size_t count, const Header& header, T* dst, size_t dst_stride){
+    for(size_t i = 0; i < count; ++i){
+        char bytes[8];
+        std::memcpy(bytes, chunk + i * header.value_bytes, header.value_bytes);
+        if(header.swap_bytes){
+            std::reverse(bytes, bytes + header.value_bytes);
+        }
+        if(header.value_bytes == 4){
+            float value;
+            std::memcpy(&value, bytes, sizeof(value));
+            dst[i * dst_stride] = static_cast<T>(value);
+        }
+        else{
+            double value;
+            std::memcpy(&value, bytes, sizeof(value));
+            dst[i * dst_stride] = static_cast<T>(value);
+        }
+    }
+}
+
+inline void CheckDataSize(std::istream& input, const Header& header, size_t value_size){
+    const size_t limit = std::numeric_limits<size_t>::max() / std::max(header.value_bytes, value_size);
+    if((header.columns != 0) && (header.rows > limit / header.columns)){
+        throw std::invalid_argument("The npy shape is too large");
+    }
+    const std::streampos pos = input.tellg();
+    if(pos == std::streampos(-1)){
+        return;
+    }
+    input.seekg(0, std::ios::end);
+    const std::streampos end = input.tellg();
+    input.clear();
+    input.seekg(pos);
+    if((end != std::streampos(-1)) && (size_t(end - pos) < header.rows * header.columns * header.value_bytes)){
+        throw std::invalid_argument("The npy data is truncated");
+    }
+}
+
+} // namespace npy_detail
+
+template <typename T>
+Matrix<T> ReadNpy(std::istream& input){
+    const npy_detail::Header header = npy_detail::ParceHeader(input);
+    npy_detail::CheckDataSize(input, header, sizeof(T));
+    Matrix<T> res(header.rows, header.columns, T());
+    // Values in storage order: along the rows in C order, down the columns in Fortran order
+    const size_t line = header.fortran_order ? header.rows : header.columns;
+    const size_t lines = header.fortran_order ? header.columns : header.rows;
+    const size_t total = line * lines;
+    const size_t chunk_values = std::max<size_t>(npy_detail::CHUNK_BYTES / header.value_bytes, 1);
+    std::vector<char> chunk(chunk_values * header.value_bytes);
+    for(size_t done = 0; done < total; ){
+        const size_t count = std::min(chunk_values, total - done);
+        if(!input.read(chunk.data(), std::streamsize(count * header.value_bytes))){
+            throw std::invalid_argument("The npy data is truncated");
+        }
+        // The chunk may start and end in the middle of a row or column
+        for(size_t pos = 0; pos < count; ){
+            const size_t index = done + pos, outer = index / line, inner = index % line;
+            const size_t run = std::min(line - inner, count - pos);
+            const char* src = chunk.data() + pos * header.value_bytes;
+            if(header.fortran_order){
+                npy_detail::ConvertValues(src, run, header, &res[inner][outer], res.Stride());
+            }
+            else{
+                npy_detail::ConvertValues(src, run, header, &res[outer][inner], 1);
+            }
+            pos += run;
+        }
+        done += count;
+    }
+    return res;
+}
+
+template <typename T>
+void WriteNpy(std::ostream& output, const Matrix<T>& mat, const bool fortran_order){
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "Only float and double are written");
+    if(!mat.Correct() && !mat.Empty()){
+        throw std::invalid_argument("The matrix is incorrect for writing");
+    }
+    const size_t rows = mat.SizeColumn(), columns = mat.SizeRow();
+    const char endian = (std::endian::native == std::endian::little) ? '<' : '>';
+    std::string dict = std::string("{'descr': '") + endian + (std::is_same_v<T, float> ? "f4" : "f8")
+        + "', 'fortran_order': " + (fortran_order ? "True" : "False")
+        + ", 'shape': (" + std::to_string(rows) + ", " + std::to_string(columns) + "), }";
+    // Magic, version and length take 10 bytes, the data starts at a multiple of 64
+    dict.append(63 - (10 + dict.size()) % 64, ' ');
+    dict.push_back('\n');
+    if(dict.size() > 0xffff){
+        throw std::invalid_argument("The npy header is too long");
+    }
+    output.write(npy_detail::MAGIC, sizeof(npy_detail::MAGIC));
+    const char version_and_size[4] = {1, 0, char(dict.size() & 0xff), char(dict.size() >> 8)};
+    output.write(version_and_size, sizeof(version_and_size));
+    output.write(dict.data(), std::streamsize(dict.size()));
+    if(!fortran_order){
+        for(size_t i = 0; i < rows; ++i){
+            output.write(reinterpret_cast<const char*>(mat[i].data()), std::streamsize(columns * sizeof(T)));
+        }
+        return;
+    }
+    // Columns are gathered into a chunk before writing
+    const size_t chunk_values = std::max<size_t>(npy_detail::CHUNK_BYTES / sizeof(T), rows);
+    std::vector<T> chunk;
+    chunk.reserve(chunk_values);
+    for(size_t j = 0; j < columns; ++j){
+        for(size_t i = 0; i < rows; ++i){
+            chunk.push_back(mat[i][j]);
+        }
+        if((chunk.size() + rows > chunk_values) || (j + 1 == columns)){
+            output.write(reinterpret_cast<const char*>(chunk.data()), std::streamsize(chunk.size() * sizeof(T)));
+            chunk.clear();
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "matrix.h"
+#include "symmetric_matrix.h"
+#include "simd.h"
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Replaces the rows of mat by an orthonormal basis of their span, in place, with two rounds of
+// Cholesky QR: each round is one Gram matrix and one product, so the tall data is streamed a
+// few times instead of once per pair of rows as in Gram-Schmidt. Rows that are numerically
+// dependent on the ones before them become zero. Returns the number of nonzero rows left.
+template <typename T>
+size_t OrthonormalizeRows(Matrix<T>& mat);
+
+namespace orthonormalize_detail{
+
+// Inverse of the Cholesky factor of the Gram matrix of the rows, with zero rows for pivots that
+// fell to rounding level
+template <typename T>
+Matrix<T> InverseCholesky(const SymmetricMatrix<T>& gram, size_t& rank);
+
+} // namespace orthonormalize_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace orthonormalize_detail{
+
+template <typename T>
+Matrix<T> InverseCholesky(const SymmetricMatrix<T>& gram, size_t& rank){
+    const size_t n = gram.SizeRow();
+    const T tol = T(4) * T(n) * std::numeric_limits<T>::epsilon();
+    SymmetricMatrix<T> l(n);
+    rank = 0;
+    for(size_t i = 0; i < n; ++i){
+        for(size_t j = 0; j < i; ++j){
+            const T pivot = l(j, j);
+            l(i, j) = (pivot == T(0)) ? T(0) : (gram(i, j) - SimdDot(l[i].data(), l[j].data(), j)) / pivot;
+        }
+        const T rest = gram(i, i) - SimdDot(l[i].data(), l[i].data(), i);
+        if(rest > tol * gram(i, i)){
+            l(i, i) = std::sqrt(rest);
+            ++rank;
+        }
+        else{
+            std::fill(l[i].begin(), l[i].end(), T(0));
+        }
+    }
+    // Forward substitution row by row: inv[i] = (e_i - sum l(i, j) * inv[j]) / l(i, i)
+    Matrix<T> inv(n, n, T());
+    for(size_t i = 0; i < n; ++i){
+        if(l(i, i) == T(0)){
+            continue;
+        }
+        inv[i][i] = T(1);
+        for(size_t j = 0; j < i; ++j){
+            if(l(i, j) != T(0)){
+                SimdAxpy(inv[i].data(), -l(i, j), inv[j].data(), j + 1);
+            }
+        }
+        SimdScale(inv[i].data(), T(1) / l(i, i), i + 1);
+    }
+    return inv;
+}
+
+} // namespace orthonormalize_detail
+
+template <typename T>
+size_t OrthonormalizeRows(Matrix<T>& mat){
+    size_t rank = 0;
+    for(size_t round = 0; round < 2; ++round){
+        Matrix<T> inv = orthonormalize_detail::InverseCholesky(GramRows(mat), rank);
+        mat = inv * mat;
+    }
+    return rank;
+}
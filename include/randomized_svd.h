@@ -0,0 +1,78 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "golub_kahan_svd.h"
+#include "orthonormalize.h"
+
+#include <random>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Randomized truncated SVD (Halko, Martinsson, Tropp). A Gaussian sketch of rank + oversampling
+// columns captures the range of mat, power_passes rounds of multiplying by mat^T and mat sharpen
+// it for slowly decaying spectra, and the small projection of mat onto that range is decomposed
+// exactly. The work outside the small SVD is a handful of large products over mat.
+// The result only depends on the arguments, seed included.
+template <typename T>
+SVD<T> CalculateRandomizedSVD(const Matrix<T>& mat, const size_t rank, const size_t oversampling = 10,
+    const size_t power_passes = 2, const uint64_t seed = 42);
+
+namespace randomized_detail{
+
+// rows x size_row matrix of independent standard normal values
+template <typename T>
+Matrix<T> GaussianMatrix(size_t rows, size_t size_row, uint64_t seed);
+
+} // namespace randomized_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace randomized_detail{
+
+template <typename T>
+Matrix<T> GaussianMatrix(size_t rows, size_t size_row, uint64_t seed){
+    std::mt19937_64 generator(seed);
+    std::normal_distribution<double> normal;
+    Matrix<T> res(rows, size_row, T());
+    for(size_t i = 0; i < rows; ++i){
+        for(T& val : res[i]){
+            val = static_cast<T>(normal(generator));
+        }
+    }
+    return res;
+}
+
+} // namespace randomized_detail
+
+template <typename T>
+SVD<T> CalculateRandomizedSVD(const Matrix<T>& mat, const size_t rank, const size_t oversampling,
+    const size_t power_passes, const uint64_t seed){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    const size_t count = std::min(mat.SizeColumn(), mat.SizeRow());
+    if((rank == 0) || (rank > count)){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    const size_t width = std::min(rank + oversampling, count);
+    // The sketches are kept transposed, basis holds the orthonormal basis of the range as rows,
+    // so every product below is a GEMM against mat or its transposed view
+    Matrix<T> basis = randomized_detail::GaussianMatrix<T>(width, mat.SizeRow(), seed) * Transposed(mat);
+    OrthonormalizeRows(basis);
+    for(size_t pass = 0; pass < power_passes; ++pass){
+        Matrix<T> co_range = basis * mat;
+        OrthonormalizeRows(co_range);
+        basis = co_range * Transposed(mat);
+        OrthonormalizeRows(basis);
+    }
+    // mat ~ basis^T * projection, and the projection is only width x columns
+    const Matrix<T> projection = basis * mat;
+    SVD<T> res = CalculateGolubKahanSVD(projection, rank, std::numeric_limits<T>::epsilon());
+    res.left_singular_vectors = Transposed(basis) * res.left_singular_vectors;
+    return res;
+}
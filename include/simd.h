@@ -0,0 +1,366 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SVD_SIMD_X86 1
+#endif
+
+enum class SimdLevel{
+    SCALAR = 0,
+    SSE = 16,
+    AVX2 = 32,
+    AVX512 = 64
+};
+
+inline SimdLevel DetectedSimdLevel();
+inline SimdLevel ActiveSimdLevel();
+inline void SetSimdLevel(SimdLevel level);
+inline const char* SimdLevelName(SimdLevel level);
+
+// dst[i] += src[i]
+template <typename T>
+void SimdAdd(T* dst, const T* src, size_t size);
+// dst[i] -= src[i]
+template <typename T>
+void SimdSub(T* dst, const T* src, size_t size);
+// dst[i] += val
+template <typename T>
+void SimdAddScalar(T* dst, const T& val, size_t size);
+// dst[i] *= val
+template <typename T>
+void SimdScale(T* dst, const T& val, size_t size);
+// dst[i] *= src[i]
+template <typename T>
+void SimdMul(T* dst, const T* src, size_t size);
+// dst[i] += src[i] * src[i]
+template <typename T>
+void SimdAddSquares(T* dst, const T* src, size_t size);
+// dst[i] += val * src[i]
+template <typename T>
+void SimdAxpy(T* dst, const T& val, const T* src, size_t size);
+// Plane rotation: (x[i], y[i]) = (c * x[i] - s * y[i], s * x[i] + c * y[i])
+template <typename T>
+void SimdRotate(T* x, T* y, const T& c, const T& s, size_t size);
+
+template <typename T>
+T SimdDot(const T* lhs, const T* rhs, size_t size);
+template <typename T>
+T SimdSumSquares(const T* src, size_t size);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace simd_detail{
+
+inline SimdLevel Detect(){
+#ifdef SVD_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")){
+        return SimdLevel::AVX512;
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+inline std::atomic<SimdLevel>& Active(){
+    static std::atomic<SimdLevel> level = DetectedSimdLevel();
+    return level;
+}
+
+template <typename T>
+inline constexpr bool VECTORIZABLE = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+template <typename T, size_t Bytes>
+struct Vector{
+    using Type [[gnu::vector_size(Bytes)]] = T;
+    static constexpr size_t LANES = Bytes / sizeof(T);
+
+    [[gnu::always_inline]] static void Load(Type& dst, const T* src){
+        __builtin_memcpy(&dst, src, sizeof(Type));
+    }
+
+    [[gnu::always_inline]] static void Store(T* dst, const Type& val){
+        __builtin_memcpy(dst, &val, sizeof(Type));
+    }
+
+    [[gnu::always_inline]] static T Sum(const Type& val){
+        T res = 0;
+        for(size_t i = 0; i < LANES; ++i){
+            res += val[i];
+        }
+        return res;
+    }
+};
+
+// Every operation is written once against a vector width; Bytes == 0 selects the plain loop.
+// Elementwise operations share one body parameterized by the per-element functor.
+template <typename Func>
+struct Elementwise{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(T* dst, const T* src, size_t size){
+        size_t i = 0;
+        if constexpr(Bytes != 0){
+            using V = Vector<T, Bytes>;
+            typename V::Type dst_vec, src_vec;
+            for(; i + V::LANES <= size; i += V::LANES){
+                V::Load(dst_vec, dst + i);
+                V::Load(src_vec, src + i);
+                Func::Apply(dst_vec, src_vec);
+                V::Store(dst + i, dst_vec);
+            }
+        }
+        for(; i < size; ++i){
+            Func::Apply(dst[i], src[i]);
+        }
+    }
+};
+
+template <typename Func>
+struct ElementwiseScalar{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(T* dst, T val, size_t size){
+        size_t i = 0;
+        if constexpr(Bytes != 0){
+            using V = Vector<T, Bytes>;
+            typename V::Type dst_vec, val_vec = typename V::Type{} + val;
+            for(; i + V::LANES <= size; i += V::LANES){
+                V::Load(dst_vec, dst + i);
+                Func::Apply(dst_vec, val_vec);
+                V::Store(dst + i, dst_vec);
+            }
+        }
+        for(; i < size; ++i){
+            Func::Apply(dst[i], val);
+        }
+    }
+};
+
+struct Axpy{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(T* dst, T val, const T* src, size_t size){
+        size_t i = 0;
+        if constexpr(Bytes != 0){
+            using V = Vector<T, Bytes>;
+            typename V::Type dst_vec, src_vec, val_vec = typename V::Type{} + val;
+            for(; i + V::LANES <= size; i += V::LANES){
+                V::Load(dst_vec, dst + i);
+                V::Load(src_vec, src + i);
+                dst_vec += val_vec * src_vec;
+                V::Store(dst + i, dst_vec);
+            }
+        }
+        for(; i < size; ++i){
+            dst[i] += val * src[i];
+        }
+    }
+};
+
+struct Rotate{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(T* x, T* y, T c, T s, size_t size){
+        size_t i = 0;
+        if constexpr(Bytes != 0){
+            using V = Vector<T, Bytes>;
+            typename V::Type x_vec, y_vec, new_x, c_vec = typename V::Type{} + c, s_vec = typename V::Type{} + s;
+            for(; i + V::LANES <= size; i += V::LANES){
+                V::Load(x_vec, x + i);
+                V::Load(y_vec, y + i);
+                new_x = c_vec * x_vec - s_vec * y_vec;
+                y_vec = s_vec * x_vec + c_vec * y_vec;
+                V::Store(x + i, new_x);
+                V::Store(y + i, y_vec);
+            }
+        }
+        for(; i < size; ++i){
+            const T new_x = c * x[i] - s * y[i];
+            y[i] = s * x[i] + c * y[i];
+            x[i] = new_x;
+        }
+    }
+};
+
+struct AddFunc{
+    template <typename U>
+    [[gnu::always_inline]] static void Apply(U& lhs, const U& rhs){
+        lhs += rhs;
+    }
+};
+
+struct SubFunc{
+    template <typename U>
+    [[gnu::always_inline]] static void Apply(U& lhs, const U& rhs){
+        lhs -= rhs;
+    }
+};
+
+struct MulFunc{
+    template <typename U>
+    [[gnu::always_inline]] static void Apply(U& lhs, const U& rhs){
+        lhs *= rhs;
+    }
+};
+
+struct AddSquareFunc{
+    template <typename U>
+    [[gnu::always_inline]] static void Apply(U& lhs, const U& rhs){
+        lhs += rhs * rhs;
+    }
+};
+
+// Reductions keep four independent accumulators to hide the add latency.
+struct Dot{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static T Run(const T* lhs, const T* rhs, size_t size){
+        T res = 0;
+        size_t i = 0;
+        if constexpr(Bytes != 0){
+            using V = Vector<T, Bytes>;
+            typename V::Type acc[4] = {}, lhs_vec, rhs_vec;
+            for(; i + 4 * V::LANES <= size; i += 4 * V::LANES){
+                #pragma GCC unroll 4
+                for(size_t k = 0; k < 4; ++k){
+                    V::Load(lhs_vec, lhs + i + k * V::LANES);
+                    V::Load(rhs_vec, rhs + i + k * V::LANES);
+                    acc[k] += lhs_vec * rhs_vec;
+                }
+            }
+            for(; i + V::LANES <= size; i += V::LANES){
+                V::Load(lhs_vec, lhs + i);
+                V::Load(rhs_vec, rhs + i);
+                acc[0] += lhs_vec * rhs_vec;
+            }
+            acc[0] += acc[1];
+            acc[2] += acc[3];
+            acc[0] += acc[2];
+            res = V::Sum(acc[0]);
+        }
+        for(; i < size; ++i){
+            res += lhs[i] * rhs[i];
+        }
+        return res;
+    }
+};
+
+template <typename Op, typename... Args>
+[[gnu::always_inline]] inline auto RunSse(Args... args){
+    return Op::template Run<16>(args...);
+}
+
+#ifdef SVD_SIMD_X86
+template <typename Op, typename... Args>
+[[gnu::target("avx2,fma")]] auto RunAvx2(Args... args){
+    return Op::template Run<32>(args...);
+}
+
+template <typename Op, typename... Args>
+[[gnu::target("avx512f,avx512vl,avx2,fma")]] auto RunAvx512(Args... args){
+    return Op::template Run<64>(args...);
+}
+#endif
+
+template <typename T, typename Op, typename... Args>
+auto Dispatch(Args... args){
+    if constexpr(VECTORIZABLE<T>){
+        switch(ActiveSimdLevel()){
+#ifdef SVD_SIMD_X86
+        case SimdLevel::AVX512:
+            return RunAvx512<Op>(args...);
+        case SimdLevel::AVX2:
+            return RunAvx2<Op>(args...);
+#endif
+        case SimdLevel::SSE:
+            return RunSse<Op>(args...);
+        default:
+            break;
+        }
+    }
+    return Op::template Run<0>(args...);
+}
+
+} // namespace simd_detail
+
+inline SimdLevel DetectedSimdLevel(){
+    static const SimdLevel level = simd_detail::Detect();
+    return level;
+}
+
+inline SimdLevel ActiveSimdLevel(){
+    return simd_detail::Active().load(std::memory_order_relaxed);
+}
+
+inline void SetSimdLevel(SimdLevel level){
+    simd_detail::Active().store(std::min(level, DetectedSimdLevel()), std::memory_order_relaxed);
+}
+
+inline const char* SimdLevelName(SimdLevel level){
+    switch(level){
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSE:
+        return "SSE";
+    default:
+        return "scalar";
+    }
+}
+
+template <typename T>
+void SimdAdd(T* dst, const T* src, size_t size){
+    simd_detail::Dispatch<T, simd_detail::Elementwise<simd_detail::AddFunc>>(dst, src, size);
+}
+
+template <typename T>
+void SimdSub(T* dst, const T* src, size_t size){
+    simd_detail::Dispatch<T, simd_detail::Elementwise<simd_detail::SubFunc>>(dst, src, size);
+}
+
+template <typename T>
+void SimdAddScalar(T* dst, const T& val, size_t size){
+    simd_detail::Dispatch<T, simd_detail::ElementwiseScalar<simd_detail::AddFunc>>(dst, val, size);
+}
+
+template <typename T>
+void SimdScale(T* dst, const T& val, size_t size){
+    simd_detail::Dispatch<T, simd_detail::ElementwiseScalar<simd_detail::MulFunc>>(dst, val, size);
+}
+
+template <typename T>
+void SimdMul(T* dst, const T* src, size_t size){
+    simd_detail::Dispatch<T, simd_detail::Elementwise<simd_detail::MulFunc>>(dst, src, size);
+}
+
+template <typename T>
+void SimdAddSquares(T* dst, const T* src, size_t size){
+    simd_detail::Dispatch<T, simd_detail::Elementwise<simd_detail::AddSquareFunc>>(dst, src, size);
+}
+
+template <typename T>
+void SimdAxpy(T* dst, const T& val, const T* src, size_t size){
+    simd_detail::Dispatch<T, simd_detail::Axpy>(dst, val, src, size);
+}
+
+template <typename T>
+void SimdRotate(T* x, T* y, const T& c, const T& s, size_t size){
+    simd_detail::Dispatch<T, simd_detail::Rotate>(x, y, c, s, size);
+}
+
+template <typename T>
+T SimdDot(const T* lhs, const T* rhs, size_t size){
+    return simd_detail::Dispatch<T, simd_detail::Dot>(lhs, rhs, size);
+}
+
+template <typename T>
+T SimdSumSquares(const T* src, size_t size){
+    return SimdDot(src, src, size);
+}
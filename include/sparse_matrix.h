@@ -0,0 +1,385 @@
+#pragma once
+
+#include "matrix.h"
+#include "dense_vector.h"
+#include "thread_pool.h"
+#include "text_reader.h"
+
+#include <vector>
+#include <istream>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+// Matrix in compressed sparse row (CSR) form: the nonzeros of row i are values[j] in the
+// columns columns[j] for j in [row_offsets[i], row_offsets[i + 1]). Memory is proportional to
+// the number of nonzeros, the columns of a row are kept sorted.
+template <typename T>
+class SparseMatrix final{
+public:
+    using value_type = T;
+
+    // size_column x size_row zero matrix
+    explicit SparseMatrix(const size_t size_column = 0, const size_t size_row = 0);
+    SparseMatrix(const size_t size_column, const size_t size_row, std::vector<size_t> row_offsets,
+        std::vector<size_t> columns, std::vector<T> values);
+    // Keeps the nonzero elements of mat
+    explicit SparseMatrix(const Matrix<T>& mat);
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+    size_t NonZeros() const noexcept;
+
+    const std::vector<size_t>& RowOffsets() const noexcept;
+    const std::vector<size_t>& Columns() const noexcept;
+    const std::vector<T>& Values() const noexcept;
+
+    // y = *this * x for contiguous x of SizeRow() and y of SizeColumn() elements
+    void MultiplyVector(const T* x, T* y) const;
+    // y = *this^T * x for contiguous x of SizeColumn() and y of SizeRow() elements
+    void MultiplyTransposedVector(const T* x, T* y) const;
+
+    Matrix<T> ToDense() const;
+
+    bool operator==(const SparseMatrix& rhs) const;
+    bool operator!=(const SparseMatrix& rhs) const;
+
+private:
+    size_t size_column_;
+    size_t size_row_;
+    std::vector<size_t> row_offsets_;
+    std::vector<size_t> columns_;
+    std::vector<T> values_;
+};
+
+namespace sparse_detail{
+
+// Below this many nonzeros a product runs on the calling thread
+inline constexpr size_t PARALLEL_NON_ZEROS = size_t(1) << 15;
+
+// Calls func(begin, end) for row ranges covering rows rows, in parallel when there are many nonzeros
+template <typename Func>
+void ForEachRowRange(size_t rows, size_t non_zeros, Func func);
+
+// y = A * x and y = A^T * x for rows rows of CSR arrays, shared with views of mapped arrays
+template <typename T>
+void MultiplyVector(size_t rows, const size_t* offsets, const size_t* columns, const T* values, const T* x, T* y);
+template <typename T>
+void MultiplyTransposedVector(size_t rows, size_t size_row, const size_t* offsets, const size_t* columns,
+    const T* values, const T* x, T* y);
+
+// Sorts every row of CSR arrays by column and merges repeated columns, compacting the arrays in
+// place: their values are summed, or the last one is kept. The offsets must be nondecreasing and
+// end at the size of columns and values.
+template <typename T>
+void SortRows(std::vector<size_t>& offsets, std::vector<size_t>& columns, std::vector<T>& values,
+    const bool sum_repeated = true);
+
+} // namespace sparse_detail
+
+template <typename T>
+SparseMatrix<T> Transp(const SparseMatrix<T>& mat);
+
+// lhs * rhs and lhs^T * rhs against a dense block
+template <typename T>
+Matrix<T> operator*(const SparseMatrix<T>& lhs, const Matrix<T>& rhs);
+template <typename T>
+Matrix<T> MultiplyTransposed(const SparseMatrix<T>& lhs, const Matrix<T>& rhs);
+
+template <typename T>
+void Multiply(const SparseMatrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res);
+template <typename T>
+Vector<T> operator*(const SparseMatrix<T>& lhs, const Vector<T>& rhs);
+
+// Stream of "size_row size_column", then the lines of column indices, row offsets and values.
+// The stream is left right after the line of values.
+template <typename T>
+SparseMatrix<T> ParceCSRFormat(std::istream& input);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const size_t size_column, const size_t size_row)
+    : size_column_(size_column)
+    , size_row_(size_row)
+    , row_offsets_(size_column + 1, 0){}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const size_t size_column, const size_t size_row, std::vector<size_t> row_offsets,
+    std::vector<size_t> columns, std::vector<T> values)
+    : size_column_(size_column)
+    , size_row_(size_row)
+    , row_offsets_(std::move(row_offsets))
+    , columns_(std::move(columns))
+    , values_(std::move(values)){
+    if((row_offsets_.size() != size_column_ + 1) || (row_offsets_.front() != 0)
+        || (row_offsets_.back() != columns_.size()) || (columns_.size() != values_.size())){
+        throw std::invalid_argument("The CSR arrays are incorrect");
+    }
+    for(size_t i = 0; i < size_column_; ++i){
+        if(row_offsets_[i] > row_offsets_[i + 1]){
+            throw std::invalid_argument("The CSR arrays are incorrect");
+        }
+        for(size_t j = row_offsets_[i]; j < row_offsets_[i + 1]; ++j){
+            if((columns_[j] >= size_row_) || ((j > row_offsets_[i]) && (columns_[j] <= columns_[j - 1]))){
+                throw std::invalid_argument("The CSR arrays are incorrect");
+            }
+        }
+    }
+}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const Matrix<T>& mat)
+    : SparseMatrix(mat.SizeColumn(), mat.SizeRow()){
+    if(!mat.Correct() && !mat.Empty()){
+        throw std::invalid_argument("The matrix is incorrect for conversion");
+    }
+    for(size_t i = 0; i < size_column_; ++i){
+        for(size_t j = 0; j < size_row_; ++j){
+            if(mat[i][j] != T()){
+                columns_.push_back(j);
+                values_.push_back(mat[i][j]);
+            }
+        }
+        row_offsets_[i + 1] = columns_.size();
+    }
+}
+
+template <typename T>
+size_t SparseMatrix<T>::SizeRow() const noexcept{
+    return size_row_;
+}
+
+template <typename T>
+size_t SparseMatrix<T>::SizeColumn() const noexcept{
+    return size_column_;
+}
+
+template <typename T>
+size_t SparseMatrix<T>::NonZeros() const noexcept{
+    return values_.size();
+}
+
+template <typename T>
+const std::vector<size_t>& SparseMatrix<T>::RowOffsets() const noexcept{
+    return row_offsets_;
+}
+
+template <typename T>
+const std::vector<size_t>& SparseMatrix<T>::Columns() const noexcept{
+    return columns_;
+}
+
+template <typename T>
+const std::vector<T>& SparseMatrix<T>::Values() const noexcept{
+    return values_;
+}
+
+namespace sparse_detail{
+
+template <typename Func>
+void ForEachRowRange(size_t rows, size_t non_zeros, Func func){
+    const size_t threads = NumThreads();
+    if((threads < 2) || (non_zeros < PARALLEL_NON_ZEROS)){
+        func(size_t(0), rows);
+        return;
+    }
+    // Several ranges per thread even out rows of different density
+    const size_t ranges = std::min(rows, 4 * threads);
+    SharedThreadPool().ParallelFor(ranges, [&](size_t r){
+        func(rows * r / ranges, rows * (r + 1) / ranges);
+    });
+}
+
+template <typename T>
+void MultiplyVector(size_t rows, const size_t* offsets, const size_t* columns, const T* values, const T* x, T* y){
+    ForEachRowRange(rows, offsets[rows], [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            T sum = T();
+            for(size_t j = offsets[i]; j < offsets[i + 1]; ++j){
+                sum += values[j] * x[columns[j]];
+            }
+            y[i] = sum;
+        }
+    });
+}
+
+template <typename T>
+void MultiplyTransposedVector(size_t rows, size_t size_row, const size_t* offsets, const size_t* columns,
+    const T* values, const T* x, T* y){
+    std::fill(y, y + size_row, T());
+    for(size_t i = 0; i < rows; ++i){
+        const T x_val = x[i];
+        for(size_t j = offsets[i]; j < offsets[i + 1]; ++j){
+            y[columns[j]] += values[j] * x_val;
+        }
+    }
+}
+
+template <typename T>
+void SortRows(std::vector<size_t>& offsets, std::vector<size_t>& columns, std::vector<T>& values,
+    const bool sum_repeated){
+    std::vector<std::pair<size_t, T>> row;
+    size_t size = 0;
+    for(size_t i = 0; i + 1 < offsets.size(); ++i){
+        row.clear();
+        for(size_t j = offsets[i]; j < offsets[i + 1]; ++j){
+            row.emplace_back(columns[j], values[j]);
+        }
+        std::stable_sort(row.begin(), row.end(), [](const auto& lhs, const auto& rhs){return lhs.first < rhs.first;});
+        // The row is copied out, so writing from offsets[i] down to size never overtakes the reading
+        offsets[i] = size;
+        for(const auto& [column, value] : row){
+            if((size > offsets[i]) && (columns[size - 1] == column)){
+                values[size - 1] = sum_repeated ? values[size - 1] + value : value;
+            }
+            else{
+                columns[size] = column;
+                values[size++] = value;
+            }
+        }
+    }
+    offsets.back() = size;
+    columns.resize(size);
+    values.resize(size);
+}
+
+} // namespace sparse_detail
+
+template <typename T>
+void SparseMatrix<T>::MultiplyVector(const T* x, T* y) const{
+    sparse_detail::MultiplyVector(size_column_, row_offsets_.data(), columns_.data(), values_.data(), x, y);
+}
+
+template <typename T>
+void SparseMatrix<T>::MultiplyTransposedVector(const T* x, T* y) const{
+    sparse_detail::MultiplyTransposedVector(size_column_, size_row_, row_offsets_.data(), columns_.data(),
+        values_.data(), x, y);
+}
+
+template <typename T>
+Matrix<T> SparseMatrix<T>::ToDense() const{
+    Matrix<T> res(size_column_, size_row_, T());
+    for(size_t i = 0; i < size_column_; ++i){
+        for(size_t j = row_offsets_[i]; j < row_offsets_[i + 1]; ++j){
+            res[i][columns_[j]] = values_[j];
+        }
+    }
+    return res;
+}
+
+template <typename T>
+bool SparseMatrix<T>::operator==(const SparseMatrix& rhs) const{
+    return (size_column_ == rhs.size_column_) && (size_row_ == rhs.size_row_)
+        && (row_offsets_ == rhs.row_offsets_) && (columns_ == rhs.columns_) && (values_ == rhs.values_);
+}
+
+template <typename T>
+bool SparseMatrix<T>::operator!=(const SparseMatrix& rhs) const{
+    return !(*this == rhs);
+}
+
+template <typename T>
+SparseMatrix<T> Transp(const SparseMatrix<T>& mat){
+    // Counting sort of the nonzeros by column, rows come out in order within each column
+    const std::vector<size_t>& offsets = mat.RowOffsets();
+    const std::vector<size_t>& columns = mat.Columns();
+    const std::vector<T>& values = mat.Values();
+    std::vector<size_t> res_offsets(mat.SizeRow() + 1, 0);
+    for(size_t column : columns){
+        ++res_offsets[column + 1];
+    }
+    for(size_t i = 0; i < mat.SizeRow(); ++i){
+        res_offsets[i + 1] += res_offsets[i];
+    }
+    std::vector<size_t> res_columns(columns.size()), next(res_offsets.begin(), res_offsets.end() - 1);
+    std::vector<T> res_values(values.size());
+    for(size_t i = 0; i < mat.SizeColumn(); ++i){
+        for(size_t j = offsets[i]; j < offsets[i + 1]; ++j){
+            const size_t pos = next[columns[j]]++;
+            res_columns[pos] = i;
+            res_values[pos] = values[j];
+        }
+    }
+    return SparseMatrix<T>(mat.SizeRow(), mat.SizeColumn(), std::move(res_offsets), std::move(res_columns),
+        std::move(res_values));
+}
+
+template <typename T>
+Matrix<T> operator*(const SparseMatrix<T>& lhs, const Matrix<T>& rhs){
+    if((lhs.SizeRow() != rhs.SizeColumn()) || (rhs.SizeRow() == 0) || !rhs.Correct()){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    const size_t n = rhs.SizeRow();
+    Matrix<T> res(lhs.SizeColumn(), n, T());
+    const std::vector<size_t>& offsets = lhs.RowOffsets();
+    sparse_detail::ForEachRowRange(lhs.SizeColumn(), lhs.NonZeros(), [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            for(size_t j = offsets[i]; j < offsets[i + 1]; ++j){
+                SimdAxpy(res[i].data(), lhs.Values()[j], rhs[lhs.Columns()[j]].data(), n);
+            }
+        }
+    });
+    return res;
+}
+
+template <typename T>
+Matrix<T> MultiplyTransposed(const SparseMatrix<T>& lhs, const Matrix<T>& rhs){
+    if((lhs.SizeColumn() != rhs.SizeColumn()) || (rhs.SizeRow() == 0) || !rhs.Correct()){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    const size_t n = rhs.SizeRow();
+    Matrix<T> res(lhs.SizeRow(), n, T());
+    const std::vector<size_t>& offsets = lhs.RowOffsets();
+    for(size_t i = 0; i < lhs.SizeColumn(); ++i){
+        for(size_t j = offsets[i]; j < offsets[i + 1]; ++j){
+            SimdAxpy(res[lhs.Columns()[j]].data(), lhs.Values()[j], rhs[i].data(), n);
+        }
+    }
+    return res;
+}
+
+template <typename T>
+void Multiply(const SparseMatrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res){
+    if((lhs.SizeRow() != rhs.Size()) || (lhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    res.Resize(lhs.SizeColumn());
+    lhs.MultiplyVector(rhs.Data(), res.Data());
+}
+
+template <typename T>
+Vector<T> operator*(const SparseMatrix<T>& lhs, const Vector<T>& rhs){
+    Vector<T> res;
+    Multiply(lhs, rhs, res);
+    return res;
+}
+
+template <typename T>
+SparseMatrix<T> ParceCSRFormat(std::istream& input){
+    TextReader reader(input);
+    std::vector<size_t> sizes, indices, indptr;
+    std::vector<T> data;
+    reader.ReadLine(sizes);
+    if(sizes.size() != 2){
+        throw std::invalid_argument("The CSR header is incorrect");
+    }
+    const size_t size_row = sizes[0], size_column = sizes[1];
+    reader.ReadLine(indices);
+    reader.ReadLine(indptr);
+    reader.ReadLine(data);
+    reader.Finish();
+    if(indptr.empty() && (size_column == 0)){
+        indptr.push_back(0);
+    }
+    // The columns of a row may come in any order and repeat, as the dense parser allowed; the last
+    // value of a repeated column is kept, as it was written last into the dense matrix
+    if((indptr.size() != size_column + 1) || (indptr.front() != 0) || (indptr.back() != indices.size())
+        || (indices.size() != data.size()) || !std::is_sorted(indptr.begin(), indptr.end())){
+        throw std::invalid_argument("The CSR arrays are incorrect");
+    }
+    sparse_detail::SortRows(indptr, indices, data, false);
+    return SparseMatrix<T>(size_column, size_row, std::move(indptr), std::move(indices), std::move(data));
+}
@@ -0,0 +1,431 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "gemm.h"
+#include "golub_kahan_svd.h"
+
+#include <vector>
+#include <future>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// A row source hands out the rows of a matrix in order and never holds more than the block it is
+// given: SizeRow() is the length of every row, Read(block) fills the leading rows of block and
+// returns how many it wrote (0 once the rows are exhausted), Rewind() starts over from the first row.
+
+// Rows produced by a callback that writes one row to the pointer it gets and returns false at the end
+template <typename T>
+class CallbackRowSource{
+public:
+    CallbackRowSource(const size_t size_row, std::function<bool(T*)> next_row, std::function<void()> rewind);
+
+    size_t SizeRow() const noexcept;
+    size_t Read(Matrix<T>& block);
+    void Rewind();
+
+private:
+    size_t size_row_;
+    std::function<bool(T*)> next_row_;
+    std::function<void()> rewind_;
+};
+
+// Rows stored one after another as raw values of T, starting at the current position of input.
+// Input that ends in the middle of a row throws std::invalid_argument.
+template <typename T>
+class BinaryRowSource{
+public:
+    BinaryRowSource(std::istream& input, const size_t size_row);
+
+    size_t SizeRow() const noexcept;
+    size_t Read(Matrix<T>& block);
+    void Rewind();
+
+private:
+    std::istream& input_;
+    std::streampos start_;
+    size_t size_row_;
+};
+
+// A row sink takes the rows of a matrix in order, as a source hands them out: Write(block, rows)
+// consumes the leading rows of block, which is reused for the next rows after the call.
+
+// Rows passed one by one to a callback
+template <typename T>
+class CallbackRowSink{
+public:
+    explicit CallbackRowSink(std::function<void(const T*)> row);
+
+    void Write(const Matrix<T>& block, size_t rows);
+
+private:
+    std::function<void(const T*)> row_;
+};
+
+// Rows written one after another as raw values of T, the layout BinaryRowSource reads
+template <typename T>
+class BinaryRowSink{
+public:
+    explicit BinaryRowSink(std::ostream& output);
+
+    void Write(const Matrix<T>& block, size_t rows);
+
+private:
+    std::ostream& output_;
+};
+
+// SVD of a matrix streamed from source in row blocks, for matrices that do not fit in memory.
+// Each block is reduced to its triangular QR factor and the factors are merged pairwise in a
+// binary tree (TSQR), so only the small n x n factor R of the whole matrix is decomposed:
+// A = Q * R and R = U_R * S * V^T give S and V. The first pass starts at the current position of
+// the source. The next block is read on another thread while the current one is reduced.
+// memory_budget bounds the bytes of the two row buffers, the reduction tree and, with a sink, the
+// block of U; the block height is derived from it. left_singular_vectors stays empty: U has as
+// many rows as A, so the second overload rewinds the source and hands U = A * V * S^-1 to
+// left_sink one block of rows at a time.
+template <typename T, typename Source>
+SVD<T> CalculateStreamingSVD(Source& source, const size_t num_vec, const size_t memory_budget);
+template <typename T, typename Source, typename Sink>
+SVD<T> CalculateStreamingSVD(Source& source, const size_t num_vec, const size_t memory_budget, Sink& left_sink);
+
+namespace streaming_detail{
+
+// Levels of the reduction tree, a stream of more than 2^(MAX_LEVELS - 1) blocks keeps merging
+// into the top level
+inline constexpr size_t MAX_LEVELS = 16;
+
+// Columns of a Householder panel, applied to the trailing columns at once
+inline constexpr size_t PANEL = 32;
+
+// Rows per block that keep two blocks, the panel of the QR, the tree and the merge buffers, and
+// a block of left_columns columns of U within memory_budget
+template <typename T>
+size_t BlockRows(size_t size_row, size_t left_columns, size_t memory_budget);
+
+// Triangular factor R (n x n, zero padded) of the QR factorization of the first rows of a,
+// which is overwritten by the Householder vectors
+template <typename T>
+Matrix<T> TriangularFactor(Matrix<T>& a, size_t rows);
+
+// Adds a block factor to the tree, merging equal levels like a binary counter
+template <typename T>
+void PushFactor(std::vector<Matrix<T>>& levels, Matrix<T> factor);
+
+// Reads every block of source into one of two buffers while the previous one is processed by
+// func(block, rows)
+template <typename T, typename Source, typename Func>
+void ForEachBlock(Source& source, std::vector<Matrix<T>>& buffers, Func func);
+
+// First pass: S and V from the R factor of the whole matrix, the rows seen in total_rows
+template <typename T, typename Source>
+SVD<T> RightSVD(Source& source, size_t num_vec, std::vector<Matrix<T>>& buffers, size_t& total_rows);
+
+} // namespace streaming_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+template <typename T>
+CallbackRowSource<T>::CallbackRowSource(const size_t size_row, std::function<bool(T*)> next_row,
+    std::function<void()> rewind)
+    : size_row_(size_row)
+    , next_row_(std::move(next_row))
+    , rewind_(std::move(rewind)){
+}
+
+template <typename T>
+size_t CallbackRowSource<T>::SizeRow() const noexcept{
+    return size_row_;
+}
+
+template <typename T>
+size_t CallbackRowSource<T>::Read(Matrix<T>& block){
+    size_t rows = 0;
+    while((rows < block.SizeColumn()) && next_row_(block[rows].data())){
+        ++rows;
+    }
+    return rows;
+}
+
+template <typename T>
+void CallbackRowSource<T>::Rewind(){
+    rewind_();
+}
+
+template <typename T>
+CallbackRowSink<T>::CallbackRowSink(std::function<void(const T*)> row)
+    : row_(std::move(row)){
+}
+
+template <typename T>
+void CallbackRowSink<T>::Write(const Matrix<T>& block, size_t rows){
+    for(size_t i = 0; i < rows; ++i){
+        row_(block[i].data());
+    }
+}
+
+template <typename T>
+BinaryRowSink<T>::BinaryRowSink(std::ostream& output)
+    : output_(output){
+}
+
+template <typename T>
+void BinaryRowSink<T>::Write(const Matrix<T>& block, size_t rows){
+    const std::streamsize row_bytes = std::streamsize(block.SizeRow() * sizeof(T));
+    for(size_t i = 0; i < rows; ++i){
+        output_.write(reinterpret_cast<const char*>(block[i].data()), row_bytes);
+    }
+}
+
+template <typename T>
+BinaryRowSource<T>::BinaryRowSource(std::istream& input, const size_t size_row)
+    : input_(input)
+    , start_(input.tellg())
+    , size_row_(size_row){
+}
+
+template <typename T>
+size_t BinaryRowSource<T>::SizeRow() const noexcept{
+    return size_row_;
+}
+
+template <typename T>
+size_t BinaryRowSource<T>::Read(Matrix<T>& block){
+    const std::streamsize row_bytes = std::streamsize(size_row_ * sizeof(T));
+    size_t rows = 0;
+    while((rows < block.SizeColumn())
+        && input_.read(reinterpret_cast<char*>(block[rows].data()), row_bytes)){
+        ++rows;
+    }
+    if((rows < block.SizeColumn()) && (input_.gcount() != 0)){
+        throw std::invalid_argument("The binary rows are truncated");
+    }
+    return rows;
+}
+
+template <typename T>
+void BinaryRowSource<T>::Rewind(){
+    input_.clear();
+    input_.seekg(start_);
+}
+
+namespace streaming_detail{
+
+template <typename T>
+size_t BlockRows(size_t size_row, size_t left_columns, size_t memory_budget){
+    const size_t fixed = (MAX_LEVELS + 3) * size_row * size_row * sizeof(T);
+    const size_t row_bytes = (2 * size_row + PANEL + left_columns) * sizeof(T);
+    if((memory_budget < fixed) || ((memory_budget - fixed) / row_bytes < size_row)){
+        throw std::invalid_argument("The memory budget is too small for the row blocks");
+    }
+    return (memory_budget - fixed) / row_bytes;
+}
+
+template <typename T>
+Matrix<T> TriangularFactor(Matrix<T>& a, size_t rows){
+    const size_t n = a.SizeRow(), count = std::min(rows, n);
+    std::vector<T> beta(count), tau(PANEL);
+    Matrix<T> panel(0), gram(PANEL, PANEL, T()), t(PANEL, PANEL, T()), product(PANEL, n, T());
+    for(size_t k0 = 0; k0 < count; k0 += PANEL){
+        const size_t nb = std::min(PANEL, count - k0), height = rows - k0;
+        // The panel columns are copied to rows, so its unblocked factorization runs over long
+        // contiguous vectors and the buffer ends up holding V^T
+        panel = Matrix<T>(nb, height, T());
+        for(size_t i = 0; i < height; ++i){
+            for(size_t j = 0; j < nb; ++j){
+                panel[j][i] = a[k0 + i][k0 + j];
+            }
+        }
+        for(size_t k = 0; k < nb; ++k){
+            const golub_kahan_detail::Reflector<T> reflector =
+                golub_kahan_detail::MakeReflector(panel[k][k], &panel[k][k] + 1, height - k - 1, size_t(1));
+            beta[k0 + k] = reflector.beta;
+            tau[k] = reflector.tau;
+            panel[k][k] = T(1);
+            if(reflector.tau == T(0)){
+                continue;
+            }
+            for(size_t j = k + 1; j < nb; ++j){
+                const T dot = SimdDot(&panel[k][k], &panel[j][k], height - k);
+                SimdAxpy(&panel[j][k], -reflector.tau * dot, &panel[k][k], height - k);
+            }
+        }
+        // The strictly upper part of the panel is R, V is unit lower trapezoidal
+        for(size_t j = 0; j < nb; ++j){
+            for(size_t i = 0; i < j; ++i){
+                a[k0 + i][k0 + j] = panel[j][i];
+                panel[j][i] = T(0);
+            }
+        }
+        const size_t rest = n - k0 - nb;
+        if(rest == 0){
+            continue;
+        }
+
+        // H_0 * ... * H_{nb-1} = I - V * T * V^T with T upper triangular
+        for(size_t i = 0; i < nb; ++i){
+            std::fill(gram[i].begin(), gram[i].begin() + nb, T());
+            std::fill(t[i].begin(), t[i].begin() + nb, T());
+        }
+        Gemm<T>(nb, nb, height, {panel.Data(), panel.Stride(), 1}, {panel.Data(), 1, panel.Stride()},
+            gram.Data(), gram.Stride());
+        for(size_t j = 0; j < nb; ++j){
+            t[j][j] = tau[j];
+            for(size_t i = 0; i < j; ++i){
+                T sum = 0;
+                for(size_t l = i; l < j; ++l){
+                    sum += t[i][l] * gram[l][j];
+                }
+                t[i][j] = -tau[j] * sum;
+            }
+        }
+
+        // Trailing columns C -= V * T^T * (V^T * C), both large products are GEMMs
+        for(size_t i = 0; i < nb; ++i){
+            std::fill(product[i].begin(), product[i].begin() + rest, T());
+        }
+        T* trailing = &a[k0][k0 + nb];
+        Gemm<T>(nb, rest, height, {panel.Data(), panel.Stride(), 1}, {trailing, a.Stride(), 1},
+            product.Data(), product.Stride());
+        for(size_t i = nb; i-- > 0;){
+            SimdScale(product[i].data(), -t[i][i], rest);
+            for(size_t l = 0; l < i; ++l){
+                SimdAxpy(product[i].data(), -t[l][i], product[l].data(), rest);
+            }
+        }
+        Gemm<T>(height, rest, nb, {panel.Data(), 1, panel.Stride()}, {product.Data(), product.Stride(), 1},
+            trailing, a.Stride());
+    }
+
+    Matrix<T> r(n, n, T());
+    for(size_t i = 0; i < count; ++i){
+        r[i][i] = beta[i];
+        std::copy(a[i].data() + i + 1, a[i].data() + n, r[i].data() + i + 1);
+    }
+    return r;
+}
+
+template <typename T>
+void PushFactor(std::vector<Matrix<T>>& levels, Matrix<T> factor){
+    const size_t n = factor.SizeRow();
+    for(size_t level = 0; ; ++level){
+        if(level == levels.size()){
+            levels.push_back(std::move(factor));
+            return;
+        }
+        if(levels[level].SizeColumn() == 0){
+            levels[level] = std::move(factor);
+            return;
+        }
+        levels[level].PushBackRow(factor);
+        factor = TriangularFactor(levels[level], 2 * n);
+        if(level + 1 == MAX_LEVELS){
+            levels[level] = std::move(factor);
+            return;
+        }
+        levels[level] = Matrix<T>(0);
+    }
+}
+
+template <typename T, typename Source, typename Func>
+void ForEachBlock(Source& source, std::vector<Matrix<T>>& buffers, Func func){
+    size_t current = 0;
+    std::future<size_t> pending = std::async(std::launch::async, [&source, &buffers]{
+        return source.Read(buffers[0]);
+    });
+    while(const size_t rows = pending.get()){
+        const size_t next = 1 - current;
+        pending = std::async(std::launch::async, [&source, &buffers, next]{
+            return source.Read(buffers[next]);
+        });
+        func(buffers[current], rows);
+        current = next;
+    }
+}
+
+template <typename T, typename Source>
+SVD<T> RightSVD(Source& source, size_t num_vec, std::vector<Matrix<T>>& buffers, size_t& total_rows){
+    const size_t n = source.SizeRow();
+    std::vector<Matrix<T>> levels;
+    total_rows = 0;
+    ForEachBlock<T>(source, buffers, [&levels, &total_rows](Matrix<T>& block, size_t rows){
+        total_rows += rows;
+        PushFactor(levels, TriangularFactor(block, rows));
+    });
+    if(num_vec > total_rows){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    Matrix<T> r(0);
+    for(Matrix<T>& level : levels){
+        if(level.SizeColumn() == 0){
+            continue;
+        }
+        if(r.SizeColumn() == 0){
+            r = std::move(level);
+            continue;
+        }
+        r.PushBackRow(level);
+        r = TriangularFactor(r, 2 * n);
+    }
+    levels.clear();
+
+    SVD<T> res = CalculateGolubKahanSVD(r, num_vec, std::numeric_limits<T>::epsilon());
+    res.left_singular_vectors = Matrix<T>(0);
+    return res;
+}
+
+} // namespace streaming_detail
+
+template <typename T, typename Source>
+SVD<T> CalculateStreamingSVD(Source& source, const size_t num_vec, const size_t memory_budget){
+    if((num_vec == 0) || (num_vec > source.SizeRow())){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    const size_t n = source.SizeRow(), block_rows = streaming_detail::BlockRows<T>(n, 0, memory_budget);
+    std::vector<Matrix<T>> buffers{Matrix<T>(block_rows, n, T()), Matrix<T>(block_rows, n, T())};
+    size_t total_rows = 0;
+    return streaming_detail::RightSVD<T>(source, num_vec, buffers, total_rows);
+}
+
+template <typename T, typename Source, typename Sink>
+SVD<T> CalculateStreamingSVD(Source& source, const size_t num_vec, const size_t memory_budget, Sink& left_sink){
+    if((num_vec == 0) || (num_vec > source.SizeRow())){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    const size_t n = source.SizeRow(), block_rows = streaming_detail::BlockRows<T>(n, num_vec, memory_budget);
+    std::vector<Matrix<T>> buffers{Matrix<T>(block_rows, n, T()), Matrix<T>(block_rows, n, T())};
+    size_t total_rows = 0;
+    SVD<T> res = streaming_detail::RightSVD<T>(source, num_vec, buffers, total_rows);
+
+    // Second pass: U = A * V * S^-1, one block of rows of U per block of A
+    Matrix<T> scaled = res.right_singular_vectors;
+    for(size_t i = 0; i < n; ++i){
+        for(size_t j = 0; j < num_vec; ++j){
+            const T sigma = res.eigenvalues[j][j];
+            scaled[i][j] = (sigma > T(0)) ? scaled[i][j] / sigma : T(0);
+        }
+    }
+    Matrix<T> left(block_rows, num_vec, T());
+    size_t offset = 0;
+    source.Rewind();
+    streaming_detail::ForEachBlock<T>(source, buffers, [&](Matrix<T>& block, size_t rows){
+        rows = std::min(rows, total_rows - offset);
+        if(rows == 0){
+            return;
+        }
+        for(size_t i = 0; i < rows; ++i){
+            std::fill(left[i].begin(), left[i].end(), T());
+        }
+        Gemm<T>(rows, num_vec, n, {block.Data(), block.Stride(), 1}, {scaled.Data(), scaled.Stride(), 1},
+            left.Data(), left.Stride());
+        left_sink.Write(left, rows);
+        offset += rows;
+    });
+    return res;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "matrix.h"
+#include "svd.h"
+#include "symmetric_matrix.h"
+#include "jacobi_svd.h"
+#include "orthonormalize.h"
+#include "randomized_svd.h"
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Top num_vec triplets by block subspace iteration on mat^T * mat. The whole block is multiplied
+// at once, so every iteration is one GEMM instead of a matrix-vector product per vector, and a
+// Rayleigh-Ritz step on the block keeps its vectors sorted and orthonormal. Leading vectors whose
+// residual drops to error_rate times the largest eigenvalue are locked and leave the block.
+template <typename T>
+SVD<T> CalculateSubspaceSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate);
+
+namespace subspace_detail{
+
+inline constexpr size_t MAX_ITERATIONS = 1000;
+
+// Extra vectors iterated along with the wanted ones, they speed up the convergence of the last ones
+inline size_t BlockSize(size_t num_vec, size_t size) noexcept;
+
+// Rows of block minus their projection onto the rows of locked
+template <typename T>
+void ProjectOut(Matrix<T>& block, const Matrix<T>& locked);
+
+// Rows [begin, end) of mat appended to res
+template <typename T>
+void AppendRows(Matrix<T>& res, const Matrix<T>& mat, size_t begin, size_t end);
+
+} // namespace subspace_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace subspace_detail{
+
+inline size_t BlockSize(size_t num_vec, size_t size) noexcept{
+    return std::min(size, num_vec + std::max<size_t>(num_vec / 2, 4));
+}
+
+template <typename T>
+void ProjectOut(Matrix<T>& block, const Matrix<T>& locked){
+    if(locked.SizeColumn() == 0){
+        return;
+    }
+    const Matrix<T> coefs = block * Transposed(locked);
+    block -= coefs * locked;
+}
+
+template <typename T>
+void AppendRows(Matrix<T>& res, const Matrix<T>& mat, size_t begin, size_t end){
+    for(size_t i = begin; i < end; ++i){
+        res.PushBackRow(std::vector<T>(mat[i].begin(), mat[i].end()));
+    }
+}
+
+} // namespace subspace_detail
+
+template <typename T>
+SVD<T> CalculateSubspaceSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate){
+    if(!mat.Correct()){
+        throw std::invalid_argument("The matrix is incorrect for decomposition");
+    }
+    const size_t n = mat.SizeRow();
+    if((num_vec == 0) || (num_vec > std::min(n, mat.SizeColumn()))){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    const SymmetricMatrix<T> gram = GramColumns(mat);
+
+    // Rows of x are the current vectors and rows of gram_x = x * gram their images
+    Matrix<T> x = randomized_detail::GaussianMatrix<T>(subspace_detail::BlockSize(num_vec, n), n, 1);
+    OrthonormalizeRows(x);
+    Matrix<T> gram_x = x * gram;
+    Matrix<T> locked(0);
+    std::vector<T> values, ritz_values;
+    for(size_t iteration = 0; iteration < subspace_detail::MAX_ITERATIONS; ++iteration){
+        Matrix<T> y = std::move(gram_x);
+        subspace_detail::ProjectOut(y, locked);
+        OrthonormalizeRows(y);
+        Matrix<T> gram_y = y * gram;
+        // Rayleigh-Ritz: the eigenvectors of the projected (positive semidefinite) matrix rotate
+        // y and its image to Ritz vectors sorted by Ritz value
+        const Matrix<T> projected = gram_y * Transposed(y);
+        const SVD<T> ritz = CalculateJacobiSVD(projected, projected.SizeRow(), std::numeric_limits<T>::epsilon());
+        x = Transposed(ritz.left_singular_vectors) * y;
+        gram_x = Transposed(ritz.left_singular_vectors) * gram_y;
+        ritz_values.resize(x.SizeColumn());
+        for(size_t i = 0; i < ritz_values.size(); ++i){
+            ritz_values[i] = ritz.eigenvalues[i][i];
+        }
+
+        const T scale = values.empty() ? ritz_values.front() : values.front();
+        size_t converged = 0;
+        while((converged < x.SizeColumn()) && (values.size() + converged < num_vec)){
+            T residual = 0;
+            for(size_t j = 0; j < n; ++j){
+                const T diff = gram_x[converged][j] - ritz_values[converged] * x[converged][j];
+                residual += diff * diff;
+            }
+            if(std::sqrt(residual) > error_rate * scale){
+                break;
+            }
+            ++converged;
+        }
+        values.insert(values.end(), ritz_values.begin(), ritz_values.begin() + converged);
+        subspace_detail::AppendRows(locked, x, 0, converged);
+        if(values.size() == num_vec){
+            break;
+        }
+        if(converged){
+            Matrix<T> rest(0);
+            subspace_detail::AppendRows(rest, gram_x, converged, gram_x.SizeColumn());
+            gram_x = std::move(rest);
+        }
+    }
+    // Out of iterations, the best current approximations fill the remaining places
+    if(values.size() < num_vec){
+        const size_t missing = num_vec - values.size();
+        values.insert(values.end(), ritz_values.begin(), ritz_values.begin() + missing);
+        subspace_detail::AppendRows(locked, x, 0, missing);
+    }
+
+    // The locked rows are V^T, U = mat * V / sigma
+    SVD<T> res;
+    res.eigenvalues = Matrix<T>(num_vec, num_vec, T());
+    for(size_t i = 0; i < num_vec; ++i){
+        res.eigenvalues[i][i] = std::sqrt(std::max(values[i], T(0)));
+    }
+    res.left_singular_vectors = mat * Transposed(locked);
+    for(size_t i = 0; i < res.left_singular_vectors.SizeColumn(); ++i){
+        for(size_t j = 0; j < num_vec; ++j){
+            const T sigma = res.eigenvalues[j][j];
+            res.left_singular_vectors[i][j] = (sigma > T(0)) ? res.left_singular_vectors[i][j] / sigma : T(0);
+        }
+    }
+    res.right_singular_vectors = Transp(locked);
+    return res;
+}
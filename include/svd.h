@@ -1,9 +1,16 @@
 #pragma once
 
 #include "matrix.h"
+#include "dense_vector.h"
+#include "symmetric_matrix.h"
+#include "linear_operator.h"
 
+#include <vector>
 #include <utility>
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <concepts>
 
 template<typename T>
 struct SVD{
@@ -17,6 +24,9 @@ T ScalarMultiplication(const Matrix<T>& lhs, const Matrix<T>& rhs){
     if((lhs.SizeRow() != 1) || (rhs.SizeRow() != 1) || (rhs.SizeColumn() != lhs.SizeColumn())){
             throw std::invalid_argument("The dimensions of the matrices are incorrect for scalar multiplication");
         }
+    if((lhs.Stride() == 1) && (rhs.Stride() == 1)){
+        return SimdDot(lhs.Data(), rhs.Data(), lhs.SizeColumn());
+    }
     T res = 0;
     for(size_t i = 0; i < lhs.SizeColumn(); ++i){
         res += lhs[i].front() * rhs[i].front();
@@ -25,30 +35,320 @@ T ScalarMultiplication(const Matrix<T>& lhs, const Matrix<T>& rhs){
 }
 
 template <typename T>
-std::pair<T, Matrix<T>> CalculateMaxEigenval(const Matrix<T>& mat, const T error_rate){
-    Matrix<T> y(mat.SizeRow(), 1, 1);
-    Matrix<T> u = Normalize(y);
-    T l;
-    size_t i = 0;
+T ScalarMultiplication(const Vector<T>& lhs, const Vector<T>& rhs){
+    if(rhs.Size() != lhs.Size()){
+        throw std::invalid_argument("The dimensions of the matrices are incorrect for scalar multiplication");
+    }
+    return SimdDot(lhs.Data(), rhs.Data(), lhs.Size());
+}
+
+// mat - sum values[i] * vectors[i] * vectors[i]^T over the pairs deflated so far. The correction is
+// applied inside the product, so a deflation step is O(n * count) and never touches mat itself.
+template <typename T, typename M>
+class DeflatedMatrix{
+public:
+    DeflatedMatrix(const M& mat, const size_t capacity, const AlignedAllocator<T>& alloc = {});
+
+    size_t SizeRow() const noexcept;
+    size_t Count() const noexcept;
+
+    void Deflate(const T& value, const Vector<T>& vec);
+    void MultiplyVector(const Vector<T>& x, Vector<T>& y) const;
+
+private:
+    const M& mat_;
+    Matrix<T> vectors_;
+    Vector<T> values_;
+    size_t count_ = 0;
+};
+
+template <typename T, typename M>
+void Multiply(const DeflatedMatrix<T, M>& lhs, const Vector<T>& rhs, Vector<T>& res);
+
+template <typename T, typename M>
+DeflatedMatrix<T, M>::DeflatedMatrix(const M& mat, const size_t capacity, const AlignedAllocator<T>& alloc)
+    : mat_(mat)
+    , vectors_(capacity, mat.SizeRow(), T(), alloc)
+    , values_(capacity, T(), alloc){
+}
+
+template <typename T, typename M>
+size_t DeflatedMatrix<T, M>::SizeRow() const noexcept{
+    return mat_.SizeRow();
+}
+
+template <typename T, typename M>
+size_t DeflatedMatrix<T, M>::Count() const noexcept{
+    return count_;
+}
+
+template <typename T, typename M>
+void DeflatedMatrix<T, M>::Deflate(const T& value, const Vector<T>& vec){
+    if((vec.Size() != SizeRow()) || (count_ == values_.Size())){
+        throw std::invalid_argument("The vector is incorrect for the update");
+    }
+    std::copy(vec.begin(), vec.end(), vectors_[count_].begin());
+    values_[count_++] = value;
+}
+
+template <typename T, typename M>
+void DeflatedMatrix<T, M>::MultiplyVector(const Vector<T>& x, Vector<T>& y) const{
+    Multiply(mat_, x, y);
+    for(size_t i = 0; i < count_; ++i){
+        const T* vec = vectors_[i].data();
+        SimdAxpy(y.Data(), -values_[i] * SimdDot(vec, x.Data(), x.Size()), vec, y.Size());
+    }
+}
+
+template <typename T, typename M>
+void Multiply(const DeflatedMatrix<T, M>& lhs, const Vector<T>& rhs, Vector<T>& res){
+    lhs.MultiplyVector(rhs, res);
+}
+
+// Steps after the first product at which a power iteration stops even if it has not converged
+inline constexpr size_t MAX_POWER_ITERATIONS = 1000;
+
+// Buffers of the power iteration, sized on first use and reused by every following call.
+// iterations is the number of products spent by the last run.
+template <typename T>
+struct PowerIterationWorkspace{
+    Vector<T> u;
+    Vector<T> y;
+    size_t iterations = 0;
+};
+
+// Power iteration from the unit vector already in workspace.u, leaves the eigenvector there.
+// Once the workspace has the right size the iteration does not allocate.
+template <typename T, typename M>
+T ContinueMaxEigenval(const M& mat, const T error_rate, PowerIterationWorkspace<T>& workspace){
+    Vector<T>& u = workspace.u;
+    Vector<T>& y = workspace.y;
+    T l, residual;
+    workspace.iterations = 0;
     do {
-        y = mat * u;
-        l = ScalarMultiplication(y, u) / ScalarMultiplication(u, u);
-        u = Normalize(y);
-    } while((Norma(mat * u - u * l) > error_rate) &&  (i++ < 1000));
-    return {l, std::move(u)};
+        // y = A * u serves both the Rayleigh quotient and the residual A * u - l * u of the current u
+        Multiply(mat, u, y);
+        ++workspace.iterations;
+        l = ScalarMultiplication(y, u);
+        u *= -l;
+        u += y;
+        residual = Norma(u);
+        u = y;
+        u /= Norma(y);
+    } while((residual > error_rate) && (workspace.iterations <= MAX_POWER_ITERATIONS));
+    return l;
 }
 
+// Power iteration from the all-ones vector
+template <typename T, typename M>
+T CalculateMaxEigenval(const M& mat, const T error_rate, PowerIterationWorkspace<T>& workspace){
+    Vector<T>& u = workspace.u;
+    u.Resize(mat.SizeRow());
+    std::fill(u.begin(), u.end(), T(1));
+    u /= Norma(u);
+    return ContinueMaxEigenval(mat, error_rate, workspace);
+}
+
+template <typename T, typename M>
+std::pair<T, Vector<T>> CalculateMaxEigenval(const M& mat, const T error_rate){
+    PowerIterationWorkspace<T> workspace;
+    T l = CalculateMaxEigenval(mat, error_rate, workspace);
+    return {l, std::move(workspace.u)};
+}
+
+// Power iteration products of a warm started CalculateSVD for each value, and the products a cold
+// start from the all-ones vector is estimated to take for the same value. The residual of a power
+// iteration shrinks by lambda_{i+1} / lambda_i per product, so the estimate is the number of such
+// steps from the residual of the all-ones vector down to error_rate. That residual costs one
+// product per value, the ratio comes from the computed values, or from previous for the last one.
+// Without a known ratio the value is assumed to save nothing.
+struct WarmStartReport{
+    std::vector<size_t> iterations;
+    std::vector<size_t> cold_iterations;
+
+    // Products saved over the estimated cold start, summed over the values
+    size_t Saved() const noexcept;
+};
+
+namespace svd_detail{
+
+// Products a power iteration contracting its residual by ratio per product needs to bring
+// residual down to error_rate, the first one included
 template <typename T>
-SVD<T> CalculateSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate){
-    Matrix<T> m = Transp(mat) * mat;
+size_t EstimateIterations(T residual, T ratio, T error_rate);
+
+// Deflated power iteration on the square operator gram = A^T * A, left_product(v, u) sets u = A * v.
+// The i-th value starts from the i-th right singular vector of previous when there is one,
+// iterations, when given, receives the products spent per value and cold_iterations, given only
+// together with iterations, the estimate of WarmStartReport.
+template <typename T, typename G, typename LeftProduct>
+SVD<T> DeflatedPowerIteration(const G& gram, LeftProduct left_product, const size_t num_vec, const T error_rate,
+    const SVD<T>* previous, std::vector<size_t>* iterations, std::vector<size_t>* cold_iterations,
+    const AlignedAllocator<T>& alloc){
+    const size_t n = gram.SizeRow();
+    DeflatedMatrix<T, G> m(gram, num_vec, alloc);
     SVD<T> res;
     res.eigenvalues = Matrix<T>(num_vec, num_vec, 0);
+    PowerIterationWorkspace<T> workspace{Vector<T>(0, T(), alloc), Vector<T>(0, T(), alloc)};
+    Vector<T> left(0, T(), alloc);
+    if(iterations){
+        iterations->assign(num_vec, 0);
+    }
+    // Gram values and residuals of the all-ones vector against the deflated matrix of each step
+    std::vector<T> values(num_vec), cold_residuals(cold_iterations ? num_vec : 0);
+    std::vector<bool> started_cold(num_vec, false);
+    Vector<T> ones(0, T(), alloc), product(0, T(), alloc);
+    if(cold_iterations){
+        ones = Vector<T>(n, T(1) / std::sqrt(T(n)), alloc);
+        product.Resize(n);
+    }
+    const bool warm = previous && (previous->right_singular_vectors.SizeColumn() == n);
     for(size_t i = 0; i < num_vec; ++i){
-        auto [new_eigenval, new_eigenvec] = CalculateMaxEigenval(m, error_rate);
-        m = m - new_eigenvec * Transp(new_eigenvec) * new_eigenval;
+        T norm = 0;
+        if(warm && (i < previous->right_singular_vectors.SizeRow())){
+            workspace.u.Resize(n);
+            for(size_t j = 0; j < n; ++j){
+                workspace.u[j] = previous->right_singular_vectors[j][i];
+            }
+            norm = Norma(workspace.u);
+        }
+        T new_eigenval;
+        if(norm > T(0)){
+            if(cold_iterations){
+                Multiply(m, ones, product);
+                SimdAxpy(product.Data(), -ScalarMultiplication(product, ones), ones.Data(), n);
+                cold_residuals[i] = Norma(product);
+            }
+            workspace.u /= norm;
+            new_eigenval = ContinueMaxEigenval(m, error_rate, workspace);
+        }
+        else{
+            new_eigenval = CalculateMaxEigenval(m, error_rate, workspace);
+            started_cold[i] = true;
+        }
+        if(iterations){
+            (*iterations)[i] = workspace.iterations;
+        }
+        values[i] = new_eigenval;
+        const Vector<T>& new_eigenvec = workspace.u;
+        m.Deflate(new_eigenval, new_eigenvec);
         res.eigenvalues[i][i] = std::sqrt(new_eigenval);
-        res.left_singular_vectors.PushBackColumn(mat * new_eigenvec / res.eigenvalues[i][i]);
-        res.right_singular_vectors.PushBackColumn(std::move(new_eigenvec));
+        left_product(new_eigenvec, left);
+        left /= res.eigenvalues[i][i];
+        res.left_singular_vectors.PushBackColumn(left.ToMatrix(alloc));
+        res.right_singular_vectors.PushBackColumn(new_eigenvec.ToMatrix(alloc));
+    }
+
+    if(cold_iterations){
+        cold_iterations->assign(num_vec, 0);
+        for(size_t i = 0; i < num_vec; ++i){
+            // A value that did start cold has its cold products measured
+            if(started_cold[i]){
+                (*cold_iterations)[i] = (*iterations)[i];
+                continue;
+            }
+            T next = -1;
+            if(i + 1 < num_vec){
+                next = values[i + 1];
+            }
+            else if(warm && (i + 1 < previous->eigenvalues.SizeColumn())){
+                next = previous->eigenvalues[i + 1][i + 1] * previous->eigenvalues[i + 1][i + 1];
+            }
+            (*cold_iterations)[i] = ((next >= T(0)) && (values[i] > T(0)))
+                ? EstimateIterations(cold_residuals[i], next / values[i], error_rate)
+                : (*iterations)[i];
+        }
     }
     return res;
-}
\ No newline at end of file
+}
+
+template <typename T>
+size_t EstimateIterations(T residual, T ratio, T error_rate){
+    if(residual <= error_rate){
+        return 1;
+    }
+    if(ratio >= T(1)){
+        return MAX_POWER_ITERATIONS + 1;
+    }
+    if(ratio <= T(0)){
+        return 2;
+    }
+    const double steps = std::ceil(std::log(double(error_rate) / double(residual)) / std::log(double(ratio)));
+    return std::min<size_t>(1 + size_t(steps), MAX_POWER_ITERATIONS + 1);
+}
+
+// The dense matrix goes through its Gram matrix, built once
+template <typename T>
+SVD<T> PowerSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate, const SVD<T>* previous,
+    std::vector<size_t>* iterations, std::vector<size_t>* cold_iterations){
+    const size_t n = mat.SizeRow(), rows = mat.SizeColumn();
+    if((num_vec == 0) || (num_vec > std::min(rows, n))){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    // All the scratch of the call comes from one arena sized up front: the Gram matrix, the block
+    // buffer of its build, the iteration vectors and the columns appended to the result
+    ArenaResource arena(sizeof(T) * (n * (n + 1) / 2 + std::min<size_t>(n, 64) * n + 4 * n + rows
+        + num_vec * (rows + 2 * n + 1)) + MATRIX_ALIGNMENT * (3 * num_vec + 12));
+    const AlignedAllocator<T> scratch(&arena);
+
+    const SymmetricMatrix<T> gram = GramColumns(mat, scratch);
+    return DeflatedPowerIteration<T>(gram, [&mat](const Vector<T>& v, Vector<T>& u){
+        Multiply(mat, v, u);
+    }, num_vec, error_rate, previous, iterations, cold_iterations, scratch);
+}
+
+// An operator is never materialized: every power step applies op and then its transpose
+template <typename T, LinearOperator Op>
+SVD<T> PowerSVD(const Op& op, const size_t num_vec, const T error_rate, const SVD<T>* previous,
+    std::vector<size_t>* iterations, std::vector<size_t>* cold_iterations){
+    if((num_vec == 0) || (num_vec > std::min(op.SizeRow(), op.SizeColumn()))){
+        throw std::invalid_argument("The number of singular vectors is incorrect");
+    }
+    const NormalOperator<Op> normal(op);
+    return DeflatedPowerIteration<T>(normal, [&op](const Vector<T>& v, Vector<T>& u){
+        Multiply(op, v, u);
+    }, num_vec, error_rate, previous, iterations, cold_iterations, AlignedAllocator<T>());
+}
+
+} // namespace svd_detail
+
+inline size_t WarmStartReport::Saved() const noexcept{
+    size_t saved = 0;
+    for(size_t i = 0; i < std::min(iterations.size(), cold_iterations.size()); ++i){
+        saved += cold_iterations[i] - std::min(cold_iterations[i], iterations[i]);
+    }
+    return saved;
+}
+
+// iterations, when given, receives the power iteration products spent on each value
+template <typename T>
+SVD<T> CalculateSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate,
+    std::vector<size_t>* iterations = nullptr){
+    return svd_detail::PowerSVD<T>(mat, num_vec, error_rate, nullptr, iterations, nullptr);
+}
+
+// Warm start for a matrix close to the one previous was computed for: the iteration for each value
+// starts from the matching right singular vector of previous instead of the all-ones vector, values
+// beyond those of previous start cold. report, when given, receives the products spent and the
+// estimated products of a cold start, so the savings come without a second run.
+template <typename T>
+SVD<T> CalculateSVD(const Matrix<T>& mat, const size_t num_vec, const T error_rate, const SVD<T>& previous,
+    WarmStartReport* report = nullptr){
+    return svd_detail::PowerSVD<T>(mat, num_vec, error_rate, &previous, report ? &report->iterations : nullptr,
+        report ? &report->cold_iterations : nullptr);
+}
+
+// The same power iteration on any linear operator, e.g. a SparseOperator or a centered view
+template <typename T, LinearOperator Op>
+    requires std::same_as<T, typename Op::value_type>
+SVD<T> CalculateSVD(const Op& op, const size_t num_vec, const T error_rate, std::vector<size_t>* iterations = nullptr){
+    return svd_detail::PowerSVD<T>(op, num_vec, error_rate, nullptr, iterations, nullptr);
+}
+
+template <typename T, LinearOperator Op>
+    requires std::same_as<T, typename Op::value_type>
+SVD<T> CalculateSVD(const Op& op, const size_t num_vec, const T error_rate, const SVD<T>& previous,
+    WarmStartReport* report = nullptr){
+    return svd_detail::PowerSVD<T>(op, num_vec, error_rate, &previous, report ? &report->iterations : nullptr,
+        report ? &report->cold_iterations : nullptr);
+}
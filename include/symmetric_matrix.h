@@ -0,0 +1,332 @@
+#pragma once
+
+#include "matrix.h"
+#include "dense_vector.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+// Symmetric matrix that stores only its lower triangle, packed row by row:
+// row i holds the i + 1 elements (i, 0) ... (i, i).
+template <typename T>
+class SymmetricMatrix final{
+public:
+    using value_type = T;
+    using allocator_type = AlignedAllocator<T>;
+
+    explicit SymmetricMatrix(const size_t size = 0, const T& val = T(), const allocator_type& alloc = allocator_type());
+
+    allocator_type GetAllocator() const noexcept;
+
+    size_t SizeRow() const noexcept;
+    size_t SizeColumn() const noexcept;
+
+    T* Data() noexcept;
+    const T* Data() const noexcept;
+
+    // Packed lower part of row i
+    RowView<const T> operator[](size_t index) const noexcept;
+    RowView<T> operator[](size_t index) noexcept;
+
+    T& operator()(size_t i, size_t j) noexcept;
+    const T& operator()(size_t i, size_t j) const noexcept;
+
+    // *this += alpha * vec * vec^T for an n x 1 vec
+    void RankOneUpdate(const T& alpha, const Matrix<T>& vec);
+    void RankOneUpdate(const T& alpha, const Vector<T>& vec);
+
+    // y = *this * x for contiguous x and y of SizeRow() elements
+    void MultiplyVector(const T* x, T* y) const;
+
+    Matrix<T> ToDense() const;
+
+private:
+    static size_t Offset(size_t row) noexcept;
+
+    std::vector<T, AlignedAllocator<T>> data_;
+    size_t size_;
+};
+
+namespace symmetric_detail{
+
+// One sweep over the packed rows: row i contributes a dot product to y[i]
+// and, through symmetry, its mirror column to y[0 .. i), both from the same loads.
+struct PackedSymv{
+    template <size_t Bytes, typename T>
+    [[gnu::always_inline]] static void Run(const T* packed, size_t size, const T* x, T* y){
+        for(size_t i = 0; i < size; ++i){
+            const T* row = packed + i * (i + 1) / 2;
+            const T x_val = x[i];
+            T dot = 0;
+            size_t j = 0;
+            if constexpr(Bytes != 0){
+                using V = simd_detail::Vector<T, Bytes>;
+                typename V::Type acc = {}, row_vec, x_vec, y_vec, val_vec = typename V::Type{} + x_val;
+                for(; j + V::LANES <= i; j += V::LANES){
+                    V::Load(row_vec, row + j);
+                    V::Load(x_vec, x + j);
+                    V::Load(y_vec, y + j);
+                    acc += row_vec * x_vec;
+                    y_vec += val_vec * row_vec;
+                    V::Store(y + j, y_vec);
+                }
+                dot = V::Sum(acc);
+            }
+            for(; j < i; ++j){
+                dot += row[j] * x[j];
+                y[j] += x_val * row[j];
+            }
+            y[i] += dot + row[i] * x_val;
+        }
+    }
+};
+
+} // namespace symmetric_detail
+
+// mat^T * mat, the inner products of the columns
+template <typename T>
+SymmetricMatrix<T> GramColumns(const Matrix<T>& mat, const AlignedAllocator<T>& alloc = AlignedAllocator<T>());
+// mat * mat^T, the inner products of the rows
+template <typename T>
+SymmetricMatrix<T> GramRows(const Matrix<T>& mat, const AlignedAllocator<T>& alloc = AlignedAllocator<T>());
+
+template <typename T>
+Matrix<T> operator*(const SymmetricMatrix<T>& lhs, const Matrix<T>& rhs);
+// lhs * rhs, each row of lhs is multiplied by the packed matrix
+template <typename T>
+Matrix<T> operator*(const Matrix<T>& lhs, const SymmetricMatrix<T>& rhs);
+template <typename T>
+void Multiply(const SymmetricMatrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res);
+template <typename T>
+Vector<T> operator*(const SymmetricMatrix<T>& lhs, const Vector<T>& rhs);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+template <typename T>
+SymmetricMatrix<T>::SymmetricMatrix(const size_t size, const T& val, const allocator_type& alloc)
+    : data_(Offset(size), val, alloc), size_(size){}
+
+template <typename T>
+typename SymmetricMatrix<T>::allocator_type SymmetricMatrix<T>::GetAllocator() const noexcept{
+    return data_.get_allocator();
+}
+
+template <typename T>
+size_t SymmetricMatrix<T>::SizeRow() const noexcept{
+    return size_;
+}
+
+template <typename T>
+size_t SymmetricMatrix<T>::SizeColumn() const noexcept{
+    return size_;
+}
+
+template <typename T>
+T* SymmetricMatrix<T>::Data() noexcept{
+    return data_.data();
+}
+
+template <typename T>
+const T* SymmetricMatrix<T>::Data() const noexcept{
+    return data_.data();
+}
+
+template <typename T>
+RowView<const T> SymmetricMatrix<T>::operator[](size_t index) const noexcept{
+    return {data_.data() + Offset(index), index + 1};
+}
+
+template <typename T>
+RowView<T> SymmetricMatrix<T>::operator[](size_t index) noexcept{
+    return {data_.data() + Offset(index), index + 1};
+}
+
+template <typename T>
+T& SymmetricMatrix<T>::operator()(size_t i, size_t j) noexcept{
+    return (j <= i) ? data_[Offset(i) + j] : data_[Offset(j) + i];
+}
+
+template <typename T>
+const T& SymmetricMatrix<T>::operator()(size_t i, size_t j) const noexcept{
+    return (j <= i) ? data_[Offset(i) + j] : data_[Offset(j) + i];
+}
+
+template <typename T>
+void SymmetricMatrix<T>::RankOneUpdate(const T& alpha, const Matrix<T>& vec){
+    if((vec.SizeColumn() != size_) || (vec.SizeRow() != 1)){
+        throw std::invalid_argument("The vector is incorrect for the update");
+    }
+    RankOneUpdate(alpha, Vector<T>(vec));
+}
+
+template <typename T>
+void SymmetricMatrix<T>::RankOneUpdate(const T& alpha, const Vector<T>& vec){
+    if(vec.Size() != size_){
+        throw std::invalid_argument("The vector is incorrect for the update");
+    }
+    for(size_t i = 0; i < size_; ++i){
+        SimdAxpy(data_.data() + Offset(i), alpha * vec[i], vec.Data(), i + 1);
+    }
+}
+
+template <typename T>
+void SymmetricMatrix<T>::MultiplyVector(const T* x, T* y) const{
+    std::fill(y, y + size_, T());
+    simd_detail::Dispatch<T, symmetric_detail::PackedSymv>(data_.data(), size_, x, y);
+}
+
+template <typename T>
+Matrix<T> SymmetricMatrix<T>::ToDense() const{
+    Matrix<T> res(size_, size_, T());
+    for(size_t i = 0; i < size_; ++i){
+        for(size_t j = 0; j <= i; ++j){
+            res[i][j] = res[j][i] = data_[Offset(i) + j];
+        }
+    }
+    return res;
+}
+
+template <typename T>
+size_t SymmetricMatrix<T>::Offset(size_t row) noexcept{
+    return row * (row + 1) / 2;
+}
+
+
+namespace symmetric_detail{
+
+// G += A * A^T for an n x k operand A. Each block row of G is one general product
+// against the rows of A up to the diagonal, so only the lower triangle (plus the
+// upper halves of the diagonal blocks) is ever computed.
+template <typename T>
+void GramBlockRow(size_t ib, size_t n, size_t k, GemmOperand<T> a, SymmetricMatrix<T>& res,
+    std::vector<T, AlignedAllocator<T>>& block){
+    constexpr size_t BLOCK = 64;
+    const size_t mb = std::min(BLOCK, n - ib);
+    const size_t cols = ib + mb;
+    block.assign(mb * cols, T());
+    Gemm<T>(mb, cols, k, {&a(ib, 0), a.row_stride, a.col_stride},
+        {a.data, a.col_stride, a.row_stride}, block.data(), cols);
+    for(size_t r = 0; r < mb; ++r){
+        SimdAdd(res[ib + r].data(), block.data() + r * cols, ib + r + 1);
+    }
+}
+
+// res += A * A^T for a res.SizeRow() x k operand A, so the slabs of a tall matrix accumulate
+// into one packed matrix. With enough block rows every thread builds whole block rows, taken in
+// turn so that the long bottom rows do not end up on one thread; otherwise each block row product
+// is split.
+template <typename T>
+void AddGram(size_t k, GemmOperand<T> a, SymmetricMatrix<T>& res){
+    constexpr size_t BLOCK = 64;
+    const size_t n = res.SizeRow();
+    const size_t blocks = (n + BLOCK - 1) / BLOCK;
+    if(blocks < 2 * NumThreads()){
+        std::vector<T, AlignedAllocator<T>> block(res.GetAllocator());
+        block.reserve(std::min(BLOCK, n) * n);
+        for(size_t b = 0; b < blocks; ++b){
+            GramBlockRow(b * BLOCK, n, k, a, res, block);
+        }
+        return;
+    }
+    SharedThreadPool().ParallelFor(blocks, [&](size_t b){
+        // Outlives the call, so it never takes memory from a caller's resource
+        thread_local std::vector<T, AlignedAllocator<T>> block{AlignedAllocator<T>(AlignedMemoryResource())};
+        GramBlockRow((blocks - 1 - b) * BLOCK, n, k, a, res, block);
+    });
+}
+
+template <typename T>
+SymmetricMatrix<T> Gram(size_t n, size_t k, GemmOperand<T> a, const AlignedAllocator<T>& alloc){
+    SymmetricMatrix<T> res(n, T(), alloc);
+    AddGram(k, a, res);
+    return res;
+}
+
+// Rows [begin, end) of res = lhs * sym. Each packed row is loaded once for all these rows
+// instead of once per row as with repeated MultiplyVector calls.
+template <typename T>
+void MultiplyRows(const Matrix<T>& lhs, const SymmetricMatrix<T>& sym, size_t begin, size_t end, Matrix<T>& res){
+    for(size_t i = 0; i < sym.SizeRow(); ++i){
+        const T* row = sym[i].data();
+        for(size_t r = begin; r < end; ++r){
+            const T* x = lhs[r].data();
+            T* y = res[r].data();
+            y[i] += SimdDot(row, x, i + 1);
+            SimdAxpy(y, x[i], row, i);
+        }
+    }
+}
+
+} // namespace symmetric_detail
+
+template <typename T>
+SymmetricMatrix<T> GramColumns(const Matrix<T>& mat, const AlignedAllocator<T>& alloc){
+    if(mat.SizeRow() == 0){
+        throw std::invalid_argument("The matrix is empty for multiplication");
+    }
+    return symmetric_detail::Gram<T>(mat.SizeRow(), mat.SizeColumn(), {mat.Data(), 1, mat.Stride()}, alloc);
+}
+
+template <typename T>
+SymmetricMatrix<T> GramRows(const Matrix<T>& mat, const AlignedAllocator<T>& alloc){
+    if(mat.SizeRow() == 0){
+        throw std::invalid_argument("The matrix is empty for multiplication");
+    }
+    return symmetric_detail::Gram<T>(mat.SizeColumn(), mat.SizeRow(), {mat.Data(), mat.Stride(), 1}, alloc);
+}
+
+template <typename T>
+Matrix<T> operator*(const SymmetricMatrix<T>& lhs, const Matrix<T>& rhs){
+    if((lhs.SizeRow() != rhs.SizeColumn()) || (rhs.SizeRow() == 0) || (lhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    Matrix<T> res(lhs.SizeColumn(), rhs.SizeRow(), T());
+    if((rhs.SizeRow() == 1) && (rhs.Stride() == 1)){
+        lhs.MultiplyVector(rhs.Data(), res.Data());
+        return res;
+    }
+    std::vector<T, AlignedAllocator<T>> x(rhs.SizeColumn()), y(rhs.SizeColumn());
+    for(size_t j = 0; j < rhs.SizeRow(); ++j){
+        for(size_t i = 0; i < rhs.SizeColumn(); ++i){
+            x[i] = rhs.Data()[i * rhs.Stride() + j];
+        }
+        lhs.MultiplyVector(x.data(), y.data());
+        for(size_t i = 0; i < res.SizeColumn(); ++i){
+            res[i][j] = y[i];
+        }
+    }
+    return res;
+}
+
+template <typename T>
+Matrix<T> operator*(const Matrix<T>& lhs, const SymmetricMatrix<T>& rhs){
+    if((lhs.SizeRow() != rhs.SizeColumn()) || (lhs.SizeColumn() == 0) || (rhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    Matrix<T> res(lhs.SizeColumn(), rhs.SizeRow(), T());
+    const size_t packed = rhs.SizeRow() * (rhs.SizeRow() + 1) / 2;
+    ParallelChunks(lhs.SizeColumn(), std::max<size_t>(PARALLEL_GRAIN / packed, 1), [&](size_t begin, size_t end){
+        symmetric_detail::MultiplyRows(lhs, rhs, begin, end, res);
+    });
+    return res;
+}
+
+template <typename T>
+void Multiply(const SymmetricMatrix<T>& lhs, const Vector<T>& rhs, Vector<T>& res){
+    if((lhs.SizeRow() != rhs.Size()) || (lhs.SizeRow() == 0)){
+        throw std::invalid_argument("The matrices are incorrect for multiplication");
+    }
+    res.Resize(lhs.SizeColumn());
+    lhs.MultiplyVector(rhs.Data(), res.Data());
+}
+
+template <typename T>
+Vector<T> operator*(const SymmetricMatrix<T>& lhs, const Vector<T>& rhs){
+    Vector<T> res;
+    Multiply(lhs, rhs, res);
+    return res;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <vector>
+#include <istream>
+#include <ios>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <string>
+
+// Parses the whitespace separated numbers of [begin, end) with std::from_chars and appends them
+// to res. Spaces, tabs and '\r' separate the numbers, anything else that is not a number throws.
+template <typename T>
+void ParceNumbers(const char* begin, const char* end, std::vector<T>& res);
+
+// Line oriented reader of numbers over large blocks of a stream. Every block is parsed in place,
+// a number split between two blocks is moved to the front before the next read, so apart from
+// the growth of the result vectors nothing is allocated per value or per line. A stream that can
+// not seek is read only up to the end of the current line, so Finish() never has to give bytes back.
+class TextReader{
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = size_t(1) << 20;
+
+    explicit TextReader(std::istream& input, const size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    // Replaces the contents of res with the numbers of the next line. A line ends at '\n' or at
+    // the end of the input, false when the input was already exhausted.
+    template <typename T>
+    bool ReadLine(std::vector<T>& res);
+    // The next line as text, without its '\n' and a trailing '\r'
+    bool ReadLine(std::string& res);
+
+    // Seeks the stream back over the bytes read past the last line, so it continues right after it
+    void Finish();
+
+private:
+    // Keeps [begin_, end_) and appends the next block, false at the end of the input
+    bool Fill();
+
+    std::istream& input_;
+    bool seekable_;
+    std::vector<char> buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+namespace text_detail{
+
+inline bool IsSeparator(char c) noexcept{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+// One number from a token with no separators in it
+template <typename T>
+T ParceNumber(const char* begin, const char* end);
+
+} // namespace text_detail
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+namespace text_detail{
+
+template <typename T>
+T ParceNumber(const char* begin, const char* end){
+    T value{};
+    // from_chars takes no leading '+', streams did
+    if((end - begin > 1) && (*begin == '+')){
+        ++begin;
+    }
+    const auto [ptr, ec] = std::from_chars(begin, end, value);
+    if((ec != std::errc()) || (ptr != end)){
+        throw std::invalid_argument("The number is incorrect: " + std::string(begin, end));
+    }
+    return value;
+}
+
+} // namespace text_detail
+
+template <typename T>
+void ParceNumbers(const char* begin, const char* end, std::vector<T>& res){
+    while(begin != end){
+        if(text_detail::IsSeparator(*begin)){
+            ++begin;
+            continue;
+        }
+        const char* token_end = std::find_if(begin, end, text_detail::IsSeparator);
+        res.push_back(text_detail::ParceNumber<T>(begin, token_end));
+        begin = token_end;
+    }
+}
+
+inline TextReader::TextReader(std::istream& input, const size_t block_size)
+    : input_(input)
+    , seekable_(input.tellg() != std::streampos(-1))
+    , buffer_(std::max<size_t>(block_size, 64)){}
+
+inline bool TextReader::Fill(){
+    if(!input_){
+        return false;
+    }
+    // A token longer than a block grows the buffer instead of being split
+    if(begin_ == 0 && end_ == buffer_.size()){
+        buffer_.resize(2 * buffer_.size());
+    }
+    std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    if(seekable_){
+        input_.read(buffer_.data() + end_, std::streamsize(buffer_.size() - end_));
+        const size_t count = size_t(input_.gcount());
+        end_ += count;
+        return count;
+    }
+    std::streambuf* const buf = input_.rdbuf();
+    size_t count = 0;
+    while(end_ + count < buffer_.size()){
+        const int c = buf->sbumpc();
+        if(c == std::char_traits<char>::eof()){
+            input_.setstate(std::ios::eofbit | std::ios::failbit);
+            break;
+        }
+        buffer_[end_ + count++] = char(c);
+        if(c == '\n'){
+            break;
+        }
+    }
+    end_ += count;
+    return count;
+}
+
+inline void TextReader::Finish(){
+    if(begin_ == end_){
+        return;
+    }
+    const std::streamoff unread = std::streamoff(end_ - begin_);
+    begin_ = end_;
+    if(seekable_){
+        input_.clear();
+        input_.seekg(-unread, std::ios::cur);
+    }
+}
+
+template <typename T>
+bool TextReader::ReadLine(std::vector<T>& res){
+    res.clear();
+    if((begin_ == end_) && !Fill()){
+        return false;
+    }
+    while(true){
+        const char* data = buffer_.data();
+        const char* line_end = static_cast<const char*>(std::memchr(data + begin_, '\n', end_ - begin_));
+        if(line_end){
+            ParceNumbers(data + begin_, line_end, res);
+            begin_ = size_t(line_end - data) + 1;
+            return true;
+        }
+        // No end of line in the block: parse up to the last separator, the rest may continue
+        size_t last = end_;
+        while((last > begin_) && !text_detail::IsSeparator(data[last - 1])){
+            --last;
+        }
+        ParceNumbers(data + begin_, data + last, res);
+        begin_ = last;
+        if(!Fill()){
+            ParceNumbers(buffer_.data() + begin_, buffer_.data() + end_, res);
+            begin_ = end_;
+            return true;
+        }
+    }
+}
+
+inline bool TextReader::ReadLine(std::string& res){
+    res.clear();
+    if((begin_ == end_) && !Fill()){
+        return false;
+    }
+    while(true){
+        const char* data = buffer_.data();
+        const char* line_end = static_cast<const char*>(std::memchr(data + begin_, '\n', end_ - begin_));
+        if(line_end){
+            res.append(data + begin_, line_end);
+            begin_ = size_t(line_end - data) + 1;
+            break;
+        }
+        res.append(data + begin_, data + end_);
+        begin_ = end_;
+        if(!Fill()){
+            break;
+        }
+    }
+    if(!res.empty() && (res.back() == '\r')){
+        res.pop_back();
+    }
+    return true;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+// Fixed set of worker threads that run one parallel loop at a time. The calling thread
+// takes part in the loop, so a pool of N threads keeps N - 1 workers.
+// Every index of a loop is run exactly once; work is only ever split by output, never
+// by a reduction, so results do not depend on which thread runs which index.
+class ThreadPool final{
+public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t NumThreads() const noexcept;
+
+    // Runs func(i) for every i in [0, count). Indices are handed out one at a time.
+    // A loop started from inside another loop runs on the calling thread. func must not throw.
+    template <typename Func>
+    void ParallelFor(size_t count, Func&& func);
+
+private:
+    void WorkerLoop();
+    void RunTasks() noexcept;
+    static bool& InsideLoop() noexcept;
+
+    std::vector<std::thread> workers_;
+    std::mutex submit_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    size_t generation_ = 0;
+    size_t active_ = 0;
+    bool stop_ = false;
+
+    void (*invoke_)(void*, size_t) = nullptr;
+    void* context_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_ = 0;
+};
+
+// The pool shared by all kernels. It starts with SVD_NUM_THREADS threads if the variable is set,
+// otherwise with one per hardware thread.
+inline ThreadPool& SharedThreadPool();
+// Replaces the shared pool, must not be called while parallel work is running.
+inline void SetNumThreads(size_t num_threads);
+inline size_t NumThreads();
+
+// Splits [0, size) into at most one chunk per thread, each of at least grain elements,
+// and runs func(begin, end) on every chunk.
+template <typename Func>
+void ParallelChunks(size_t size, size_t grain, Func&& func);
+
+
+/*---------------------------------------------------------------------------------*/
+
+
+inline ThreadPool::ThreadPool(size_t num_threads){
+    for(size_t i = 1; i < num_threads; ++i){
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for(std::thread& worker : workers_){
+        worker.join();
+    }
+}
+
+inline size_t ThreadPool::NumThreads() const noexcept{
+    return workers_.size() + 1;
+}
+
+template <typename Func>
+void ThreadPool::ParallelFor(size_t count, Func&& func){
+    if(workers_.empty() || (count <= 1) || InsideLoop()){
+        for(size_t i = 0; i < count; ++i){
+            func(i);
+        }
+        return;
+    }
+    std::lock_guard submit_lock(submit_mutex_);
+    {
+        std::lock_guard lock(mutex_);
+        invoke_ = [](void* context, size_t index){
+            (*static_cast<std::remove_reference_t<Func>*>(context))(index);
+        };
+        context_ = &func;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        active_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+    InsideLoop() = true;
+    RunTasks();
+    InsideLoop() = false;
+    // Every worker checks in for each loop, so the job is never replaced under a late worker
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this]{return active_ == 0;});
+}
+
+inline void ThreadPool::WorkerLoop(){
+    InsideLoop() = true;
+    size_t seen = 0;
+    std::unique_lock lock(mutex_);
+    while(true){
+        wake_.wait(lock, [this, seen]{return stop_ || (generation_ != seen);});
+        if(stop_){
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+        RunTasks();
+        lock.lock();
+        if(--active_ == 0){
+            done_.notify_one();
+        }
+    }
+}
+
+inline void ThreadPool::RunTasks() noexcept{
+    for(size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)){
+        invoke_(context_, i);
+    }
+}
+
+inline bool& ThreadPool::InsideLoop() noexcept{
+    thread_local bool inside = false;
+    return inside;
+}
+
+
+namespace thread_pool_detail{
+
+inline size_t DefaultNumThreads(){
+    if(const char* env = std::getenv("SVD_NUM_THREADS")){
+        const long num = std::atol(env);
+        if(num > 0){
+            return static_cast<size_t>(num);
+        }
+    }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+inline std::unique_ptr<ThreadPool>& Shared(){
+    static std::unique_ptr<ThreadPool> pool = std::make_unique<ThreadPool>(DefaultNumThreads());
+    return pool;
+}
+
+} // namespace thread_pool_detail
+
+inline ThreadPool& SharedThreadPool(){
+    return *thread_pool_detail::Shared();
+}
+
+inline void SetNumThreads(size_t num_threads){
+    auto& pool = thread_pool_detail::Shared();
+    if(pool->NumThreads() != std::max<size_t>(num_threads, 1)){
+        pool.reset();
+        pool = std::make_unique<ThreadPool>(std::max<size_t>(num_threads, 1));
+    }
+}
+
+inline size_t NumThreads(){
+    return SharedThreadPool().NumThreads();
+}
+
+template <typename Func>
+void ParallelChunks(size_t size, size_t grain, Func&& func){
+    ThreadPool& pool = SharedThreadPool();
+    const size_t chunks = std::min(pool.NumThreads(), std::max<size_t>(size / std::max<size_t>(grain, 1), 1));
+    if(chunks <= 1){
+        func(size_t(0), size);
+        return;
+    }
+    pool.ParallelFor(chunks, [&](size_t i){
+        func(size * i / chunks, size * (i + 1) / chunks);
+    });
+}
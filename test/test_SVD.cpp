@@ -3,15 +3,108 @@
 #include "assert.h"
 #include "matrix.h"
 #include "svd.h"
+#include "jacobi_svd.h"
+#include "golub_kahan_svd.h"
+#include "randomized_svd.h"
+#include "orthonormalize.h"
+#include "subspace_svd.h"
+#include "lanczos_svd.h"
+#include "incremental_svd.h"
+#include "streaming_svd.h"
+#include "mixed_svd.h"
+#include "sparse_matrix.h"
+#include "linear_operator.h"
+#include "thread_pool.h"
 
 #include <chrono>
 #include <random>
 #include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <memory_resource>
+#include <stdexcept>
+
+// Every allocation of the test binary goes through these, so a test can count them. All array and
+// aligned forms are replaced too, so no pointer from malloc reaches the library's delete, and none
+// is inlined, so the compiler does not pair malloc with delete or new with free.
+static std::atomic<size_t> allocation_count = 0;
+
+[[gnu::noinline]] void* operator new(size_t size){
+    ++allocation_count;
+    if(void* ptr = std::malloc(size ? size : 1)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t align){
+    ++allocation_count;
+    const size_t alignment = static_cast<size_t>(align);
+    if(void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment + alignment * !size)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](size_t size){
+    return operator new(size);
+}
+
+[[gnu::noinline]] void* operator new[](size_t size, std::align_val_t align){
+    return operator new(size, align);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr, std::align_val_t) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr, size_t, std::align_val_t) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete[](void* ptr) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete[](void* ptr, size_t) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete[](void* ptr, std::align_val_t) noexcept{
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete[](void* ptr, size_t, std::align_val_t) noexcept{
+    std::free(ptr);
+}
 
 int main/*TestSVD*/(){
     const float ERROR_RATE = 5e-2;
 
     TestSVD(ERROR_RATE);
+    TestPowerIterationAllocations(ERROR_RATE);
+    TestDeflatedMatrix();
+    TestJacobiSVD();
+    TestGolubKahanSVD();
+    TestOrthonormalizeRows();
+    TestRandomizedSVD();
+    TestSubspaceSVD();
+    TestLanczosSVD();
+    TestWarmStartSVD();
+    TestIncrementalSVD();
+    TestStreamingSVD();
+    TestMixedSVD();
+    TestLinearOperatorSVD();
 }
 
 void TestSVD(const float error_rate){
@@ -41,4 +134,870 @@ void TestSVD(const float error_rate){
         }
     }
 }
+}
+
+void TestPowerIterationAllocations(const float error_rate){
+{
+    Matrix<float> m({
+        {57.69, 69.80, 59.83, 23.46, 42.81},
+        {49.72, 15.01, 46.06, 18.61, 68.30},
+        {81.41, 83.09, 22.49, 61.73, 19.47},
+        {96.27, 53.69, 18.59, 77.11, 30.69},
+        {49.84, 73.97, 15.68, 69.09, 43.63}});
+    SymmetricMatrix<float> gram = GramColumns(m);
+    PowerIterationWorkspace<float> workspace;
+    const float eigenval = CalculateMaxEigenval(gram, 1e-3f, workspace);
+    Matrix<float> dense = gram.ToDense();
+    // The assertion macros allocate their strings, so only the iterations are counted
+    const size_t before = allocation_count;
+    const float packed_eigenval = CalculateMaxEigenval(gram, 1e-3f, workspace);
+    const float dense_eigenval = CalculateMaxEigenval(dense, 1e-3f, workspace);
+    const size_t allocations = allocation_count - before;
+    ASSERT_EQUAL(allocations, 0u);
+    ASSERT_EQUAL(packed_eigenval, eigenval);
+    ASSERT(std::abs(dense_eigenval - eigenval) < error_rate * eigenval);
+    ASSERT(std::abs(CalculateMaxEigenval(dense, 1e-3f).first - eigenval) < error_rate * eigenval);
+}
+}
+
+void TestDeflatedMatrix(){
+{
+    Matrix<double> a({{1, 2, 0}, {0, 1, 3}, {4, 0, 1}, {2, 2, 2}});
+    SymmetricMatrix<double> gram = GramColumns(a);
+    SymmetricMatrix<double> updated = gram;
+    DeflatedMatrix<double, SymmetricMatrix<double>> deflated(gram, 2);
+    const Vector<double> v1 = Normalize(Vector<double>({1, 1, 0}));
+    const Vector<double> v2 = Normalize(Vector<double>({0, 1, -1}));
+    deflated.Deflate(3, v1);
+    deflated.Deflate(0.5, v2);
+    updated.RankOneUpdate(-3, v1);
+    updated.RankOneUpdate(-0.5, v2);
+    ASSERT_EQUAL(deflated.Count(), 2u);
+    const Vector<double> x({0.3, -1, 2});
+    Vector<double> y(3), expected(3);
+    Multiply(updated, x, expected);
+    // The product only works in the given output
+    const size_t before = allocation_count;
+    Multiply(deflated, x, y);
+    const size_t allocations = allocation_count - before;
+    ASSERT_EQUAL(allocations, 0u);
+    for(size_t i = 0; i < 3; ++i){
+        ASSERT(std::abs(y[i] - expected[i]) < 1e-12);
+    }
+    bool thrown = false;
+    try{
+        deflated.Deflate(1, x);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+// Largest elementwise deviation of a from u * s * v^T and of u^T * u and v^T * v from the identity
+template <typename T>
+T JacobiError(const Matrix<T>& a, const SVD<T>& res){
+    T error = 0;
+    Matrix<T> check = res.left_singular_vectors * res.eigenvalues * Transposed(res.right_singular_vectors);
+    for(size_t i = 0; i < a.SizeColumn(); ++i){
+        for(size_t j = 0; j < a.SizeRow(); ++j){
+            error = std::max(error, std::abs(a[i][j] - check[i][j]));
+        }
+    }
+    for(const Matrix<T>* vectors : {&res.left_singular_vectors, &res.right_singular_vectors}){
+        Matrix<T> gram = Transposed(*vectors) * *vectors;
+        for(size_t i = 0; i < gram.SizeColumn(); ++i){
+            for(size_t j = 0; j < gram.SizeRow(); ++j){
+                error = std::max(error, std::abs(gram[i][j] - T(i == j)));
+            }
+        }
+    }
+    return error;
+}
+
+void TestJacobiSVD(){
+{
+    Matrix<float> m({
+        {57.69, 69.80, 59.83, 23.46, 42.81},
+        {49.72, 15.01, 46.06, 18.61, 68.30},
+        {81.41, 83.09, 22.49, 61.73, 19.47},
+        {96.27, 53.69, 18.59, 77.11, 30.69},
+        {49.84, 73.97, 15.68, 69.09, 43.63}});
+    SVD<float> res = CalculateJacobiSVD<float>(m, 5, 1e-7);
+    ASSERT(JacobiError(m, res) < 1e-3);
+    SVD<float> power = CalculateSVD<float>(m, 2, 1e-6);
+    for(size_t i = 0; i < 2; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - power.eigenvalues[i][i]) < 1e-3 * res.eigenvalues[0][0]);
+    }
+    for(size_t i = 1; i < 5; ++i){
+        ASSERT(res.eigenvalues[i - 1][i - 1] >= res.eigenvalues[i][i]);
+    }
+}
+{
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    for(auto [rows, columns] : {std::pair<size_t, size_t>{40, 13}, {9, 31}, {1, 4}, {17, 17}}){
+        Matrix<double> m(rows, columns, 0);
+        for(size_t i = 0; i < rows; ++i){
+            for(size_t j = 0; j < columns; ++j){
+                m[i][j] = dist(generator);
+            }
+        }
+        const size_t count = std::min(rows, columns);
+        SVD<double> res = CalculateJacobiSVD<double>(m, count, 1e-15);
+        ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), rows);
+        ASSERT_EQUAL(res.left_singular_vectors.SizeRow(), count);
+        ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), columns);
+        ASSERT_EQUAL(res.right_singular_vectors.SizeRow(), count);
+        ASSERT(JacobiError(m, res) < 1e-12);
+
+        const size_t initial = NumThreads();
+        SetNumThreads(1);
+        SVD<double> serial = CalculateJacobiSVD<double>(m, count, 1e-15);
+        SetNumThreads(3);
+        SVD<double> parallel = CalculateJacobiSVD<double>(m, count, 1e-15);
+        SetNumThreads(initial);
+        ASSERT(serial.eigenvalues == parallel.eigenvalues);
+        ASSERT(serial.left_singular_vectors == parallel.left_singular_vectors);
+
+        SVD<double> truncated = CalculateJacobiSVD<double>(m, 1, 1e-15);
+        ASSERT_EQUAL(truncated.eigenvalues.SizeRow(), size_t(1));
+        ASSERT_EQUAL(truncated.eigenvalues[0][0], res.eigenvalues[0][0]);
+    }
+}
+{
+    // Q * diag(sigma) with a Householder reflection Q: the Gram matrix would square the
+    // condition number to 1e24 and lose the small values, the rotations keep them
+    const std::vector<double> sigma = {1, 1e-4, 1e-8, 1e-12};
+    const std::vector<double> w = {0.5, -0.5, 0.5, 0.5};
+    Matrix<double> m(4, 4, 0);
+    for(size_t i = 0; i < 4; ++i){
+        for(size_t j = 0; j < 4; ++j){
+            m[i][j] = ((i == j) - 2 * w[i] * w[j]) * sigma[j];
+        }
+    }
+    SVD<double> res = CalculateJacobiSVD<double>(m, 4, 1e-15);
+    for(size_t i = 0; i < 4; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-12 * sigma[i]);
+    }
+}
+{
+    Matrix<double> m({{1, 2}, {3, 4}, {5, 6}});
+    bool thrown = false;
+    try{
+        CalculateJacobiSVD<double>(m, 3, 1e-10);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+{
+    // A NaN inner product never counts as orthogonal, the sweep limit is reported instead of NaN values
+    Matrix<double> m({{1, 2}, {3, std::nan("")}, {5, 6}});
+    bool thrown = false;
+    try{
+        CalculateJacobiSVD<double>(m, 2, 1e-15);
+    }
+    catch(const std::runtime_error&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+void TestGolubKahanSVD(){
+{
+    Matrix<float> m({
+        {57.69, 69.80, 59.83, 23.46, 42.81},
+        {49.72, 15.01, 46.06, 18.61, 68.30},
+        {81.41, 83.09, 22.49, 61.73, 19.47},
+        {96.27, 53.69, 18.59, 77.11, 30.69},
+        {49.84, 73.97, 15.68, 69.09, 43.63}});
+    SVD<float> res = CalculateGolubKahanSVD<float>(m, 5, 1e-7);
+    ASSERT(JacobiError(m, res) < 1e-3);
+    SVD<float> jacobi = CalculateJacobiSVD<float>(m, 5, 1e-7);
+    for(size_t i = 0; i < 5; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - jacobi.eigenvalues[i][i]) < 1e-5 * res.eigenvalues[0][0]);
+    }
+}
+{
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    for(auto [rows, columns] : {std::pair<size_t, size_t>{60, 25}, {12, 40}, {1, 5}, {6, 1}, {30, 30}}){
+        Matrix<double> m(rows, columns, 0);
+        for(size_t i = 0; i < rows; ++i){
+            for(size_t j = 0; j < columns; ++j){
+                m[i][j] = dist(generator);
+            }
+        }
+        const size_t count = std::min(rows, columns);
+        SVD<double> res = CalculateGolubKahanSVD<double>(m, count, 1e-15);
+        ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), rows);
+        ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), columns);
+        ASSERT(JacobiError(m, res) < 1e-12);
+        SVD<double> jacobi = CalculateJacobiSVD<double>(m, count, 1e-15);
+        for(size_t i = 0; i < count; ++i){
+            ASSERT(std::abs(res.eigenvalues[i][i] - jacobi.eigenvalues[i][i]) < 1e-12);
+        }
+    }
+}
+{
+    // Clustered and repeated singular values, where deflated power iteration stalls
+    const std::vector<double> sigma = {3, 2, 2, 2, 1 + 1e-9, 1, 0, 0};
+    const std::vector<double> w = {0.5, -0.5, 0.5, 0.5};
+    Matrix<double> m(8, 8, 0);
+    for(size_t i = 0; i < 8; ++i){
+        for(size_t j = 0; j < 8; ++j){
+            const double q = (i == j) - ((i < 4 && j < 4) ? 2 * w[i] * w[j] : 0);
+            m[i][(j + 3) % 8] = q * sigma[j];
+        }
+    }
+    SVD<double> res = CalculateGolubKahanSVD<double>(m, 8, 1e-15);
+    ASSERT(JacobiError(m, res) < 1e-12);
+    for(size_t i = 0; i < 8; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-12);
+    }
+}
+{
+    Matrix<double> zero(4, 3, 0);
+    SVD<double> res = CalculateGolubKahanSVD<double>(zero, 3, 1e-15);
+    ASSERT(JacobiError(zero, res) < 1e-15);
+    ASSERT_EQUAL(res.eigenvalues[0][0], 0);
+}{
+    // A NaN never lets the superdiagonal vanish, the sweep limit is reported instead of a wrong result
+    Matrix<double> m({{1, 2}, {3, std::nan("")}, {5, 6}});
+    bool thrown = false;
+    try{
+        CalculateGolubKahanSVD<double>(m, 2, 1e-15);
+    }
+    catch(const std::runtime_error&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+// rows x columns matrix with singular values sigma and random singular vectors
+Matrix<double> MatrixWithSpectrum(size_t rows, size_t columns, const std::vector<double>& sigma, unsigned seed){
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> normal;
+    Matrix<double> left(sigma.size(), rows, 0), right(sigma.size(), columns, 0);
+    for(Matrix<double>* factor : {&left, &right}){
+        for(size_t i = 0; i < factor->SizeColumn(); ++i){
+            for(double& val : (*factor)[i]){
+                val = normal(generator);
+            }
+        }
+        OrthonormalizeRows(*factor);
+    }
+    for(size_t i = 0; i < sigma.size(); ++i){
+        SimdScale(left[i].data(), sigma[i], rows);
+    }
+    return Transposed(left) * right;
+}
+
+void TestOrthonormalizeRows(){
+{
+    // Rows spanning a 3-dimensional space with norms spread over eight orders of magnitude
+    Matrix<double> m({
+        {1, 2, 3, 4, 5, 6},
+        {1e-4, 0, 1e-4, 0, 1e-4, 0},
+        {2, 4, 6, 8, 10, 12},
+        {0, 1e-8, 0, 0, 0, 1e-8},
+        {1, 1, 1, 1, 1, 1}});
+    const size_t rank = OrthonormalizeRows(m);
+    ASSERT_EQUAL(rank, 4u);
+    Matrix<double> gram = m * Transposed(m);
+    for(size_t i = 0; i < 5; ++i){
+        for(size_t j = 0; j < 5; ++j){
+            const double expected = ((i == j) && (i != 2)) ? 1 : 0;
+            ASSERT(std::abs(gram[i][j] - expected) < 1e-12);
+        }
+    }
+}
+}
+
+void TestRandomizedSVD(){
+{
+    // Exact rank 5: one sketch already holds the whole range
+    const std::vector<double> sigma = {50, 20, 10, 5, 1};
+    Matrix<double> m = MatrixWithSpectrum(300, 80, sigma, 1);
+    SVD<double> res = CalculateRandomizedSVD<double>(m, 5, 5, 0, 7);
+    ASSERT(JacobiError(m, res) < 1e-10);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-10);
+    }
+}
+{
+    // Slowly decaying spectrum, the power passes recover the leading values
+    std::vector<double> sigma(60);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = 1.0 / (1.0 + i);
+    }
+    Matrix<double> m = MatrixWithSpectrum(400, 120, sigma, 2);
+    SVD<double> res = CalculateRandomizedSVD<double>(m, 8, 10, 3, 11);
+    ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), size_t(400));
+    ASSERT_EQUAL(res.left_singular_vectors.SizeRow(), size_t(8));
+    ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), size_t(120));
+    for(size_t i = 0; i < 8; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-3 * sigma[0]);
+    }
+    SVD<double> same = CalculateRandomizedSVD<double>(m, 8, 10, 3, 11);
+    ASSERT(same.eigenvalues == res.eigenvalues);
+    ASSERT(same.right_singular_vectors == res.right_singular_vectors);
+
+    SVD<double> wide = CalculateRandomizedSVD<double>(Transp(m), 8, 10, 3, 11);
+    for(size_t i = 0; i < 8; ++i){
+        ASSERT(std::abs(wide.eigenvalues[i][i] - sigma[i]) < 1e-3 * sigma[0]);
+    }
+}
+{
+    Matrix<double> m({{1, 2}, {3, 4}, {5, 6}});
+    bool thrown = false;
+    try{
+        CalculateRandomizedSVD<double>(m, 3);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+void TestSubspaceSVD(){
+{
+    Matrix<float> m({
+        {57.69, 69.80, 59.83, 23.46, 42.81},
+        {49.72, 15.01, 46.06, 18.61, 68.30},
+        {81.41, 83.09, 22.49, 61.73, 19.47},
+        {96.27, 53.69, 18.59, 77.11, 30.69},
+        {49.84, 73.97, 15.68, 69.09, 43.63}});
+    SVD<float> res = CalculateSubspaceSVD<float>(m, 5, 1e-6);
+    ASSERT(JacobiError(m, res) < 1e-3);
+    SVD<float> exact = CalculateGolubKahanSVD<float>(m, 5, 1e-7);
+    for(size_t i = 0; i < 5; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - exact.eigenvalues[i][i]) < 1e-4 * exact.eigenvalues[0][0]);
+    }
+}
+{
+    std::vector<double> sigma(50);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = std::pow(0.8, double(i));
+    }
+    // A repeated pair, which deflated power iteration cannot separate quickly
+    sigma[3] = sigma[2];
+    Matrix<double> m = MatrixWithSpectrum(300, 90, sigma, 4);
+    SVD<double> res = CalculateSubspaceSVD<double>(m, 10, 1e-12);
+    ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), size_t(300));
+    ASSERT_EQUAL(res.left_singular_vectors.SizeRow(), size_t(10));
+    ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), size_t(90));
+    for(size_t i = 0; i < 10; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-8);
+    }
+    Matrix<double> residual = m * res.right_singular_vectors - res.left_singular_vectors * res.eigenvalues;
+    for(size_t i = 0; i < residual.SizeColumn(); ++i){
+        for(double val : residual[i]){
+            ASSERT(std::abs(val) < 1e-6);
+        }
+    }
+}
+{
+    Matrix<double> m({{1, 2}, {3, 4}, {5, 6}});
+    bool thrown = false;
+    try{
+        CalculateSubspaceSVD<double>(m, 3, 1e-6);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+void TestLanczosSVD(){
+{
+    Matrix<float> m({
+        {57.69, 69.80, 59.83, 23.46, 42.81},
+        {49.72, 15.01, 46.06, 18.61, 68.30},
+        {81.41, 83.09, 22.49, 61.73, 19.47},
+        {96.27, 53.69, 18.59, 77.11, 30.69},
+        {49.84, 73.97, 15.68, 69.09, 43.63}});
+    SVD<float> res = CalculateLanczosSVD<float>(m, 3, 1e-6);
+    SVD<float> exact = CalculateGolubKahanSVD<float>(m, 3, 1e-7);
+    for(size_t i = 0; i < 3; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - exact.eigenvalues[i][i]) < 1e-4 * exact.eigenvalues[0][0]);
+    }
+}
+{
+    // Slow decay with a repeated pair needs several thick restarts, on a tall and on a wide matrix
+    std::vector<double> sigma(200);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = 1 / (1 + 0.05 * double(i));
+    }
+    sigma[5] = sigma[4];
+    Matrix<double> tall = MatrixWithSpectrum(600, 200, sigma, 5);
+    for(const Matrix<double>& m : {tall, Transp(tall)}){
+        SVD<double> res = CalculateLanczosSVD<double>(m, 8, 1e-10);
+        ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), m.SizeColumn());
+        ASSERT_EQUAL(res.left_singular_vectors.SizeRow(), size_t(8));
+        ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), m.SizeRow());
+        ASSERT_EQUAL(res.right_singular_vectors.SizeRow(), size_t(8));
+        for(size_t i = 0; i < 8; ++i){
+            ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-8);
+        }
+        Matrix<double> residual = m * res.right_singular_vectors - res.left_singular_vectors * res.eigenvalues;
+        for(size_t i = 0; i < residual.SizeColumn(); ++i){
+            for(double val : residual[i]){
+                ASSERT(std::abs(val) < 1e-8);
+            }
+        }
+        // Selective reorthogonalization keeps the basis orthogonal to about sqrt(eps)
+        Matrix<double> gram = Transposed(res.right_singular_vectors) * res.right_singular_vectors;
+        for(size_t i = 0; i < 8; ++i){
+            for(size_t j = 0; j < 8; ++j){
+                ASSERT(std::abs(gram[i][j] - (i == j ? 1.0 : 0.0)) < 1e-7);
+            }
+        }
+    }
+}
+{
+    // Rank deficient: the recurrence breaks down before the basis is full
+    Matrix<double> m({{1, 2, 3}, {2, 4, 6}, {1, 0, 1}, {0, 0, 0}});
+    SVD<double> res = CalculateLanczosSVD<double>(m, 3, 1e-12);
+    SVD<double> exact = CalculateGolubKahanSVD<double>(m, 3, 1e-15);
+    for(size_t i = 0; i < 3; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - exact.eigenvalues[i][i]) < 1e-10);
+    }
+}
+{
+    Matrix<double> m({{1, 2}, {3, 4}, {5, 6}});
+    bool thrown = false;
+    try{
+        CalculateLanczosSVD<double>(m, 3, 1e-6);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+void TestWarmStartSVD(){
+{
+    std::vector<double> sigma(40);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = std::pow(0.7, double(i));
+    }
+    const Matrix<double> before = MatrixWithSpectrum(200, 40, sigma, 6);
+    // The drifted matrix: a small relative perturbation of the previous one
+    Matrix<double> after = before;
+    std::mt19937 generator(7);
+    std::normal_distribution<double> normal;
+    for(size_t i = 0; i < after.SizeColumn(); ++i){
+        for(double& val : after[i]){
+            val += 1e-5 * normal(generator);
+        }
+    }
+    const SVD<double> previous = CalculateSVD<double>(before, 5, 1e-10);
+    std::vector<size_t> cold_iterations;
+    WarmStartReport report;
+    const SVD<double> cold = CalculateSVD<double>(after, 5, 1e-10, &cold_iterations);
+    const SVD<double> warm = CalculateSVD<double>(after, 5, 1e-10, previous, &report);
+    const std::vector<size_t>& warm_iterations = report.iterations;
+    ASSERT_EQUAL(warm_iterations.size(), 5u);
+    ASSERT_EQUAL(report.cold_iterations.size(), 5u);
+    size_t cold_total = 0, warm_total = 0, estimated_total = 0;
+    for(size_t i = 0; i < 5; ++i){
+        ASSERT(std::abs(warm.eigenvalues[i][i] - cold.eigenvalues[i][i]) < 1e-8);
+        ASSERT(warm_iterations[i] <= cold_iterations[i]);
+        ASSERT(warm_iterations[i] >= 1);
+        cold_total += cold_iterations[i];
+        warm_total += warm_iterations[i];
+        estimated_total += report.cold_iterations[i];
+    }
+    // The first product of every value only measures the residual of its start
+    ASSERT(2 * (warm_total - 5) < cold_total - 5);
+    // The estimated cold start is close to the measured one, without running it
+    ASSERT(std::abs(double(estimated_total) - double(cold_total)) < 0.25 * cold_total);
+    ASSERT_EQUAL(report.Saved(), estimated_total - warm_total);
+
+    // A previous factorization of another shape, or with fewer vectors, falls back to cold starts
+    const SVD<double> other = CalculateSVD<double>(Transp(before), 3, 1e-10);
+    WarmStartReport fallback;
+    CalculateSVD<double>(after, 5, 1e-10, other, &fallback);
+    ASSERT(fallback.iterations == cold_iterations);
+    ASSERT(fallback.cold_iterations == cold_iterations);
+    ASSERT_EQUAL(fallback.Saved(), 0u);
+    const SVD<double> shorter = CalculateSVD<double>(before, 2, 1e-10);
+    CalculateSVD<double>(after, 5, 1e-10, shorter, &fallback);
+    ASSERT(fallback.iterations[0] <= cold_iterations[0]);
+    ASSERT_EQUAL(fallback.iterations.size(), 5u);
+    for(size_t i = 2; i < 5; ++i){
+        ASSERT_EQUAL(fallback.cold_iterations[i], fallback.iterations[i]);
+    }
+}
+}
+
+void TestIncrementalSVD(){
+{
+    // Rows of an exactly rank 6 matrix arrive in batches, rank 8 loses nothing and zero values are not kept
+    std::vector<double> sigma = {9, 7, 5, 3, 2, 1};
+    const Matrix<double> m = MatrixWithSpectrum(300, 40, sigma, 8);
+    IncrementalSVD<double> inc(8, 40);
+    for(size_t begin = 0; begin < 300; begin += 25){
+        Matrix<double> batch(0);
+        for(size_t i = begin; i < begin + 25; ++i){
+            batch.PushBackRow(std::vector<double>(m[i].begin(), m[i].end()));
+        }
+        inc.Update(batch);
+    }
+    ASSERT_EQUAL(inc.SizeColumn(), size_t(300));
+    ASSERT_EQUAL(inc.Rank(), size_t(6));
+    ASSERT(inc.TruncationError() < 1e-10);
+    SVD<double> res = inc.Result();
+    ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), size_t(300));
+    ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), size_t(40));
+    for(size_t i = 0; i < sigma.size(); ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-10);
+    }
+    Matrix<double> check = res.left_singular_vectors * res.eigenvalues * Transposed(res.right_singular_vectors);
+    for(size_t i = 0; i < 300; ++i){
+        for(size_t j = 0; j < 40; ++j){
+            ASSERT(std::abs(check[i][j] - m[i][j]) < 1e-10);
+        }
+    }
+    Matrix<double> gram = Transposed(res.left_singular_vectors) * res.left_singular_vectors;
+    for(size_t i = 0; i < 6; ++i){
+        for(size_t j = 0; j < 6; ++j){
+            ASSERT(std::abs(gram[i][j] - (i == j ? 1.0 : 0.0)) < 1e-10);
+        }
+    }
+}
+{
+    // Truncation below the rank, starting from a factorization of the first rows
+    std::vector<double> sigma(30);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = std::pow(0.5, double(i));
+    }
+    const Matrix<double> m = MatrixWithSpectrum(200, 30, sigma, 9);
+    Matrix<double> first(0), rest(0);
+    for(size_t i = 0; i < 200; ++i){
+        (i < 50 ? first : rest).PushBackRow(std::vector<double>(m[i].begin(), m[i].end()));
+    }
+    IncrementalSVD<double> inc(CalculateGolubKahanSVD<double>(first, 30, 1e-15), 10);
+    inc.Update(rest);
+    SVD<double> res = inc.Result();
+    SVD<double> exact = CalculateGolubKahanSVD<double>(m, 10, 1e-15);
+    double distance = 0;
+    Matrix<double> diff = m - res.left_singular_vectors * res.eigenvalues * Transposed(res.right_singular_vectors);
+    for(size_t i = 0; i < diff.SizeColumn(); ++i){
+        for(double val : diff[i]){
+            distance += val * val;
+        }
+    }
+    distance = std::sqrt(distance);
+    ASSERT(std::abs(distance - inc.TruncationError()) < 1e-2 * distance);
+    for(size_t i = 0; i < 10; ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - exact.eigenvalues[i][i]) < 1e-3 * sigma[0]);
+    }
+}
+{
+    IncrementalSVD<double> inc(2, 3);
+    bool thrown = false;
+    try{
+        inc.Update(Matrix<double>({{1, 2}}));
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+// Default resource from construction to Stop(), which returns the largest number of bytes that
+// were live at once. Buffers allocated meanwhile go back through it, so it has to outlive them.
+class PeakResource final : public std::pmr::memory_resource{
+public:
+    PeakResource()
+        : previous_(SetDefaultMemoryResource(this)){}
+    ~PeakResource() override{
+        Stop();
+    }
+
+    size_t Stop() noexcept{
+        if(DefaultMemoryResource() == this){
+            SetDefaultMemoryResource(previous_);
+        }
+        return peak_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override{
+        const size_t live = (live_ += bytes);
+        size_t peak = peak_;
+        while((live > peak) && !peak_.compare_exchange_weak(peak, live)){}
+        return previous_->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override{
+        live_ -= bytes;
+        previous_->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override{
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* previous_;
+    std::atomic<size_t> live_ = 0;
+    std::atomic<size_t> peak_ = 0;
+};
+
+void TestStreamingSVD(){
+{
+    std::vector<double> sigma(30);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = std::pow(0.8, double(i));
+    }
+    const Matrix<double> m = MatrixWithSpectrum(2000, 30, sigma, 10);
+    size_t position = 0;
+    CallbackRowSource<double> source(30, [&m, &position](double* row){
+        if(position == m.SizeColumn()){
+            return false;
+        }
+        std::copy(m[position].begin(), m[position].end(), row);
+        ++position;
+        return true;
+    }, [&position]{
+        position = 0;
+    });
+    // Room for blocks of about 60 rows, so the reduction tree gets several levels
+    const size_t budget = ((streaming_detail::MAX_LEVELS + 3) * 30 * 30 + 60 * (2 * 30 + streaming_detail::PANEL))
+        * sizeof(double);
+    ASSERT_EQUAL(streaming_detail::BlockRows<double>(30, 0, budget), size_t(60));
+    ASSERT_EQUAL(streaming_detail::BlockRows<double>(30, 30, budget), size_t(45));
+    Matrix<double> left(m.SizeColumn(), 30, 0.0);
+    size_t left_rows = 0;
+    CallbackRowSink<double> sink([&left, &left_rows](const double* row){
+        std::copy(row, row + 30, left[left_rows++].data());
+    });
+    // U goes to the sink block by block, so nothing but the blocks and the factors is allocated
+    PeakResource resource;
+    SVD<double> res = CalculateStreamingSVD<double>(source, 30, budget, sink);
+    const size_t peak = resource.Stop();
+    ASSERT(peak <= budget);
+    ASSERT_EQUAL(left_rows, m.SizeColumn());
+    ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), size_t(0));
+    res.left_singular_vectors = std::move(left);
+    ASSERT(JacobiError(m, res) < 1e-10);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        ASSERT(std::abs(res.eigenvalues[i][i] - sigma[i]) < 1e-12);
+    }
+
+    source.Rewind();
+    SVD<double> values_only = CalculateStreamingSVD<double>(source, 5, budget);
+    ASSERT_EQUAL(values_only.left_singular_vectors.SizeColumn(), size_t(0));
+    ASSERT_EQUAL(values_only.right_singular_vectors.SizeColumn(), size_t(30));
+    for(size_t i = 0; i < 5; ++i){
+        ASSERT(std::abs(values_only.eigenvalues[i][i] - sigma[i]) < 1e-12);
+    }
+
+    // The same rows as raw binary values
+    std::stringstream file(std::ios::in | std::ios::out | std::ios::binary);
+    for(size_t i = 0; i < m.SizeColumn(); ++i){
+        file.write(reinterpret_cast<const char*>(m[i].data()), std::streamsize(30 * sizeof(double)));
+    }
+    BinaryRowSource<double> binary(file, 30);
+    std::stringstream left_file(std::ios::in | std::ios::out | std::ios::binary);
+    BinaryRowSink<double> binary_sink(left_file);
+    SVD<double> from_file = CalculateStreamingSVD<double>(binary, 3, budget, binary_sink);
+    ASSERT_EQUAL(left_file.str().size(), 2000 * 3 * sizeof(double));
+    BinaryRowSource<double> left_source(left_file, 3);
+    Matrix<double> from_file_left(2000, 3, 0.0);
+    ASSERT_EQUAL(left_source.Read(from_file_left), size_t(2000));
+    std::stringstream truncated(file.str().substr(0, 2 * 30 * sizeof(double) + 5));
+    BinaryRowSource<double> truncated_source(truncated, 30);
+    Matrix<double> block(10, 30, 0.0);
+    bool truncated_thrown = false;
+    try{
+        truncated_source.Read(block);
+    }
+    catch(const std::invalid_argument&){
+        truncated_thrown = true;
+    }
+    ASSERT(truncated_thrown);
+    for(size_t i = 0; i < 3; ++i){
+        ASSERT(std::abs(from_file.eigenvalues[i][i] - sigma[i]) < 1e-12);
+        for(size_t j = 0; j < 2000; ++j){
+            ASSERT(std::abs(std::abs(from_file_left[j][i]) - std::abs(res.left_singular_vectors[j][i])) < 1e-10);
+        }
+    }
+
+    bool thrown = false;
+    try{
+        CalculateStreamingSVD<double>(source, 3, 1000);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+void TestMixedSVD(){
+{
+    std::vector<double> sigma(30);
+    for(size_t i = 0; i < sigma.size(); ++i){
+        sigma[i] = std::pow(0.8, double(i));
+    }
+    const Matrix<double> source = MatrixWithSpectrum(1000, 30, sigma, 11);
+    // The stored float matrix and its exact double copy, the reference decomposition
+    Matrix<float> m(1000, 30, 0);
+    Matrix<double> exact(1000, 30, 0);
+    for(size_t i = 0; i < 1000; ++i){
+        std::copy(source[i].begin(), source[i].end(), m[i].begin());
+        std::copy(m[i].begin(), m[i].end(), exact[i].begin());
+    }
+    const SVD<double> reference = CalculateGolubKahanSVD(exact, 30, std::numeric_limits<double>::epsilon());
+
+    SVD<double> full = CalculateMixedSVD(m, 30, 1e-12);
+    ASSERT(JacobiError(exact, full) < 1e-12);
+
+    // Truncated: the residuals and values reach double accuracy, far below the float rounding
+    for(size_t steps : {0, 1, 2}){
+        SVD<double> res = CalculateMixedSVD(m, 5, 1e-12, steps);
+        ASSERT_EQUAL(res.left_singular_vectors.SizeColumn(), size_t(1000));
+        ASSERT_EQUAL(res.right_singular_vectors.SizeColumn(), size_t(30));
+        const Matrix<double> image = exact * res.right_singular_vectors;
+        for(size_t i = 0; i < 5; ++i){
+            ASSERT(std::abs(res.eigenvalues[i][i] - reference.eigenvalues[i][i]) < 1e-12);
+            double residual = 0;
+            for(size_t j = 0; j < 1000; ++j){
+                const double diff = image[j][i] - res.eigenvalues[i][i] * res.left_singular_vectors[j][i];
+                residual += diff * diff;
+            }
+            ASSERT(std::sqrt(residual) < 1e-10);
+        }
+    }
+
+    bool thrown = false;
+    try{
+        CalculateMixedSVD(m, 31, 1e-12);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+}
+
+void TestLinearOperatorSVD(){
+{
+    // Products of the adapters and views against their dense equivalents
+    std::mt19937 generator(12);
+    std::uniform_real_distribution<double> uniform(-1, 1);
+    Matrix<double> dense(40, 25, 0.0), factor(25, 10, 0.0);
+    for(Matrix<double>* mat : {&dense, &factor}){
+        for(size_t i = 0; i < mat->SizeColumn(); ++i){
+            for(double& val : (*mat)[i]){
+                val = (uniform(generator) > 0.5) ? uniform(generator) : 0.0;
+            }
+        }
+    }
+    const SparseMatrix<double> sparse(dense);
+    Vector<double> scale(25);
+    for(size_t j = 0; j < 25; ++j){
+        scale[j] = 1.0 + double(j);
+    }
+    Matrix<double> scaled = dense, centered = dense;
+    for(size_t i = 0; i < 40; ++i){
+        for(size_t j = 0; j < 25; ++j){
+            scaled[i][j] *= scale[j];
+        }
+    }
+    for(size_t j = 0; j < 25; ++j){
+        double mean = 0;
+        for(size_t i = 0; i < 40; ++i){
+            mean += dense[i][j] / 40;
+        }
+        for(size_t i = 0; i < 40; ++i){
+            centered[i][j] -= mean;
+        }
+    }
+    const Matrix<double> product = dense * factor;
+
+    auto check = [&generator, &uniform](const auto& op, const Matrix<double>& expected){
+        ASSERT_EQUAL(op.SizeColumn(), expected.SizeColumn());
+        ASSERT_EQUAL(op.SizeRow(), expected.SizeRow());
+        Vector<double> x(op.SizeRow()), y(op.SizeColumn()), z(op.SizeColumn()), w(op.SizeRow());
+        for(double& val : x){
+            val = uniform(generator);
+        }
+        for(double& val : z){
+            val = uniform(generator);
+        }
+        op.Apply(x.Data(), y.Data());
+        op.ApplyTransposed(z.Data(), w.Data());
+        const Vector<double> expected_y = expected * x, expected_w = Transposed(expected) * z;
+        for(size_t i = 0; i < y.Size(); ++i){
+            ASSERT(std::abs(y[i] - expected_y[i]) < 1e-12);
+        }
+        for(size_t i = 0; i < w.Size(); ++i){
+            ASSERT(std::abs(w[i] - expected_w[i]) < 1e-12);
+        }
+    };
+    check(DenseOperator<double>(dense), dense);
+    check(SparseOperator<double>(sparse), dense);
+    check(ScaledOperator(SparseOperator<double>(sparse), scale), scaled);
+    check(CenteredOperator(SparseOperator<double>(sparse)), centered);
+    check(ProductOperator(DenseOperator<double>(dense), DenseOperator<double>(factor)), product);
+
+    // The power iteration and Lanczos run on the operators without densifying them
+    const CenteredOperator centered_op{SparseOperator<double>(sparse)};
+    const SVD<double> reference = CalculateGolubKahanSVD(centered, 5, 1e-15);
+    const SVD<double> power = CalculateSVD(centered_op, 5, 1e-12);
+    const SVD<double> lanczos = CalculateLanczosSVD(centered_op, 5, 1e-12);
+    for(size_t i = 0; i < 5; ++i){
+        ASSERT(std::abs(power.eigenvalues[i][i] - reference.eigenvalues[i][i]) < 1e-9);
+        ASSERT(std::abs(lanczos.eigenvalues[i][i] - reference.eigenvalues[i][i]) < 1e-9);
+    }
+    const Matrix<double> power_check = Transposed(power.left_singular_vectors) * centered * power.right_singular_vectors;
+    for(size_t i = 0; i < 5; ++i){
+        ASSERT(std::abs(power_check[i][i] - reference.eigenvalues[i][i]) < 1e-9);
+    }
+    const SVD<double> warm = CalculateSVD(centered_op, 5, 1e-12, power);
+    ASSERT(std::abs(warm.eigenvalues[0][0] - reference.eigenvalues[0][0]) < 1e-9);
+
+    const NormalOperator normal{SparseOperator<double>(sparse)};
+    const SVD<double> dense_power = CalculateSVD<double>(dense, 1, 1e-12);
+    ASSERT(std::abs(std::sqrt(CalculateMaxEigenval(normal, 1e-12).first) - dense_power.eigenvalues[0][0]) < 1e-9);
+
+    bool thrown = false;
+    try{
+        CalculateSVD(SparseOperator<double>(sparse), 26, 1e-6);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    // The dense matrix and its operator take the same numbers of vectors
+    const Matrix<double> square({{1, 2, 3}, {4, 5, 6}, {7, 8, 10}});
+    for(size_t num_vec : {size_t(0), size_t(4)}){
+        bool dense_thrown = false, operator_thrown = false;
+        try{
+            CalculateSVD<double>(square, num_vec, 1e-6);
+        }
+        catch(const std::invalid_argument&){
+            dense_thrown = true;
+        }
+        try{
+            CalculateSVD(DenseOperator<double>(square), num_vec, 1e-6);
+        }
+        catch(const std::invalid_argument&){
+            operator_thrown = true;
+        }
+        ASSERT(dense_thrown && operator_thrown);
+    }
+}
 }
\ No newline at end of file
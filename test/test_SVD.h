@@ -2,4 +2,17 @@
 
 int main/*TestSVD*/();
 
-void TestSVD(const float error_rate);
\ No newline at end of file
+void TestSVD(const float error_rate);
+void TestPowerIterationAllocations(const float error_rate);
+void TestDeflatedMatrix();
+void TestJacobiSVD();
+void TestGolubKahanSVD();
+void TestOrthonormalizeRows();
+void TestRandomizedSVD();
+void TestSubspaceSVD();
+void TestLanczosSVD();
+void TestWarmStartSVD();
+void TestIncrementalSVD();
+void TestStreamingSVD();
+void TestMixedSVD();
+void TestLinearOperatorSVD();
\ No newline at end of file
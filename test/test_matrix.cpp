@@ -1,6 +1,17 @@
 #include "test_matrix.h"
 #include "assert.h"
 #include "matrix.h"
+#include "symmetric_matrix.h"
+#include "sparse_matrix.h"
+#include "text_reader.h"
+#include "binary_matrix.h"
+#include "npy.h"
+#include "matrix_market.h"
+#include "golub_kahan_svd.h"
+#include "dense_vector.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "allocator.h"
 
 #include <vector>
 #include <sstream>
@@ -9,6 +20,13 @@
 #include <chrono>
 #include <stdexcept>
 #include <cmath>
+#include <tuple>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 
 
 int main/*TestMatrix*/(){
@@ -30,9 +48,23 @@ int main/*TestMatrix*/(){
 
     TestTransp();
 
+    TestSymmetricMatrix();
+    TestVector();
+
     TestNormalize(ERROR_RATE);
 
+    TestSimdLevels(ERROR_RATE);
+
+    TestThreadPool();
+
+    TestMemoryResources();
+
     TestParceCSRFormat();
+    TestSparseMatrix();
+    TestTextReader();
+    TestBinaryMatrix();
+    TestNpy();
+    TestMatrixMarket();
 
     return 0;
 }
@@ -459,12 +491,173 @@ void TestTransp(){
     Matrix<int> m({{1, 2}, {3, 4}}), res({{1, 3}, {2, 4}});
     ASSERT_EQUAL(Transp(m), res);
 }
+{
+    Matrix<int> m(75, 131, 0);
+    for(size_t i = 0; i < m.SizeColumn(); ++i){
+        for(size_t j = 0; j < m.SizeRow(); ++j){
+            m[i][j] = static_cast<int>(i * 1000 + j);
+        }
+    }
+    Matrix<int> res = Transp(m);
+    ASSERT_EQUAL(res.SizeColumn(), m.SizeRow());
+    ASSERT_EQUAL(res.SizeRow(), m.SizeColumn());
+    bool equal = true;
+    for(size_t i = 0; i < m.SizeColumn(); ++i){
+        for(size_t j = 0; j < m.SizeRow(); ++j){
+            equal = equal && (res[j][i] == m[i][j]);
+        }
+    }
+    ASSERT(equal);
+    ASSERT_EQUAL(Matrix<int>(Transposed(m)), res);
+}
+{
+    Matrix<int> a({{1, 2, 3}, {4, 5, 6}}), b({{1, 0}, {2, 1}}), c({{1, 2, 3}, {0, 1, 2}});
+    ASSERT_EQUAL(Transposed(a) * b, Transp(a) * b);
+    ASSERT_EQUAL(a * Transposed(c), a * Transp(c));
+    ASSERT_EQUAL(Transposed(a) * Transposed(b), Transp(a) * Transp(b));
+    Matrix<int> u({{1}, {2}});
+    ASSERT_EQUAL(Transposed(a) * u, Matrix<int>({{9}, {12}, {15}}));
+    ASSERT_EQUAL(u * Transposed(u), Matrix<int>({{1, 2}, {2, 4}}));
+    ASSERT_EQUAL(Transposed(u) * u, Matrix<int>({{5}}));
+}
+{
+    Matrix<double> a(90, 70, 0), b(90, 50, 0);
+    for(size_t i = 0; i < 90; ++i){
+        for(size_t j = 0; j < 70; ++j){
+            a[i][j] = static_cast<double>((i * 7 + j * 3) % 11) - 5;
+        }
+        for(size_t j = 0; j < 50; ++j){
+            b[i][j] = static_cast<double>((i * 5 + j) % 13) - 6;
+        }
+    }
+    ASSERT_EQUAL(Transposed(a) * b, Transp(a) * b);
+    ASSERT_EQUAL(Transposed(b) * a, Transp(b) * a);
+    Matrix<double> b_transp = Transp(b);
+    ASSERT_EQUAL(Transposed(a) * Transposed(b_transp), Transp(a) * b);
+}
+{
+    bool is_throw = false;
+    Matrix<int> a({{1, 2, 3}, {4, 5, 6}});
+    try{
+        Transposed(a) * Transposed(a);
+    }
+    catch(const std::invalid_argument& e){
+        is_throw = true;
+    }
+    ASSERT(is_throw);
+}
+}
+
+void TestSymmetricMatrix(){
+{
+    SymmetricMatrix<int> m(3);
+    m(0, 0) = 1;
+    m(1, 0) = 2;
+    m(1, 1) = 3;
+    m(0, 2) = 4;
+    m(2, 1) = 5;
+    m(2, 2) = 6;
+    ASSERT_EQUAL(m.ToDense(), Matrix<int>({{1, 2, 4}, {2, 3, 5}, {4, 5, 6}}));
+    ASSERT_EQUAL(m[2].size(), 3u);
+    ASSERT_EQUAL(m[2][1], 5);
+    ASSERT_EQUAL(m * Matrix<int>({{1}, {2}, {3}}), Matrix<int>({{17}, {23}, {32}}));
+    ASSERT_EQUAL(m * Matrix<int>({{1, 0}, {2, 1}, {3, 0}}), Matrix<int>({{17, 2}, {23, 3}, {32, 5}}));
+    m.RankOneUpdate(2, Matrix<int>({{1}, {0}, {1}}));
+    ASSERT_EQUAL(m.ToDense(), Matrix<int>({{3, 2, 6}, {2, 3, 5}, {6, 5, 8}}));
+}
+{
+    Matrix<int> a({{1, 2}, {3, 4}, {5, 6}});
+    ASSERT_EQUAL(GramColumns(a).ToDense(), Transp(a) * a);
+    ASSERT_EQUAL(GramRows(a).ToDense(), a * Transp(a));
+}
+{
+    Matrix<double> a(150, 97, 0);
+    for(size_t i = 0; i < a.SizeColumn(); ++i){
+        for(size_t j = 0; j < a.SizeRow(); ++j){
+            a[i][j] = static_cast<double>((i * 7 + j * 3) % 11) - 5;
+        }
+    }
+    ASSERT_EQUAL(GramColumns(a).ToDense(), Transposed(a) * a);
+    ASSERT_EQUAL(GramRows(a).ToDense(), a * Transposed(a));
+}
+{
+    bool is_throw = false;
+    SymmetricMatrix<int> m(2);
+    try{
+        m * Matrix<int>({{1}, {2}, {3}});
+    }
+    catch(const std::invalid_argument& e){
+        is_throw = true;
+    }
+    ASSERT(is_throw);
+}
+}
+
+void TestVector(){
+{
+    Vector<int> v({1, 2, 3}), w(3, 1);
+    ASSERT_EQUAL(v.Size(), 3u);
+    ASSERT_EQUAL(v + w, Vector<int>({2, 3, 4}));
+    ASSERT_EQUAL(v - w, Vector<int>({0, 1, 2}));
+    ASSERT_EQUAL(v * 2, Vector<int>({2, 4, 6}));
+    ASSERT_EQUAL(2 * v, Vector<int>({2, 4, 6}));
+    ASSERT_EQUAL(v.ToMatrix(), Matrix<int>({{1}, {2}, {3}}));
+    ASSERT_EQUAL(Vector<int>(Matrix<int>({{1}, {2}, {3}})), v);
+}
+{
+    Vector<double> v({3, 4});
+    ASSERT_EQUAL(Norma(v), 5.0);
+    Vector<double> u = Normalize(v);
+    ASSERT((std::abs(u[0] - 0.6) < 1e-12) && (std::abs(u[1] - 0.8) < 1e-12));
+}
+for(auto [m, n] : {std::pair<size_t, size_t>{67, 131}, {5, 3}, {130, 1}, {1, 37}, {9, 8}}){
+    Matrix<double> a(m, n, 0);
+    Vector<double> x(n), y(m);
+    for(size_t i = 0; i < m; ++i){
+        for(size_t j = 0; j < n; ++j){
+            a[i][j] = static_cast<double>((i * 7 + j * 3) % 11) - 5;
+        }
+        y[i] = static_cast<double>(i % 5) - 2;
+    }
+    for(size_t j = 0; j < n; ++j){
+        x[j] = static_cast<double>(j % 7) - 3;
+    }
+    ASSERT_EQUAL((a * x).ToMatrix(), a * x.ToMatrix());
+    ASSERT_EQUAL((Transposed(a) * y).ToMatrix(), Transp(a) * y.ToMatrix());
+    Matrix<int> a_int(m, n, 0);
+    Vector<int> x_int(n);
+    for(size_t i = 0; i < m; ++i){
+        for(size_t j = 0; j < n; ++j){
+            a_int[i][j] = static_cast<int>(a[i][j]);
+        }
+    }
+    for(size_t j = 0; j < n; ++j){
+        x_int[j] = static_cast<int>(x[j]);
+    }
+    ASSERT_EQUAL((a_int * x_int).ToMatrix(), a_int * x_int.ToMatrix());
+    SymmetricMatrix<double> g = GramColumns(a);
+    ASSERT_EQUAL((g * x).ToMatrix(), g.ToDense() * x.ToMatrix());
+    ASSERT_EQUAL(Transp(x.ToMatrix()) * g, Transp(x.ToMatrix()) * g.ToDense());
+    ASSERT_EQUAL(a * GramRows(Transp(a)), a * GramRows(Transp(a)).ToDense());
+}
+{
+    bool is_throw = false;
+    Matrix<int> a({{1, 2}, {3, 4}});
+    try{
+        a * Vector<int>({1, 2, 3});
+    }
+    catch(const std::invalid_argument& e){
+        is_throw = true;
+    }
+    ASSERT(is_throw);
+}
 }
 
 void TestAdding(){
     TestUnarySign();
     TestAddNum();
     TestAddMatrix();
+    TestExpressions();
 }
 
 void TestUnarySign(){
@@ -684,6 +877,54 @@ void TestAddMatrix(){
 }
 }
 
+void TestExpressions(){
+{
+    Matrix<int> a({{1, 2}, {3, 4}}), b({{2, 3}, {4, 5}}), c({{1, 1}, {1, 1}});
+    Matrix<int> res({{0, 1}, {2, 3}});
+    Matrix<int> m = a * 2 - b + c - 1 + 0 * (a + b);
+    ASSERT_EQUAL(m, res);
+    ASSERT_EQUAL(-(a - b) * 3, Matrix<int>({{3, 3}, {3, 3}}));
+}
+{
+    Matrix<int> m({{1, 2}, {3, 4}}), rhs({{2, 3}, {4, 5}});
+    const int* data = m.Data();
+    m = m + rhs - m * 2;
+    ASSERT_EQUAL(m, Matrix<int>({{1, 1}, {1, 1}}));
+    ASSERT(m.Data() == data);
+    m -= rhs + rhs;
+    ASSERT_EQUAL(m, Matrix<int>({{-3, -5}, {-7, -9}}));
+    m += -m;
+    ASSERT_EQUAL(m, Matrix<int>({{0, 0}, {0, 0}}));
+}
+{
+    Matrix<int> lhs({{1, 2}, {3}}), rhs({{2, 3}, {4, 5}});
+    ASSERT_EQUAL(lhs + rhs, Matrix<int>({{3, 5}, {7}}));
+    ASSERT_EQUAL(rhs - lhs * 2, Matrix<int>({{0, -1}, {-2, 5}}));
+    Matrix<int> m(lhs);
+    m -= rhs;
+    ASSERT_EQUAL(m, Matrix<int>({{-1, -1}, {-1}}));
+}
+{
+    Matrix<double> a({{1, 2}, {3, 4}}), b({{1, 0}, {0, 1}});
+    Matrix<double> m = a * b - b * 2.0;
+    ASSERT_EQUAL(m, Matrix<double>({{-1, 2}, {3, 2}}));
+    ASSERT_EQUAL(Norma(a * b - a), 0.0);
+    ASSERT_EQUAL(Norma(a - b, 1), std::sqrt(13.0));
+    ASSERT_EQUAL((a + b) * b, Matrix<double>({{2, 2}, {3, 5}}));
+}
+{
+    bool is_throw = false;
+    Matrix<int> lhs({{1}}), rhs({{1, 2}});
+    try{
+        lhs * 2 - (rhs + 1);
+    }
+    catch(const std::invalid_argument& e){
+        is_throw = true;
+    }
+    ASSERT(is_throw);
+}
+}
+
 void TestMultiplication(const float error_rate){
     TestMultNum(error_rate);
     TestMultMatrix();
@@ -830,6 +1071,36 @@ void TestMultMatrix(){
     ASSERT(is_throw);
     
 }
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution uniform_dist(-9, 9);
+    for(auto [m, k, n] : {std::tuple{67, 131, 45}, std::tuple{130, 300, 261}, std::tuple{7, 513, 3}}){
+        Matrix<double> lhs(m, k, 0), rhs(k, n, 0), res(m, n, 0);
+        Matrix<int> lhs_int(m, k, 0), rhs_int(k, n, 0), res_int(m, n, 0);
+        for(int i = 0; i < m; ++i){
+            for(int p = 0; p < k; ++p){
+                lhs_int[i][p] = uniform_dist(generator);
+                lhs[i][p] = lhs_int[i][p];
+            }
+        }
+        for(int p = 0; p < k; ++p){
+            for(int j = 0; j < n; ++j){
+                rhs_int[p][j] = uniform_dist(generator);
+                rhs[p][j] = rhs_int[p][j];
+            }
+        }
+        for(int i = 0; i < m; ++i){
+            for(int j = 0; j < n; ++j){
+                for(int p = 0; p < k; ++p){
+                    res_int[i][j] += lhs_int[i][p] * rhs_int[p][j];
+                }
+                res[i][j] = res_int[i][j];
+            }
+        }
+        ASSERT_EQUAL(lhs * rhs, res);
+        ASSERT_EQUAL(lhs_int * rhs_int, res_int);
+    }
+}
 }
 
 void TestNormalize(const float error_rate){
@@ -873,12 +1144,591 @@ void TestParceCSRFormat(){
     input << "0 3 5 8 9 11\n";
     input << "1 2 11 3 4 5 6 7 8 9 10";
     Matrix<int> res({{1, 2, 0, 11, 0}, {0, 3, 4, 0, 0}, {0, 5, 6, 7, 0}, {0, 0, 0, 8, 0}, {0, 0, 0, 9, 10}});
-    ASSERT_EQUAL(ParceCSRFormat<int>(input), res);
+    ASSERT_EQUAL(ParceCSRFormat<int>(input).ToDense(), res);
 }
 {
     std::stringstream input;
     input << "0 0\n";
     Matrix<int> res;
-    ASSERT_EQUAL(ParceCSRFormat<int>(input), res);
+    ASSERT_EQUAL(ParceCSRFormat<int>(input).ToDense(), res);
+}
+{
+    // Windows line ends and trailing blanks add no values
+    std::stringstream input;
+    input << "3 2 \r\n";
+    input << "0 2\t2 \r\n";
+    input << " 0 2 3\r\n";
+    input << "1.5 -2e1 +4 \r\n";
+    Matrix<double> res({{1.5, 0, -20}, {0, 0, 4}});
+    ASSERT_EQUAL(ParceCSRFormat<double>(input).ToDense(), res);
+}
+{
+    // Columns out of order are sorted, a repeated column keeps its last value
+    std::stringstream input;
+    input << "3 2\n2 0 1\n0 2 3\n5 6 7\n";
+    Matrix<int> res({{6, 0, 5}, {0, 7, 0}});
+    ASSERT_EQUAL(ParceCSRFormat<int>(input).ToDense(), res);
+    std::stringstream repeated;
+    repeated << "3 1\n2 0 2\n0 3\n1 2 3\n";
+    const SparseMatrix<int> sparse = ParceCSRFormat<int>(repeated);
+    ASSERT_EQUAL(sparse.NonZeros(), 2);
+    ASSERT_EQUAL(sparse.ToDense(), Matrix<int>({{2, 0, 3}}));
+}
+{
+    // Two matrices in one stream, also through a stream that can not seek like a pipe
+    struct UnseekableBuffer : std::stringbuf{
+        using std::stringbuf::stringbuf;
+        pos_type seekoff(off_type, std::ios::seekdir, std::ios::openmode) override{
+            return pos_type(off_type(-1));
+        }
+        pos_type seekpos(pos_type, std::ios::openmode) override{
+            return pos_type(off_type(-1));
+        }
+    };
+    const std::string text = "3 2\n0 2 2\n0 2 3\n1 2 4\n3 1\n1\n0 1\n9\n";
+    std::stringstream seekable(text);
+    UnseekableBuffer buffer(text);
+    std::istream unseekable(&buffer);
+    for(std::istream* input : {static_cast<std::istream*>(&seekable), &unseekable}){
+        ASSERT_EQUAL(ParceCSRFormat<int>(*input).ToDense(), Matrix<int>({{1, 0, 2}, {0, 0, 4}}));
+        ASSERT_EQUAL(ParceCSRFormat<int>(*input).ToDense(), Matrix<int>({{0, 9, 0}}));
+    }
+}
+{
+    std::stringstream input;
+    input << "3 2\n0 2 2\n0 2 3\n1 x 4\n";
+    bool thrown = false;
+    try{
+        ParceCSRFormat<int>(input);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+{
+    std::stringstream input;
+    input << "1 2 3 ";
+    ASSERT_EQUAL(ParceRowNumbers<int>(input), std::vector<int>({1, 2, 3}));
+}
+}
+
+void TestTextReader(){
+    // Lines longer than the block and numbers split between blocks
+    std::string text;
+    std::vector<std::vector<long>> lines(5);
+    for(size_t i = 0; i < lines.size(); ++i){
+        for(long j = 0; j < 100 * long(i); ++j){
+            lines[i].push_back(j * 1234567 - 50);
+            text += std::to_string(lines[i].back()) + ((j % 7) ? " " : "\t");
+        }
+        text += (i % 2) ? "\n" : "\r\n";
+    }
+    text += std::string(200, '9');
+    std::stringstream input(text);
+    TextReader reader(input, 64);
+    std::vector<long> line;
+    for(size_t i = 0; i < lines.size(); ++i){
+        ASSERT(reader.ReadLine(line));
+        ASSERT_EQUAL(line, lines[i]);
+    }
+    std::vector<double> last;
+    ASSERT(reader.ReadLine(last));
+    ASSERT_EQUAL(last.size(), 1);
+    ASSERT(std::abs(last[0] / 1e200 - 1.0) < 1e-12);
+    ASSERT(!reader.ReadLine(last));
+    ASSERT(last.empty());
+}
+
+void TestSparseMatrix(){
+{
+    Matrix<double> dense({{1, 0, 2, 0}, {0, 0, 0, 0}, {0, 3, 0, 4}});
+    SparseMatrix<double> sparse(dense);
+    ASSERT_EQUAL(sparse.SizeColumn(), 3);
+    ASSERT_EQUAL(sparse.SizeRow(), 4);
+    ASSERT_EQUAL(sparse.NonZeros(), 4);
+    ASSERT_EQUAL(sparse.RowOffsets(), std::vector<size_t>({0, 2, 2, 4}));
+    ASSERT_EQUAL(sparse.Columns(), std::vector<size_t>({0, 2, 1, 3}));
+    ASSERT_EQUAL(sparse.ToDense(), dense);
+    ASSERT_EQUAL(Transp(sparse).ToDense(), Transp(dense));
+    ASSERT(SparseMatrix<double>(3, 4, {0, 2, 2, 4}, {0, 2, 1, 3}, {1, 2, 3, 4}) == sparse);
+
+    Vector<double> x({1, 2, 3, 4});
+    ASSERT_EQUAL(sparse * x, Vector<double>({7, 0, 22}));
+    std::vector<double> y(4);
+    const double z[] = {1, 2, 3};
+    sparse.MultiplyTransposedVector(z, y.data());
+    ASSERT_EQUAL(y, std::vector<double>({1, 9, 2, 12}));
+
+    Matrix<double> rhs({{1, 2}, {3, 4}, {5, 6}, {7, 8}});
+    ASSERT_EQUAL(sparse * rhs, dense * rhs);
+    Matrix<double> left({{1, 2}, {3, 4}, {5, 6}});
+    ASSERT_EQUAL(MultiplyTransposed(sparse, left), Transp(dense) * left);
+    ASSERT_EQUAL(SparseMatrix<double>(2, 3).ToDense(), Matrix<double>(2, 3, 0.0));
+}
+{
+    // Large enough for the parallel row ranges
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<double> uniform(-1, 1);
+    Matrix<double> dense(2000, 300, 0.0);
+    for(size_t i = 0; i < dense.SizeColumn(); ++i){
+        for(size_t j = 0; j < dense.SizeRow(); ++j){
+            if(uniform(generator) > 0.8){
+                dense[i][j] = uniform(generator);
+            }
+        }
+    }
+    const SparseMatrix<double> sparse(dense);
+    ASSERT(sparse.NonZeros() > sparse_detail::PARALLEL_NON_ZEROS);
+    Matrix<double> rhs(300, 5, 0.0), left(2000, 5, 0.0);
+    for(Matrix<double>* mat : {&rhs, &left}){
+        for(size_t i = 0; i < mat->SizeColumn(); ++i){
+            for(double& val : (*mat)[i]){
+                val = uniform(generator);
+            }
+        }
+    }
+    const size_t initial = NumThreads();
+    SetNumThreads(3);
+    const Matrix<double> product = sparse * rhs, expected = dense * rhs;
+    SetNumThreads(initial);
+    const Matrix<double> transposed = MultiplyTransposed(sparse, left), transposed_expected = Transposed(dense) * left;
+    for(size_t i = 0; i < product.SizeColumn(); ++i){
+        for(size_t j = 0; j < 5; ++j){
+            ASSERT(std::abs(product[i][j] - expected[i][j]) < 1e-12);
+        }
+    }
+    for(size_t i = 0; i < transposed.SizeColumn(); ++i){
+        for(size_t j = 0; j < 5; ++j){
+            ASSERT(std::abs(transposed[i][j] - transposed_expected[i][j]) < 1e-12);
+        }
+    }
+}
+{
+    // Unsorted columns, an index out of range and inconsistent offsets
+    for(auto [offsets, columns] : std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>>{
+            {{0, 2}, {1, 0}}, {{0, 2}, {0, 3}}, {{0, 3}, {0, 1}}}){
+        bool thrown = false;
+        try{
+            SparseMatrix<double>(1, 3, offsets, columns, {1, 2});
+        }
+        catch(const std::invalid_argument&){
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+}
+}
+
+void TestBinaryMatrix(){
+    const std::string path = (std::filesystem::temp_directory_path() / "test_binary_matrix.svdb").string();
+{
+    Matrix<float> dense({{1, 2, 3}, {4, 5, 6}});
+    SparseMatrix<double> sparse(Matrix<double>({{0, 1.5, 0, 0}, {0, 0, 0, 0}, {2.5, 0, 0, -3}}));
+    const double column_major[] = {1, 2, 3, 4, 5, 6};
+    {
+        std::ofstream output(path, std::ios::binary);
+        BinaryWriter writer(output);
+        writer.Write(dense);
+        writer.Write(sparse);
+        writer.Write(MatrixView<double>(column_major, 3, 2, true));
+        writer.Write(Matrix<double>(0));
+    }
+    const BinaryFile file(path);
+    ASSERT_EQUAL(file.Count(), 4);
+    ASSERT(file.Type(0) == BinaryType::FLOAT32);
+    ASSERT(file.Layout(1) == BinaryLayout::CSR);
+    ASSERT(file.Layout(2) == BinaryLayout::COLUMN_MAJOR);
+
+    const MatrixView<float> dense_view = file.Dense<float>(0);
+    ASSERT_EQUAL(reinterpret_cast<uintptr_t>(dense_view.Data()) % MATRIX_ALIGNMENT, 0);
+    ASSERT_EQUAL(dense_view.ToMatrix(), dense);
+    ASSERT_EQUAL(dense_view(1, 2), 6);
+    const SparseView<double> sparse_view = file.Sparse<double>(1);
+    ASSERT_EQUAL(sparse_view.NonZeros(), 3);
+    ASSERT(sparse_view.ToSparse() == sparse);
+    const double x[] = {1, 2, 3, 4};
+    double y[3];
+    sparse_view.Apply(x, y);
+    ASSERT_EQUAL(y[2], -9.5);
+    const MatrixView<double> column_view = file.Dense<double>(2);
+    ASSERT_EQUAL(column_view.ToMatrix(), Matrix<double>({{1, 4}, {2, 5}, {3, 6}}));
+    const double z[] = {1, 1, 1};
+    double w[2];
+    column_view.ApplyTransposed(z, w);
+    ASSERT_EQUAL(w[0], 6);
+    ASSERT_EQUAL(w[1], 15);
+    ASSERT_EQUAL(file.Dense<double>(3).SizeColumn(), 0);
+
+    for(auto access : std::vector<std::function<void()>>{
+            [&file]{ file.Dense<double>(0); }, [&file]{ file.Dense<double>(1); },
+            [&file]{ file.Sparse<float>(0); }, [&file]{ file.Dense<float>(4); }}){
+        bool thrown = false;
+        try{
+            access();
+        }
+        catch(const std::invalid_argument&){
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+}
+{
+    // The SVD round trip, the mapped triplets are used as they are
+    Matrix<double> m({{3, 1, 0}, {1, 3, 1}, {0, 1, 3}, {1, 0, 1}});
+    const SVD<double> svd = CalculateGolubKahanSVD(m, 2, 1e-15);
+    SaveSVD(path, svd);
+    const SVD<double> loaded = LoadSVD<double>(path);
+    ASSERT_EQUAL(loaded.left_singular_vectors, svd.left_singular_vectors);
+    ASSERT_EQUAL(loaded.eigenvalues, svd.eigenvalues);
+    ASSERT_EQUAL(loaded.right_singular_vectors, svd.right_singular_vectors);
+    const BinaryFile file(path);
+    const SVDView<double> view = ViewSVD<double>(file);
+    ASSERT_EQUAL(view.singular_values.SizeRow(), 2);
+    ASSERT_EQUAL(view.singular_values(0, 1), svd.eigenvalues[1][1]);
+    ASSERT_EQUAL(view.right_singular_vectors(2, 1), svd.right_singular_vectors[2][1]);
+}
+{
+    std::ofstream(path, std::ios::binary) << std::string(64, 'x');
+    bool thrown = false;
+    try{
+        BinaryFile file(path);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+{
+    // Corrupt CSR arrays and sizes that overflow are rejected when the file is opened
+    const SparseMatrix<double> sparse(Matrix<double>({{0, 1.5, 0, 0}, {0, 0, 0, 0}, {2.5, 0, 0, -3}}));
+    const auto patched = [&path](const auto& mat, size_t offset, uint64_t value){
+        SaveBinary(path, mat);
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(std::streamoff(offset));
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    // Row offsets at 64, columns at 128 for the 3 x 4 matrix
+    const size_t header_rows = offsetof(binary_detail::Header, rows);
+    const size_t header_columns = offsetof(binary_detail::Header, columns);
+    for(auto patch : std::vector<std::function<void()>>{
+            [&]{ patched(sparse, 128, 4); }, [&]{ patched(sparse, 72, 3); }, [&]{ patched(sparse, 88, 2); },
+            [&]{ patched(Matrix<float>({{1, 2, 3}, {4, 5, 6}}), header_rows, uint64_t(1) << 62); },
+            [&]{ patched(Matrix<float>({{1, 2, 3}, {4, 5, 6}}), header_columns, ~uint64_t(0)); }}){
+        patch();
+        bool thrown = false;
+        try{
+            BinaryFile file(path);
+        }
+        catch(const std::invalid_argument&){
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    patched(sparse, 128, 3);
+    ASSERT_EQUAL(BinaryFile(path).Sparse<double>(0).Columns()[0], 3);
+}
+    std::filesystem::remove(path);
+}
+
+void TestNpy(){
+{
+    // Round trips in both orders keep the exact values
+    Matrix<double> m({{1, -2.5, 3}, {4, 5, 1e-300}});
+    for(bool fortran_order : {false, true}){
+        std::stringstream stream;
+        WriteNpy(stream, m, fortran_order);
+        const std::string bytes = stream.str();
+        ASSERT_EQUAL((bytes.size() - m.SizeColumn() * m.SizeRow() * sizeof(double)) % 64, 0);
+        ASSERT_EQUAL(ReadNpy<double>(stream), m);
+    }
+    std::stringstream stream;
+    WriteNpy(stream, Matrix<float>({{1, 2}, {3, 4}, {5, 6}}), true);
+    ASSERT_EQUAL(ReadNpy<double>(stream), Matrix<double>({{1, 2}, {3, 4}, {5, 6}}));
+}
+{
+    // Version 2 header, big endian float32 in Fortran order and a one dimensional array
+    const auto npy = [](char version, const std::string& dict, const std::string& data){
+        std::string res = std::string("\x93NUMPY", 6) + version + '\0';
+        res += char(dict.size() & 0xff);
+        res += char(dict.size() >> 8);
+        if(version != 1){
+            res += std::string(2, '\0');
+        }
+        return res + dict + data;
+    };
+    const std::string big_endian("\x3f\x80\x00\x00\x40\x00\x00\x00\x40\x40\x00\x00\x40\x80\x00\x00", 16);
+    std::stringstream fortran(npy(2, "{'descr': '>f4', 'fortran_order': True, 'shape': (2, 2), }\n", big_endian));
+    ASSERT_EQUAL(ReadNpy<double>(fortran), Matrix<double>({{1, 3}, {2, 4}}));
+    std::stringstream vector(npy(1, "{'descr': '>f4', 'fortran_order': False, 'shape': (4,), }\n", big_endian));
+    ASSERT_EQUAL(ReadNpy<float>(vector), Matrix<float>({{1, 2, 3, 4}}));
+
+    for(const std::string& bad : {npy(1, "{'descr': '<i4', 'fortran_order': False, 'shape': (1,), }\n", "abcd"),
+            npy(1, "{'descr': '>f4', 'fortran_order': False, 'shape': (2, 2), }\n", "abcd"),
+            npy(1, "{'descr': '>f4', 'fortran_order': False, 'shape': (1, 1, 1), }\n", "abcd"),
+            // Far more data than the stream holds, and shapes whose size overflows: rejected before allocating
+            npy(1, "{'descr': '<f8', 'fortran_order': False, 'shape': (1000000000, 1000000), }\n", "abcdabcd"),
+            npy(1, "{'descr': '<f8', 'fortran_order': False, 'shape': (4294967296, 4294967296), }\n", "abcd"),
+            npy(1, "{'descr': '<f8', 'fortran_order': False, 'shape': (99999999999999999999999,), }\n", "abcd"),
+            std::string("not an npy array")}){
+        std::stringstream stream(bad);
+        bool thrown = false;
+        try{
+            ReadNpy<double>(stream);
+        }
+        catch(const std::invalid_argument&){
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+}
+}
+
+void TestMatrixMarket(){
+{
+    // Entries out of order, a repeated entry, comments and a blank line
+    std::stringstream stream(
+        "%%MatrixMarket matrix coordinate real general\n"
+        "% comment\n"
+        "%\n"
+        "3 4 5\n"
+        "3 4 -3\n"
+        "1 2 1.5\n"
+        "\n"
+        "3 1 2.5\r\n"
+        "3 4 1\n"
+        "1 2 +1");
+    const SparseMatrix<double> res = ReadMatrixMarketSparse<double>(stream);
+    ASSERT_EQUAL(res.NonZeros(), 3);
+    ASSERT_EQUAL(res.ToDense(), Matrix<double>({{0, 2.5, 0, 0}, {0, 0, 0, 0}, {2.5, 0, 0, -2}}));
+}
+{
+    std::stringstream symmetric("%%MatrixMarket matrix coordinate pattern symmetric\n3 3 3\n1 1\n3 1\n3 2\n");
+    ASSERT_EQUAL(ReadMatrixMarketDense<float>(symmetric), Matrix<float>({{1, 0, 1}, {0, 0, 1}, {1, 1, 0}}));
+    std::stringstream skew("%%MatrixMarket matrix coordinate integer skew-symmetric\n2 2 1\n2 1 3\n");
+    ASSERT_EQUAL(ReadMatrixMarketSparse<double>(skew).ToDense(), Matrix<double>({{0, -3}, {3, 0}}));
+    std::stringstream array("%%MatrixMarket matrix array real general\n2 3\n1\n4\n2\n5\n3\n6\n");
+    ASSERT_EQUAL(ReadMatrixMarketDense<double>(array), Matrix<double>({{1, 2, 3}, {4, 5, 6}}));
+    std::stringstream lower("%%MatrixMarket matrix array real symmetric\n3 3\n1 2 3\n4 5\n6\n");
+    ASSERT(ReadMatrixMarketSparse<double>(lower) == SparseMatrix<double>(Matrix<double>({{1, 2, 3}, {2, 4, 5}, {3, 5, 6}})));
+}
+{
+    // The stream is left right after each matrix
+    std::stringstream stream("%%MatrixMarket matrix coordinate real general\n2 2 1\n2 1 5\n"
+        "%%MatrixMarket matrix array real general\n1 2\n3\n4\nrest");
+    ASSERT_EQUAL(ReadMatrixMarketDense<double>(stream), Matrix<double>({{0, 0}, {5, 0}}));
+    ASSERT_EQUAL(ReadMatrixMarketSparse<double>(stream).ToDense(), Matrix<double>({{3, 4}}));
+    std::string rest;
+    std::getline(stream, rest);
+    ASSERT_EQUAL(rest, std::string("rest"));
+}
+{
+    // Round trips of both formats keep the exact values
+    const Matrix<double> dense({{0, 1.0 / 3, 0}, {-2e-17, 0, 7}, {0, 0, 0}, {1e300, 0, -1}});
+    const SparseMatrix<double> sparse(dense);
+    std::stringstream coordinate, array;
+    WriteMatrixMarket(coordinate, sparse);
+    WriteMatrixMarket(array, dense);
+    ASSERT(ReadMatrixMarketSparse<double>(coordinate) == sparse);
+    ASSERT_EQUAL(ReadMatrixMarketDense<double>(array), dense);
+    std::stringstream empty;
+    WriteMatrixMarket(empty, SparseMatrix<float>(2, 3));
+    ASSERT(ReadMatrixMarketSparse<float>(empty) == SparseMatrix<float>(2, 3));
+}
+{
+    for(const std::string& bad : {std::string("%%MatrixMarket matrix coordinate complex general\n1 1 1\n1 1 1 0\n"),
+            std::string("%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1\n"),
+            std::string("%%MatrixMarket matrix coordinate real general\n2 2 1\n3 1 1\n"),
+            std::string("%%MatrixMarket matrix coordinate real symmetric\n2 3 1\n1 1 1\n"),
+            std::string("%%MatrixMarket matrix array real general\n1 1\n1 2\n"),
+            std::string("1 1 1\n")}){
+        std::stringstream stream(bad);
+        bool thrown = false;
+        try{
+            ReadMatrixMarketSparse<double>(stream);
+        }
+        catch(const std::invalid_argument&){
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+}
+}
+
+void TestSimdLevels(const float error_rate){
+    for(SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512}){
+        SetSimdLevel(level);
+        for(size_t size : {1, 7, 16, 37, 100}){
+            std::vector<double> lhs(size), rhs(size);
+            double dot = 0, sum_squares = 0;
+            for(size_t i = 0; i < size; ++i){
+                lhs[i] = 1.0 + i % 5;
+                rhs[i] = 2.0 - i % 3;
+                dot += lhs[i] * rhs[i];
+                sum_squares += lhs[i] * lhs[i];
+            }
+            ASSERT(std::abs(SimdDot(lhs.data(), rhs.data(), size) - dot) < error_rate);
+            ASSERT(std::abs(SimdSumSquares(lhs.data(), size) - sum_squares) < error_rate);
+
+            std::vector<double> sum = lhs;
+            SimdAdd(sum.data(), rhs.data(), size);
+            SimdScale(sum.data(), 2.0, size);
+            SimdAddScalar(sum.data(), -1.0, size);
+            for(size_t i = 0; i < size; ++i){
+                ASSERT_EQUAL(sum[i], 2 * (lhs[i] + rhs[i]) - 1);
+            }
+        }
+        {
+            Matrix<float> m({{1, 0}, {2, 3}, {3, 7}, {1.5, 2}});
+            Matrix<float> res({{0.248069, 0}, {0.496139, 0.381}, {0.744208, 0.889001}, {0.372104, 0.254}});
+            m = Normalize<float>(m);
+            for(size_t i = 0; i < m.SizeColumn(); ++i){
+                for(size_t j = 0; j < m.SizeRow(); ++j){
+                    ASSERT(std::abs(m[i][j] - res[i][j]) < error_rate);
+                }
+            }
+        }
+    }
+    SetSimdLevel(DetectedSimdLevel());
+}
+
+void TestThreadPool(){
+    {
+        ThreadPool pool(4);
+        ASSERT_EQUAL(pool.NumThreads(), 4);
+        for(size_t count : {0, 1, 3, 100}){
+            std::vector<std::atomic<int>> visits(count);
+            pool.ParallelFor(count, [&](size_t i){
+                ++visits[i];
+            });
+            for(size_t i = 0; i < count; ++i){
+                ASSERT_EQUAL(visits[i].load(), 1);
+            }
+        }
+        std::vector<std::atomic<int>> visits(64);
+        pool.ParallelFor(8, [&](size_t i){
+            pool.ParallelFor(8, [&](size_t j){
+                ++visits[i * 8 + j];
+            });
+        });
+        for(size_t i = 0; i < visits.size(); ++i){
+            ASSERT_EQUAL(visits[i].load(), 1);
+        }
+    }
+    {
+        std::vector<int> visits(1000);
+        SetNumThreads(3);
+        ParallelChunks(visits.size(), 10, [&](size_t begin, size_t end){
+            for(size_t i = begin; i < end; ++i){
+                ++visits[i];
+            }
+        });
+        for(size_t i = 0; i < visits.size(); ++i){
+            ASSERT_EQUAL(visits[i], 1);
+        }
+    }
+    {
+        const size_t initial = NumThreads();
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<float> dist(-1, 1);
+        Matrix<float> a(300, 260, 0), b(260, 310, 0), c(300, 260, 0);
+        for(size_t i = 0; i < a.SizeColumn(); ++i){
+            for(size_t j = 0; j < a.SizeRow(); ++j){
+                a[i][j] = dist(generator);
+                c[i][j] = dist(generator);
+            }
+        }
+        for(size_t i = 0; i < b.SizeColumn(); ++i){
+            for(size_t j = 0; j < b.SizeRow(); ++j){
+                b[i][j] = dist(generator);
+            }
+        }
+        std::vector<Matrix<float>> products, sums;
+        std::vector<Matrix<float>> grams;
+        for(size_t threads : {1, 2, 4}){
+            SetNumThreads(threads);
+            ASSERT_EQUAL(NumThreads(), threads);
+            products.push_back(a * b);
+            grams.push_back(GramColumns(a).ToDense());
+            Matrix<float> sum = a * 2.0f - c;
+            sum += c;
+            sum *= 0.5f;
+            sums.push_back(sum);
+        }
+        SetNumThreads(initial);
+        for(size_t i = 1; i < products.size(); ++i){
+            ASSERT(products[i] == products[0]);
+            ASSERT(grams[i] == grams[0]);
+            ASSERT(sums[i] == sums[0]);
+        }
+    }
+}
+
+void TestMemoryResources(){
+    auto aligned = [](const void* p, size_t alignment){
+        return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+    };
+    {
+        Matrix<float> m(3, 5, 1);
+        ASSERT(m.GetAllocator().Resource() == AlignedMemoryResource());
+        ASSERT(aligned(m.Data(), MATRIX_ALIGNMENT));
+    }
+    {
+        ArenaResource arena(256);
+        Matrix<double> a(4, 3, 2, &arena), b({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}, {1, 1, 1}});
+        ASSERT(a.GetAllocator().Resource() == &arena);
+        ASSERT(aligned(a.Data(), MATRIX_ALIGNMENT));
+        ASSERT(arena.Used() >= 12 * sizeof(double));
+
+        Matrix<double> copy = a;
+        ASSERT(copy.GetAllocator().Resource() == DefaultMemoryResource());
+        ASSERT(copy == a);
+
+        a = a * 2.0 + b;
+        ASSERT(a.GetAllocator().Resource() == &arena);
+        ASSERT(a == Matrix<double>({{5, 6, 7}, {8, 9, 10}, {11, 12, 13}, {5, 5, 5}}));
+        a.PushBackColumn(Matrix<double>(4, 2, 1));
+        ASSERT(a.GetAllocator().Resource() == &arena);
+        ASSERT_EQUAL(a.SizeRow(), 5);
+        ASSERT(aligned(a.Data(), MATRIX_ALIGNMENT));
+
+        a.Swap(b);
+        ASSERT(b.GetAllocator().Resource() == &arena);
+        ASSERT(a.GetAllocator().Resource() == AlignedMemoryResource());
+        ASSERT(a == Matrix<double>({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}, {1, 1, 1}}));
+
+        Matrix<double> moved = std::move(b);
+        ASSERT(moved.GetAllocator().Resource() == &arena);
+        ASSERT_EQUAL(moved[3][4], 1);
+
+        Vector<double> v(100, 1.0, &arena);
+        ASSERT(aligned(v.Data(), MATRIX_ALIGNMENT));
+        SymmetricMatrix<double> g = GramColumns(copy, AlignedAllocator<double>(&arena));
+        ASSERT(g.GetAllocator().Resource() == &arena);
+        ASSERT(g.ToDense() == Transposed(copy) * copy);
+    }
+    {
+        HugePageResource huge(1 << 16);
+        Matrix<float> big(256, 256, 1, &huge), small(4, 4, 1, &huge);
+        ASSERT(aligned(big.Data(), HUGE_PAGE_SIZE));
+        ASSERT(aligned(small.Data(), MATRIX_ALIGNMENT));
+        big *= 2.0f;
+        big += 1.0f;
+        ASSERT_EQUAL(big[255][255], 3);
+        big.PushBackRow(std::vector<float>(256, 4));
+        ASSERT_EQUAL(big[256][0], 4);
+        ASSERT_EQUAL(big[0][0], 3);
+        ASSERT(big.GetAllocator().Resource() == &huge);
+    }
+    {
+        ArenaResource arena;
+        std::pmr::memory_resource* previous = SetDefaultMemoryResource(&arena);
+        ASSERT(previous == AlignedMemoryResource());
+        {
+            Vector<float> v(10, 1);
+            ASSERT(v.GetAllocator().Resource() == &arena);
+        }
+        ASSERT(SetDefaultMemoryResource(nullptr) == &arena);
+        ASSERT(DefaultMemoryResource() == AlignedMemoryResource());
+    }
 }
-}
\ No newline at end of file
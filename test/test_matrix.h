@@ -16,6 +16,7 @@ void TestAdding();
 void TestUnarySign();
 void TestAddNum();
 void TestAddMatrix();
+void TestExpressions();
 
 void TestMultiplication(const float error_rate);
 void TestMultNum(const float error_rate);
@@ -23,8 +24,23 @@ void TestMultMatrix();
 
 void TestNormalize(const float error_rate);
 
+void TestSimdLevels(const float error_rate);
+
+void TestThreadPool();
+
+void TestMemoryResources();
+
 void TestTransp();
 
+void TestSymmetricMatrix();
+void TestVector();
+
 void TestPrint();
 
-void TestParceCSRFormat();
\ No newline at end of file
+void TestParceCSRFormat();
+
+void TestSparseMatrix();
+void TestTextReader();
+void TestBinaryMatrix();
+void TestNpy();
+void TestMatrixMarket();
\ No newline at end of file